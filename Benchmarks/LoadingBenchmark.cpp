@@ -0,0 +1,366 @@
+//
+//  LoadingBenchmark.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 22/06/21.
+//
+//  Loads every model in Models/ and every texture in Textures/ several times and reports, per load stage,
+//  time, bytes and heap allocations (malloc, calloc, realloc & memalign, so C++ new, stb_image and Assimp all count) as JSON
+//  Run from the repository directory:
+//      LoadingBenchmark --repeats 10 --output loading.json
+//
+
+#define STB_IMAGE_IMPLEMENTATION
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <dirent.h>
+#include <malloc/malloc.h>
+#include <mach/mach.h>
+
+#include "../VulkanTesting/VulkanRenderer.hpp"
+
+// -- ALLOCATION COUNTING --
+// Functions of the default malloc zone are replaced with counting ones, so allocations made by C code (stb_image, Assimp's
+// C parts, loader libraries) are counted as well as C++ new (which allocates with malloc). LoadProfiler reads the count at
+// stage boundaries
+static std::atomic<uint64_t> allocationCount(0);
+static void *(*zoneMalloc)(malloc_zone_t *zone, size_t size);
+static void *(*zoneCalloc)(malloc_zone_t *zone, size_t count, size_t size);
+static void *(*zoneRealloc)(malloc_zone_t *zone, void *memory, size_t size);
+static void *(*zoneMemalign)(malloc_zone_t *zone, size_t alignment, size_t size);
+
+static void *countingMalloc(malloc_zone_t *zone, size_t size){
+    allocationCount++;
+    return zoneMalloc(zone, size);
+}
+
+static void *countingCalloc(malloc_zone_t *zone, size_t count, size_t size){
+    allocationCount++;
+    return zoneCalloc(zone, count, size);
+}
+
+static void *countingRealloc(malloc_zone_t *zone, void *memory, size_t size){
+    allocationCount++;
+    return zoneRealloc(zone, memory, size);
+}
+
+static void *countingMemalign(malloc_zone_t *zone, size_t alignment, size_t size){
+    allocationCount++;
+    return zoneMemalign(zone, alignment, size);
+}
+
+// malloc allocates from the first registered zone (malloc_default_zone() may return a wrapper of it)
+static void installAllocationCounter(){
+    vm_address_t *zones = nullptr;
+    unsigned int zoneCount = 0;
+    if(malloc_get_all_zones(mach_task_self(), nullptr, &zones, &zoneCount) != KERN_SUCCESS || zoneCount == 0){
+        throw std::runtime_error("Failed to find default malloc zone!");
+    }
+    malloc_zone_t *zone = reinterpret_cast<malloc_zone_t *>(zones[0]);
+    
+    // Zone structure is read only after initialization
+    vm_address_t page = trunc_page(reinterpret_cast<vm_address_t>(zone));
+    vm_size_t protectedSize = round_page(reinterpret_cast<vm_address_t>(zone) + sizeof(malloc_zone_t)) - page;
+    if(vm_protect(mach_task_self(), page, protectedSize, 0, VM_PROT_READ | VM_PROT_WRITE) != KERN_SUCCESS){
+        throw std::runtime_error("Failed to make malloc zone writable!");
+    }
+    zoneMalloc = zone->malloc;
+    zoneCalloc = zone->calloc;
+    zoneRealloc = zone->realloc;
+    zone->malloc = countingMalloc;
+    zone->calloc = countingCalloc;
+    zone->realloc = countingRealloc;
+    if(zone->version >= 5 && zone->memalign){
+        zoneMemalign = zone->memalign;
+        zone->memalign = countingMemalign;
+    }
+    vm_protect(mach_task_self(), page, protectedSize, 0, VM_PROT_READ);
+}
+
+// Command line options
+struct LoadingConfig{
+    uint32_t repeats = 5;               // Measured loads of each asset
+    uint32_t warmupRepeats = 1;         // Loads before measuring (file system cache, driver first-use costs)
+    bool models = true;
+    bool textures = true;
+    std::string outputFile;             // Empty writes JSON to stdout
+};
+
+// Asset file, relative to Models/ or Textures/
+struct Asset{
+    std::string name;
+    bool isModel;
+};
+
+// Measured loads of one asset
+struct AssetResult{
+    Asset asset;
+    std::string error;
+    std::vector<double> totalTimes;
+    std::vector<LoadStageStats> stageRuns[LOAD_STAGE_COUNT];
+};
+
+static void printUsage(){
+    printf("Usage: LoadingBenchmark [--repeats N] [--warmup N] [--models-only] [--textures-only] [--output FILE]\n");
+}
+
+static LoadingConfig parseArguments(int argc, char **argv){
+    LoadingConfig config;
+    for(int i=1; i<argc; i++){
+        std::string argument = argv[i];
+        if(argument == "--models-only"){
+            config.textures = false;
+        }else if(argument == "--textures-only"){
+            config.models = false;
+        }else if(argument == "--help"){
+            printUsage();
+            exit(EXIT_SUCCESS);
+        }else if(i + 1 >= argc){
+            throw std::runtime_error("Missing value for " + argument + "!");
+        }else if(argument == "--repeats"){
+            config.repeats = std::stoul(argv[++i]);
+        }else if(argument == "--warmup"){
+            config.warmupRepeats = std::stoul(argv[++i]);
+        }else if(argument == "--output"){
+            config.outputFile = argv[++i];
+        }else{
+            throw std::runtime_error("Unknown option " + argument + "!");
+        }
+    }
+    if(config.repeats == 0){
+        throw std::runtime_error("Repeats must be at least 1!");
+    }
+    return config;
+}
+
+static bool hasExtension(const std::string &fileName, const std::vector<std::string> &extensions){
+    size_t dot = fileName.find_last_of('.');
+    if(dot == std::string::npos){
+        return false;
+    }
+    std::string extension = fileName.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return std::find(extensions.begin(), extensions.end(), extension) != extensions.end();
+}
+
+// Files under directory (relative paths, sorted), optionally walking sub directories
+static void listFiles(const std::string &root, const std::string &directory, bool recursive, const std::vector<std::string> &extensions, std::vector<std::string> *files){
+    DIR *dir = opendir((root + "/" + directory).c_str());
+    if(!dir){
+        return;
+    }
+    std::vector<std::string> entries;
+    while(dirent *entry = readdir(dir)){
+        std::string name = entry->d_name;
+        if(name[0] != '.'){
+            entries.push_back(name);
+        }
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+    
+    for(const std::string &name: entries){
+        std::string path = directory.empty() ? name : directory + "/" + name;
+        DIR *subDir = recursive ? opendir((root + "/" + path).c_str()) : nullptr;
+        if(subDir){
+            closedir(subDir);
+            listFiles(root, path, recursive, extensions, files);
+        }else if(hasExtension(name, extensions)){
+            files->push_back(path);
+        }
+    }
+}
+
+static double median(std::vector<double> values){
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+static std::string escapeJson(const std::string &text){
+    std::string escaped;
+    for(char c: text){
+        if(c == '"' || c == '\\'){
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static std::string formatDouble(double value){
+    char text[32];
+    snprintf(text, sizeof(text), "%.4f", value);
+    return text;
+}
+
+// Load asset once, stats of each stage end up in the renderer's load profiler
+static double loadAsset(VulkanRenderer &vulkanRenderer, const Asset &asset){
+    LoadProfiler &profiler = vulkanRenderer.getLoadProfiler();
+    profiler.reset();
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if(asset.isModel){
+        ModelHandle model = vulkanRenderer.createMeshModel(asset.name);
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        vulkanRenderer.destroyMeshModel(model);
+        vulkanRenderer.flushReleasedResources();
+        return time;
+    }
+    
+    int texture = vulkanRenderer.createTexture(asset.name);
+    double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    vulkanRenderer.releaseTexture(texture);
+    vulkanRenderer.flushReleasedResources();
+    return time;
+}
+
+int main(int argc, char **argv){
+    LoadingConfig config;
+    try{
+        config = parseArguments(argc, argv);
+    }catch(const std::exception &e){
+        printf("ERROR: %s\n", e.what());
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    
+    // Renderer needs a surface, use a window that is never shown
+    glfwInit();
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(640, 480, "Loading Benchmark", nullptr, nullptr);
+    
+    VulkanRenderer vulkanRenderer;
+    if(vulkanRenderer.init(window) == EXIT_FAILURE){
+        return EXIT_FAILURE;
+    }
+    installAllocationCounter();
+    vulkanRenderer.getLoadProfiler().setAllocationCounter([](){ return allocationCount.load(); });
+    
+    // -- FIND ASSETS --
+    std::string root = getcwd(NULL, 0);
+    std::vector<Asset> assets;
+    if(config.models){
+        std::vector<std::string> modelFiles;
+        listFiles(root + "/Models", "", true, { "obj", "fbx", "dae", "gltf", "glb", "3ds", "ply", "stl", "blend" }, &modelFiles);
+        for(const std::string &file: modelFiles){
+            assets.push_back({ file, true });
+        }
+    }
+    if(config.textures){
+        std::vector<std::string> textureFiles;
+        listFiles(root + "/Textures", "", false, { "png", "jpg", "jpeg", "bmp", "tga" }, &textureFiles);
+        for(const std::string &file: textureFiles){
+            assets.push_back({ file, false });
+        }
+    }
+    
+    // -- RUN --
+    std::vector<AssetResult> results;
+    for(const Asset &asset: assets){
+        AssetResult result;
+        result.asset = asset;
+        printf(">>> Loading %s %s\n", asset.isModel ? "model" : "texture", asset.name.c_str());
+        try{
+            for(uint32_t repeat=0; repeat<config.warmupRepeats + config.repeats; repeat++){
+                double time = loadAsset(vulkanRenderer, asset);
+                if(repeat < config.warmupRepeats){
+                    continue;
+                }
+                result.totalTimes.push_back(time);
+                for(int stage=0; stage<LOAD_STAGE_COUNT; stage++){
+                    result.stageRuns[stage].push_back(vulkanRenderer.getLoadProfiler().getStats(static_cast<LoadStage>(stage)));
+                }
+            }
+        }catch(const std::runtime_error &e){
+            result.error = e.what();
+            vulkanRenderer.flushReleasedResources();
+        }
+        results.push_back(result);
+    }
+    
+    vulkanRenderer.cleanUp();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    
+    // -- REPORT --
+    // Per asset: median over repeats; totals: sum of medians over all assets, so the most expensive stage stands out
+    double stageTotals[LOAD_STAGE_COUNT] = {};
+    double stageAllocationTotals[LOAD_STAGE_COUNT] = {};
+    std::string json = "{\n";
+    json += "  \"benchmark\": \"asset_loading\",\n";
+    json += "  \"config\": { \"repeats\": " + std::to_string(config.repeats) + ", \"warmup_repeats\": " + std::to_string(config.warmupRepeats) + " },\n";
+    json += "  \"assets\": [\n";
+    for(size_t i=0; i<results.size(); i++){
+        const AssetResult &result = results[i];
+        json += "    { \"name\": \"" + escapeJson(result.asset.name) + "\", \"type\": \"" + (result.asset.isModel ? "model" : "texture") + "\"";
+        if(!result.error.empty() || result.totalTimes.empty()){
+            json += ", \"error\": \"" + escapeJson(result.error) + "\" }";
+        }else{
+            std::vector<double> sortedTimes = result.totalTimes;
+            std::sort(sortedTimes.begin(), sortedTimes.end());
+            json += ", \"total_ms\": { \"median\": " + formatDouble(median(result.totalTimes))
+                + ", \"min\": " + formatDouble(sortedTimes.front()) + ", \"max\": " + formatDouble(sortedTimes.back()) + " },\n";
+            json += "      \"stages\": {\n";
+            for(int stage=0; stage<LOAD_STAGE_COUNT; stage++){
+                std::vector<double> times;
+                std::vector<double> allocations;
+                for(const LoadStageStats &stats: result.stageRuns[stage]){
+                    times.push_back(stats.time);
+                    allocations.push_back(static_cast<double>(stats.allocations));
+                }
+                const LoadStageStats &lastRun = result.stageRuns[stage].back();
+                stageTotals[stage] += median(times);
+                stageAllocationTotals[stage] += median(allocations);
+                
+                json += "        \"" + std::string(LoadProfiler::getStageName(static_cast<LoadStage>(stage))) + "\": { \"ms\": " + formatDouble(median(times))
+                    + ", \"calls\": " + std::to_string(lastRun.calls)
+                    + ", \"bytes\": " + std::to_string(lastRun.bytes)
+                    + ", \"allocations\": " + std::to_string(static_cast<uint64_t>(median(allocations))) + " }"
+                    + (stage + 1 < LOAD_STAGE_COUNT ? ",\n" : "\n");
+            }
+            json += "      } }";
+        }
+        json += i + 1 < results.size() ? ",\n" : "\n";
+    }
+    json += "  ],\n";
+    
+    int slowestStage = 0;
+    json += "  \"stage_totals\": {\n";
+    for(int stage=0; stage<LOAD_STAGE_COUNT; stage++){
+        if(stageTotals[stage] > stageTotals[slowestStage]){
+            slowestStage = stage;
+        }
+        json += "    \"" + std::string(LoadProfiler::getStageName(static_cast<LoadStage>(stage))) + "\": { \"ms\": " + formatDouble(stageTotals[stage])
+            + ", \"allocations\": " + std::to_string(static_cast<uint64_t>(stageAllocationTotals[stage])) + " }"
+            + (stage + 1 < LOAD_STAGE_COUNT ? ",\n" : "\n");
+    }
+    json += "  },\n";
+    json += "  \"slowest_stage\": \"" + std::string(LoadProfiler::getStageName(static_cast<LoadStage>(slowestStage))) + "\"\n";
+    json += "}\n";
+    
+    if(config.outputFile.empty()){
+        printf("%s", json.c_str());
+    }else{
+        std::ofstream file(config.outputFile, std::ios::trunc);
+        if(!file.is_open()){
+            printf("ERROR: Failed to write %s\n", config.outputFile.c_str());
+            return EXIT_FAILURE;
+        }
+        file << json;
+        file.close();
+        printf(">>> Results written to %s\n", config.outputFile.c_str());
+    }
+    
+    return EXIT_SUCCESS;
+}
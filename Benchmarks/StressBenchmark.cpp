@@ -0,0 +1,381 @@
+//
+//  StressBenchmark.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 21/06/21.
+//
+//  Renders a generated scene for a fixed number of frames and reports frame cost as JSON
+//  Run from the repository directory (shaders & default texture are loaded relative to it):
+//      StressBenchmark --models 200 --meshes 4 --textures 16 --triangles 2000000 --frames 600 --headless --output stress.json
+//
+
+#define STB_IMAGE_IMPLEMENTATION
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+#include "../VulkanTesting/VulkanRenderer.hpp"
+
+// Command line options
+struct StressConfig{
+    uint32_t modelCount = 100;              // N models
+    uint32_t meshesPerModel = 4;            // M meshes per model
+    uint32_t textureCount = 8;              // K textures shared by all meshes (0 uses the default texture only)
+    uint64_t triangleBudget = 1000000;      // Triangles of whole scene, split evenly over meshes
+    uint32_t frameCount = 500;              // Measured frames
+    uint32_t warmupFrames = 30;             // Frames drawn before measuring (pipelines, caches, first uploads)
+    uint32_t seed = 1;
+    bool headless = false;
+    bool depthPrepass = false;              // Depth only pass before shading (compare fragment cost with & without)
+    bool occlusionCulling = true;           // Skip meshes hidden in last frame's Hi-Z pyramid
+    bool lodSelection = true;               // Draw distant meshes at a lower level of detail
+    bool meshletCulling = true;             // Draw only meshlets in view & facing the camera
+    DrawOrder drawOrder = DRAW_ORDER_FRONT_TO_BACK;
+    int width = 1366;
+    int height = 768;
+    std::string outputFile;                 // Empty writes JSON to stdout
+};
+
+// Min, mean & percentiles of a series of frame times
+struct TimeSummary{
+    double mean;
+    double min;
+    double max;
+    double p50;
+    double p95;
+    double p99;
+};
+
+static void printUsage(){
+    printf("Usage: StressBenchmark [--models N] [--meshes M] [--textures K] [--triangles T] [--frames F]\n"
+           "                       [--warmup W] [--seed S] [--width W] [--height H] [--headless] [--depth-prepass]\n"
+           "                       [--no-occlusion-culling] [--no-lod] [--no-meshlet-culling]\n"
+           "                       [--draw-order depth|state] [--output FILE]\n");
+}
+
+static StressConfig parseArguments(int argc, char **argv){
+    StressConfig config;
+    for(int i=1; i<argc; i++){
+        std::string argument = argv[i];
+        if(argument == "--headless"){
+            config.headless = true;
+            continue;
+        }
+        if(argument == "--depth-prepass"){
+            config.depthPrepass = true;
+            continue;
+        }
+        if(argument == "--no-occlusion-culling"){
+            config.occlusionCulling = false;
+            continue;
+        }
+        if(argument == "--no-lod"){
+            config.lodSelection = false;
+            continue;
+        }
+        if(argument == "--no-meshlet-culling"){
+            config.meshletCulling = false;
+            continue;
+        }
+        if(argument == "--help"){
+            printUsage();
+            exit(EXIT_SUCCESS);
+        }
+        if(i + 1 >= argc){
+            throw std::runtime_error("Missing value for " + argument + "!");
+        }
+        std::string value = argv[++i];
+        if(argument == "--models"){
+            config.modelCount = std::stoul(value);
+        }else if(argument == "--meshes"){
+            config.meshesPerModel = std::stoul(value);
+        }else if(argument == "--textures"){
+            config.textureCount = std::stoul(value);
+        }else if(argument == "--triangles"){
+            config.triangleBudget = std::stoull(value);
+        }else if(argument == "--frames"){
+            config.frameCount = std::stoul(value);
+        }else if(argument == "--warmup"){
+            config.warmupFrames = std::stoul(value);
+        }else if(argument == "--seed"){
+            config.seed = std::stoul(value);
+        }else if(argument == "--width"){
+            config.width = std::stoi(value);
+        }else if(argument == "--height"){
+            config.height = std::stoi(value);
+        }else if(argument == "--output"){
+            config.outputFile = value;
+        }else if(argument == "--draw-order"){
+            if(value != "depth" && value != "state"){
+                throw std::runtime_error("Draw order must be depth or state!");
+            }
+            config.drawOrder = value == "depth" ? DRAW_ORDER_FRONT_TO_BACK : DRAW_ORDER_STATE;
+        }else{
+            throw std::runtime_error("Unknown option " + argument + "!");
+        }
+    }
+    if(config.modelCount == 0 || config.meshesPerModel == 0 || config.frameCount == 0){
+        throw std::runtime_error("Models, meshes and frames must be at least 1!");
+    }
+    return config;
+}
+
+// UV sphere with about triangleCount triangles, centered on center
+static MeshData createSphere(uint64_t triangleCount, glm::vec3 center, float radius, glm::vec3 color, int textureId){
+    uint32_t slices = std::max(3u, static_cast<uint32_t>(std::sqrt(static_cast<double>(triangleCount))));
+    uint32_t stacks = std::max(2u, static_cast<uint32_t>(triangleCount / (2 * slices)));
+    
+    MeshData mesh;
+    mesh.textureId = textureId;
+    for(uint32_t stack=0; stack<=stacks; stack++){
+        float v = static_cast<float>(stack) / stacks;
+        float phi = v * glm::pi<float>();
+        for(uint32_t slice=0; slice<=slices; slice++){
+            float u = static_cast<float>(slice) / slices;
+            float theta = u * 2.0f * glm::pi<float>();
+            glm::vec3 normal(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+            mesh.vertices.push_back({ center + normal * radius, color, glm::vec2(u, v) });
+        }
+    }
+    for(uint32_t stack=0; stack<stacks; stack++){
+        for(uint32_t slice=0; slice<slices; slice++){
+            uint32_t first = stack * (slices + 1) + slice;
+            uint32_t second = first + slices + 1;
+            mesh.indices.insert(mesh.indices.end(), { first, first + 1, second, second, first + 1, second + 1 });
+        }
+    }
+    return mesh;
+}
+
+// Checkerboard in two random colors, so textures differ but cost the same to sample
+static std::vector<uint8_t> createCheckerboard(int size, std::mt19937 &random){
+    std::uniform_int_distribution<int> channel(0, 255);
+    uint8_t colors[2][4];
+    for(int c=0; c<2; c++){
+        for(int i=0; i<3; i++){
+            colors[c][i] = static_cast<uint8_t>(channel(random));
+        }
+        colors[c][3] = 255;
+    }
+    
+    std::vector<uint8_t> pixels(size * size * 4);
+    for(int y=0; y<size; y++){
+        for(int x=0; x<size; x++){
+            const uint8_t *color = colors[((x / 8) + (y / 8)) % 2];
+            memcpy(&pixels[(y * size + x) * 4], color, 4);
+        }
+    }
+    return pixels;
+}
+
+// Nearest-rank percentiles
+static TimeSummary summarize(std::vector<double> times){
+    TimeSummary summary = {};
+    if(times.empty()){
+        return summary;
+    }
+    std::sort(times.begin(), times.end());
+    
+    auto percentile = [&](double p){
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * times.size()));
+        return times[std::min(times.size(), std::max<size_t>(rank, 1)) - 1];
+    };
+    
+    double total = 0.0;
+    for(double time: times){
+        total += time;
+    }
+    summary.mean = total / times.size();
+    summary.min = times.front();
+    summary.max = times.back();
+    summary.p50 = percentile(50.0);
+    summary.p95 = percentile(95.0);
+    summary.p99 = percentile(99.0);
+    return summary;
+}
+
+static std::string toJson(const TimeSummary &summary){
+    char text[256];
+    snprintf(text, sizeof(text), "{ \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f }",
+             summary.mean, summary.min, summary.max, summary.p50, summary.p95, summary.p99);
+    return text;
+}
+
+// Scene pass counters, overdraw is fragment shader invocations per pixel
+static std::string toJson(const PassStats &stats, uint32_t pixelCount){
+    char text[384];
+    snprintf(text, sizeof(text), "{ \"input_vertices\": %llu, \"vertex_shader_invocations\": %llu, \"clipping_primitives\": %llu, \"fragment_shader_invocations\": %llu, \"samples_passed\": %llu, \"overdraw\": %.4f }",
+             (unsigned long long) stats.inputVertices, (unsigned long long) stats.vertexShaderInvocations, (unsigned long long) stats.clippingPrimitives,
+             (unsigned long long) stats.fragmentShaderInvocations, (unsigned long long) stats.samplesPassed, (double) stats.fragmentShaderInvocations / pixelCount);
+    return text;
+}
+
+int main(int argc, char **argv){
+    StressConfig config;
+    try{
+        config = parseArguments(argc, argv);
+    }catch(const std::exception &e){
+        printf("ERROR: %s\n", e.what());
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    
+    // Headless runs use a hidden window: same swapchain & present path, nothing shown on screen
+    glfwInit();
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_VISIBLE, config.headless ? GLFW_FALSE : GLFW_TRUE);
+    GLFWwindow *window = glfwCreateWindow(config.width, config.height, "Stress Benchmark", nullptr, nullptr);
+    
+    VulkanRenderer vulkanRenderer;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    if(vulkanRenderer.init(window) == EXIT_FAILURE){
+        return EXIT_FAILURE;
+    }
+    vulkanRenderer.setDepthPrepass(config.depthPrepass);
+    vulkanRenderer.setDrawOrder(config.drawOrder);
+    vulkanRenderer.setOcclusionCulling(config.occlusionCulling);
+    vulkanRenderer.setLodSelection(config.lodSelection);
+    vulkanRenderer.setMeshletCulling(config.meshletCulling);
+    
+    std::vector<double> cpuTimes;
+    std::vector<double> gpuTimes;
+    PassStats scenePassStats = {};
+    FrameStats lastStats = {};
+    uint64_t sceneTriangles = 0;
+    double setupTime = 0.0;
+    try{
+        // -- GENERATE SCENE --
+        std::mt19937 random(config.seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        
+        std::vector<int> textures;
+        for(uint32_t i=0; i<config.textureCount; i++){
+            textures.push_back(vulkanRenderer.createTexture(createCheckerboard(64, random), 64, 64));
+        }
+        
+        uint64_t trianglesPerMesh = std::max<uint64_t>(1, config.triangleBudget / (static_cast<uint64_t>(config.modelCount) * config.meshesPerModel));
+        
+        // Models on a grid filling a cube in front of the camera, each mesh a sphere on a ring around its model's origin
+        uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(config.modelCount))));
+        float cellSize = 14.0f / gridSize;
+        std::vector<ModelHandle> models;
+        std::vector<glm::vec3> positions;
+        for(uint32_t i=0; i<config.modelCount; i++){
+            std::vector<MeshData> meshes;
+            for(uint32_t j=0; j<config.meshesPerModel; j++){
+                float angle = 2.0f * glm::pi<float>() * j / config.meshesPerModel;
+                glm::vec3 center = config.meshesPerModel > 1 ? glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * 0.3f : glm::vec3(0.0f);
+                glm::vec3 color(unit(random), unit(random), unit(random));
+                int textureId = textures.empty() ? 0 : textures[(i * config.meshesPerModel + j) % textures.size()];
+                MeshData mesh = createSphere(trianglesPerMesh, center, 0.2f, color, textureId);
+                sceneTriangles += mesh.indices.size() / 3;
+                meshes.push_back(mesh);
+            }
+            models.push_back(vulkanRenderer.createMeshModel(meshes, "stress:" + std::to_string(i)));
+            
+            glm::vec3 cell(i % gridSize, (i / gridSize) % gridSize, i / (gridSize * gridSize));
+            positions.push_back(glm::vec3(-7.0f, -7.0f, -9.0f) + (cell + 0.5f) * cellSize);
+        }
+        setupTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        
+        // -- RUN --
+        // Models turn by a fixed step per frame, so every run draws the same frames
+        uint32_t totalFrames = config.warmupFrames + config.frameCount;
+        for(uint32_t frame=0; frame<totalFrames && !glfwWindowShouldClose(window); frame++){
+            glfwPollEvents();
+            
+            float angle = glm::radians(static_cast<float>(frame));
+            for(size_t i=0; i<models.size(); i++){
+                glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+                model = glm::rotate(model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+                model = glm::scale(model, glm::vec3(cellSize));
+                vulkanRenderer.updateModel(models[i], model);
+            }
+            
+            std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+            vulkanRenderer.draw();
+            double frameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+            
+            if(frame < config.warmupFrames){
+                continue;
+            }
+            cpuTimes.push_back(frameTime);
+            
+            // GPU time is of the last finished frame, so it trails CPU time by a frame in flight or two
+            lastStats = vulkanRenderer.getFrameStats();
+            if(lastStats.gpuTimeValid){
+                gpuTimes.push_back(lastStats.gpuTime);
+            }
+            PassStats passStats = vulkanRenderer.getPassStats(QUERY_PASS_SCENE);
+            if(passStats.valid){
+                scenePassStats = passStats;
+            }
+        }
+    }catch(const std::runtime_error &e){
+        printf("ERROR: %s\n", e.what());
+        vulkanRenderer.cleanUp();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+    
+    vulkanRenderer.cleanUp();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    
+    // -- REPORT --
+    std::string json = "{\n";
+    json += "  \"benchmark\": \"stress_scene\",\n";
+    json += "  \"config\": { \"models\": " + std::to_string(config.modelCount)
+        + ", \"meshes_per_model\": " + std::to_string(config.meshesPerModel)
+        + ", \"textures\": " + std::to_string(config.textureCount)
+        + ", \"triangle_budget\": " + std::to_string(config.triangleBudget)
+        + ", \"frames\": " + std::to_string(config.frameCount)
+        + ", \"warmup_frames\": " + std::to_string(config.warmupFrames)
+        + ", \"seed\": " + std::to_string(config.seed)
+        + ", \"width\": " + std::to_string(config.width)
+        + ", \"height\": " + std::to_string(config.height)
+        + ", \"headless\": " + (config.headless ? "true" : "false")
+        + ", \"depth_prepass\": " + (config.depthPrepass ? "true" : "false")
+        + ", \"occlusion_culling\": " + (config.occlusionCulling ? "true" : "false")
+        + ", \"lod\": " + (config.lodSelection ? "true" : "false")
+        + ", \"meshlet_culling\": " + (config.meshletCulling ? "true" : "false")
+        + ", \"draw_order\": \"" + (config.drawOrder == DRAW_ORDER_FRONT_TO_BACK ? "depth" : "state") + "\" },\n";
+    json += "  \"measured_frames\": " + std::to_string(cpuTimes.size()) + ",\n";
+    json += "  \"setup_ms\": " + std::to_string(setupTime) + ",\n";
+    json += "  \"cpu_frame_ms\": " + toJson(summarize(cpuTimes)) + ",\n";
+    json += "  \"gpu_frame_ms\": " + (gpuTimes.empty() ? std::string("null") : toJson(summarize(gpuTimes))) + ",\n";
+    json += "  \"scene_triangles\": " + std::to_string(sceneTriangles) + ",\n";
+    json += "  \"draws\": " + std::to_string(lastStats.drawCount) + ",\n";
+    json += "  \"binds\": " + std::to_string(lastStats.bindCount) + ",\n";
+    json += "  \"triangles\": " + std::to_string(lastStats.triangleCount) + ",\n";
+    json += "  \"culled\": " + std::to_string(lastStats.culledCount) + ",\n";
+    json += "  \"culled_meshlets\": " + std::to_string(lastStats.culledMeshletCount) + ",\n";
+    json += "  \"scene_pass\": " + (scenePassStats.valid ? toJson(scenePassStats, config.width * config.height) : std::string("null")) + "\n";
+    json += "}\n";
+    
+    if(config.outputFile.empty()){
+        printf("%s", json.c_str());
+    }else{
+        std::ofstream file(config.outputFile, std::ios::trunc);
+        if(!file.is_open()){
+            printf("ERROR: Failed to write %s\n", config.outputFile.c_str());
+            return EXIT_FAILURE;
+        }
+        file << json;
+        file.close();
+        printf(">>> Results written to %s\n", config.outputFile.c_str());
+    }
+    
+    return EXIT_SUCCESS;
+}
@@ -1,5 +1,11 @@
-/usr/local/bin/glslangValidator -V shader.vert
-/usr/local/bin/glslangValidator -V shader.frag
-/usr/local/bin/glslangValidator -o second_vert.spv -V second.vert
-/usr/local/bin/glslangValidator -o second_frag.spv -V second.frag
+# Shaders are compiled at runtime (see ShaderCompiler), this only checks them for errors
+# Uses glslangValidator from PATH (comes with the Vulkan SDK)
+cd "$(dirname "$0")"
+glslangValidator -V shader.vert -o /dev/null
+glslangValidator -V shader.frag -o /dev/null
+glslangValidator -V second.vert -o /dev/null
+glslangValidator -V second.frag -o /dev/null
+glslangValidator -V overdraw.frag -o /dev/null
+glslangValidator -V depth.vert -o /dev/null
+glslangValidator -V hiz.comp -o /dev/null
 #read -p "Program execution finished. Press any key to exit..."
@@ -0,0 +1,20 @@
+#version 450            // Use GLSL 4.5
+
+// Depth prepass: same position as shader.vert, nothing else
+layout(location = 0) in vec3 pos;           // Vertex position data
+
+layout(set = 0, binding = 0) uniform UBOViewProjection{
+    mat4 projection;
+    mat4 view;
+}uboViewProjection;
+
+layout(push_constant) uniform PushModel{
+    mat4 model;
+}pushModel;
+
+// Must match shader.vert bit for bit, the main pass tests depth with EQUAL
+invariant gl_Position;
+
+void main(){
+    gl_Position = uboViewProjection.projection * uboViewProjection.view * pushModel.model * vec4(pos, 1.0);
+}
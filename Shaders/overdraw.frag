@@ -0,0 +1,8 @@
+#version 450
+
+// Scene drawn with additive blending into a float attachment: each shaded fragment adds 1 to its pixel's count
+layout(location = 0) out vec4 outCount;
+
+void main(){
+    outCount = vec4(1.0, 0.0, 0.0, 0.0);
+}
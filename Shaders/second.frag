@@ -1,25 +1,52 @@
 #version 450
 
-layout(input_attachment_index = 0, binding = 0) uniform subpassInput inputColor;    // Color output from subpass 1
+layout(input_attachment_index = 0, binding = 0) uniform subpassInput inputColor;    // Color output from subpass 1 (fragment count in mode 3)
 layout(input_attachment_index = 1, binding = 1) uniform subpassInput inputDepth;    // Depth output from subpass 1
 
+// Specialization constants (set when pipeline is created, see PostProcessMode in Utilities.h)
+layout(constant_id = 0) const int POST_PROCESS_MODE = 1;    // 0: none, 1: depth on right of splitX, 2: depth on whole screen, 3: overdraw heatmap
+
+layout(push_constant) uniform PostProcessSettings{
+    float splitX;               // Screen x coordinate where depth shading starts (mode 1)
+}postProcessSettings;
+
 layout(location = 0) out vec4 color;
 
+// Darken color the further away it is
+vec4 depthShade(){
+    float lowerBound = 0.99;
+    float upperBound = 1;
+    
+    float depth = subpassLoad(inputDepth).r;
+    
+    // Scale the depth value between upperBound and lowerBound
+    float depthColorScale = 1.0 - ((depth - lowerBound) / (upperBound - lowerBound));
+    
+    //return vec4(depthColorScale, 0.0, 0.0, 1.0);
+    return vec4(subpassLoad(inputColor).rgb * depthColorScale, 1.0);
+}
+
+// Fragments shaded at pixel: blue for 1, through green to red for OVERDRAW_HEAT_MAX or more, black for none
+vec4 overdrawHeat(){
+    const float OVERDRAW_HEAT_MAX = 8.0;
+    
+    float count = subpassLoad(inputColor).r;
+    if(count < 0.5){
+        return vec4(0.0, 0.0, 0.0, 1.0);
+    }
+    
+    float heat = clamp((count - 1.0) / (OVERDRAW_HEAT_MAX - 1.0), 0.0, 1.0);
+    vec3 heatColor = heat < 0.5 ? mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), heat * 2.0)
+                                : mix(vec3(0.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), heat * 2.0 - 1.0);
+    return vec4(heatColor, 1.0);
+}
+
 void main(){
-    // color = subpassLoad(inputColor).rgba;
-    // color.g = 0.0;
-    int xHalf = 1366/2;
-    if(gl_FragCoord.x > xHalf){
-        float lowerBound = 0.99;
-        float upperBound = 1;
-        
-        float depth = subpassLoad(inputDepth).r;
-        
-        // Scale the depth value between upperBound and lowerBound
-        float depthColorScale = 1.0 - ((depth - lowerBound) / (upperBound - lowerBound));
-        
-        //color = vec4(depthColorScale, 0.0, 0.0, 1.0);
-        color = vec4(subpassLoad(inputColor).rgb * depthColorScale, 1.0);
+    // Conditions on constants are resolved when the pipeline is created, so each variant keeps only its own path
+    if(POST_PROCESS_MODE == 3){
+        color = overdrawHeat();
+    }else if(POST_PROCESS_MODE == 2 || (POST_PROCESS_MODE == 1 && gl_FragCoord.x > postProcessSettings.splitX)){
+        color = depthShade();
     }else{
         color = subpassLoad(inputColor).rgba;
     }
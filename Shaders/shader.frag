@@ -5,8 +5,15 @@ layout(location = 1) in vec2 fragTex;      // texture out location
 
 layout(set = 1, binding = 0) uniform sampler2D textureSampler;
 
+// Specialization constants (set when pipeline is created)
+layout(constant_id = 0) const bool TEXTURE_SAMPLING = true;    // false: use vertex color only
+
 layout(location = 0) out vec4 outColor;     // Final output color (must also have location)
 
 void main(){
-    outColor = texture(textureSampler, fragTex);
+    if(TEXTURE_SAMPLING){
+        outColor = texture(textureSampler, fragTex);
+    }else{
+        outColor = vec4(fragColor, 1.0);
+    }
 }
@@ -21,6 +21,9 @@ layout(push_constant) uniform PushModel{
 layout(location = 0) out vec3 fragColor;    // output color for vertex (location is required)
 layout(location = 1) out vec2 fragTex;      // texture out location
 
+// Same computation as depth.vert gives the same depth, needed for EQUAL test after a depth prepass
+invariant gl_Position;
+
 void main(){
     gl_Position = uboViewProjection.projection * uboViewProjection.view * pushModel.model * vec4(pos, 1.0);
     fragColor = color;
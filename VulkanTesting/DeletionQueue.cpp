@@ -0,0 +1,41 @@
+//
+//  DeletionQueue.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 19/06/21.
+//
+
+#include "DeletionQueue.hpp"
+
+DeletionQueue::DeletionQueue(){
+
+}
+
+DeletionQueue::~DeletionQueue(){
+
+}
+
+// submittedFrameCount: frames submitted so far (any of them may use the resource, later ones won't)
+void DeletionQueue::push(uint64_t submittedFrameCount, std::function<void()> destroy){
+    entries.push_back({ submittedFrameCount, destroy });
+}
+
+// Destroy everything retired before completedFrameCount frames had been submitted
+void DeletionQueue::flush(uint64_t completedFrameCount){
+    while(!entries.empty() && entries.front().submittedFrameCount <= completedFrameCount){
+        entries.front().destroy();
+        entries.pop_front();
+    }
+}
+
+// Destroy everything (device must be idle)
+void DeletionQueue::flushAll(){
+    while(!entries.empty()){
+        entries.front().destroy();
+        entries.pop_front();
+    }
+}
+
+size_t DeletionQueue::getPendingCount(){
+    return entries.size();
+}
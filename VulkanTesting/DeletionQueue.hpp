@@ -0,0 +1,38 @@
+//
+//  DeletionQueue.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 19/06/21.
+//
+
+#ifndef DeletionQueue_hpp
+#define DeletionQueue_hpp
+
+#include <deque>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+// GPU resources waiting to be destroyed until no frame in flight can still be using them
+// Each entry records how many frames had been submitted when it was retired; it is destroyed once that many frames are known to be complete
+class DeletionQueue{
+public:
+    DeletionQueue();
+    ~DeletionQueue();
+    
+    void push(uint64_t submittedFrameCount, std::function<void()> destroy);
+    void flush(uint64_t completedFrameCount);
+    void flushAll();
+    
+    size_t getPendingCount();
+
+private:
+    struct Entry{
+        uint64_t submittedFrameCount;
+        std::function<void()> destroy;
+    };
+    
+    std::deque<Entry> entries;          // In retire order, so oldest entries are at the front
+};
+
+#endif /* DeletionQueue_hpp */
@@ -0,0 +1,122 @@
+//
+//  DescriptorAllocator.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 17/06/21.
+//
+
+#include "DescriptorAllocator.hpp"
+
+DescriptorAllocator::DescriptorAllocator(){
+
+}
+
+DescriptorAllocator::~DescriptorAllocator(){
+
+}
+
+// descriptorsPerSet: most descriptors of each type any set allocated here needs
+void DescriptorAllocator::init(VkDevice newDevice, uint32_t newSetsPerPool, const std::vector<VkDescriptorPoolSize> &newDescriptorsPerSet){
+    device = newDevice;
+    setsPerPool = newSetsPerPool;
+    descriptorsPerSet = newDescriptorsPerSet;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout){
+    // Move on to another pool before going over maxSets (Vulkan 1.0 doesn't promise an error for that)
+    if(currentPool == VK_NULL_HANDLE || currentPoolSetCount == setsPerPool){
+        nextPool();
+    }
+    
+    // Descriptor set allocation info
+    VkDescriptorSetAllocateInfo setAllocInfo = {};
+    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocInfo.descriptorPool = currentPool;                  // Pool to allocate Descriptor Set from
+    setAllocInfo.descriptorSetCount = 1;                        // Number of sets to allocate
+    setAllocInfo.pSetLayouts = &layout;                         // Layout to use to allocate sets
+    
+    VkDescriptorSet descriptorSet;
+    VkResult result = vkAllocateDescriptorSets(device, &setAllocInfo, &descriptorSet);
+    
+    // Pool ran out of descriptors anyway, try once more with a fresh pool
+    if(result == VK_ERROR_OUT_OF_POOL_MEMORY_KHR || result == VK_ERROR_FRAGMENTED_POOL){
+        nextPool();
+        setAllocInfo.descriptorPool = currentPool;
+        result = vkAllocateDescriptorSets(device, &setAllocInfo, &descriptorSet);
+    }
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate a Descriptor Set!");
+    }
+    
+    currentPoolSetCount++;
+    allocatedSetCount++;
+    return descriptorSet;
+}
+
+// Free every set allocated so far, pools are kept for reuse (sets must no longer be in use by the GPU)
+void DescriptorAllocator::reset(){
+    for(VkDescriptorPool pool: usedPools){
+        vkResetDescriptorPool(device, pool, 0);
+        freePools.push_back(pool);
+    }
+    usedPools.clear();
+    currentPool = VK_NULL_HANDLE;
+    currentPoolSetCount = 0;
+    allocatedSetCount = 0;
+}
+
+void DescriptorAllocator::destroy(){
+    for(VkDescriptorPool pool: usedPools){
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    for(VkDescriptorPool pool: freePools){
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    usedPools.clear();
+    freePools.clear();
+    currentPool = VK_NULL_HANDLE;
+    currentPoolSetCount = 0;
+    allocatedSetCount = 0;
+}
+
+uint32_t DescriptorAllocator::getAllocatedSetCount(){
+    return allocatedSetCount;
+}
+
+uint32_t DescriptorAllocator::getPoolCount(){
+    return static_cast<uint32_t>(usedPools.size() + freePools.size());
+}
+
+// Make a reset pool (or a new one if there is none) the current pool
+void DescriptorAllocator::nextPool(){
+    if(!freePools.empty()){
+        currentPool = freePools.back();
+        freePools.pop_back();
+    }else{
+        currentPool = createPool();
+    }
+    usedPools.push_back(currentPool);
+    currentPoolSetCount = 0;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(){
+    // Type of descriptors + how many DESCRIPTORS, not Descriptor Sets (combined makes the pool size)
+    std::vector<VkDescriptorPoolSize> poolSizes = descriptorsPerSet;
+    for(VkDescriptorPoolSize &poolSize: poolSizes){
+        poolSize.descriptorCount *= setsPerPool;
+    }
+    
+    // Data to create Descriptor pool
+    VkDescriptorPoolCreateInfo poolCreateInfo = {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.maxSets = setsPerPool;                                           // Maximum number of descriptor sets that can be created from pool
+    poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());         // Amount of pool sizes being passed
+    poolCreateInfo.pPoolSizes = poolSizes.data();                                   // Pool sizes to create pool with
+    
+    VkDescriptorPool pool;
+    VkResult result = vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &pool);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create a Descriptor Pool!");
+    }
+    return pool;
+}
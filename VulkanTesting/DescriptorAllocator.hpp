@@ -0,0 +1,51 @@
+//
+//  DescriptorAllocator.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 17/06/21.
+//
+
+#ifndef DescriptorAllocator_hpp
+#define DescriptorAllocator_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "Utilities.h"
+
+// Allocates descriptor sets from a chain of pools, creating a new pool whenever the current one is full
+// - Every pool holds setsPerPool sets, with descriptorsPerSet of each type for every set
+// - reset() recycles all pools at once (for sets that only live for one frame)
+class DescriptorAllocator{
+public:
+    DescriptorAllocator();
+    ~DescriptorAllocator();
+    
+    void init(VkDevice newDevice, uint32_t newSetsPerPool, const std::vector<VkDescriptorPoolSize> &newDescriptorsPerSet);
+    
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+    void reset();
+    void destroy();
+    
+    uint32_t getAllocatedSetCount();
+    uint32_t getPoolCount();
+
+private:
+    VkDevice device;
+    uint32_t setsPerPool;
+    std::vector<VkDescriptorPoolSize> descriptorsPerSet;
+    
+    VkDescriptorPool currentPool = VK_NULL_HANDLE;
+    uint32_t currentPoolSetCount = 0;                   // Sets allocated from current pool
+    std::vector<VkDescriptorPool> usedPools;            // Pools with sets allocated (including current pool)
+    std::vector<VkDescriptorPool> freePools;            // Reset pools ready for reuse
+    uint32_t allocatedSetCount = 0;
+    
+    void nextPool();
+    VkDescriptorPool createPool();
+};
+
+#endif /* DescriptorAllocator_hpp */
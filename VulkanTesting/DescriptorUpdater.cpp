@@ -0,0 +1,139 @@
+//
+//  DescriptorUpdater.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 17/06/21.
+//
+
+#include "DescriptorUpdater.hpp"
+
+DescriptorUpdater::DescriptorUpdater(){
+
+}
+
+DescriptorUpdater::~DescriptorUpdater(){
+
+}
+
+// Extensions must have been enabled on the device by the caller (push descriptors need templates too)
+void DescriptorUpdater::init(VkDevice newDevice, bool newTemplatesSupported, bool newPushDescriptorsSupported){
+    device = newDevice;
+    templatesSupported = newTemplatesSupported;
+    pushDescriptorsSupported = newTemplatesSupported && newPushDescriptorsSupported;
+    
+    if(templatesSupported){
+        createDescriptorUpdateTemplate = (PFN_vkCreateDescriptorUpdateTemplateKHR) vkGetDeviceProcAddr(device, "vkCreateDescriptorUpdateTemplateKHR");
+        destroyDescriptorUpdateTemplate = (PFN_vkDestroyDescriptorUpdateTemplateKHR) vkGetDeviceProcAddr(device, "vkDestroyDescriptorUpdateTemplateKHR");
+        updateDescriptorSetWithTemplate = (PFN_vkUpdateDescriptorSetWithTemplateKHR) vkGetDeviceProcAddr(device, "vkUpdateDescriptorSetWithTemplateKHR");
+        templatesSupported = createDescriptorUpdateTemplate != nullptr && destroyDescriptorUpdateTemplate != nullptr && updateDescriptorSetWithTemplate != nullptr;
+    }
+    if(pushDescriptorsSupported){
+        cmdPushDescriptorSetWithTemplate = (PFN_vkCmdPushDescriptorSetWithTemplateKHR) vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetWithTemplateKHR");
+        pushDescriptorsSupported = templatesSupported && cmdPushDescriptorSetWithTemplate != nullptr;
+    }
+}
+
+// Template for updating descriptor sets of given layout
+DescriptorTemplate DescriptorUpdater::createTemplate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntryKHR> &entries){
+    return addTemplate(layout, entries, VK_NULL_HANDLE, 0, false);
+}
+
+// Template for pushing set number "set" of pipeline layout (layout must be created with VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR)
+DescriptorTemplate DescriptorUpdater::createPushTemplate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntryKHR> &entries,
+                                                         VkPipelineLayout pipelineLayout, uint32_t set){
+    if(!pushDescriptorsSupported){
+        throw std::runtime_error("Push descriptors are not supported by device!");
+    }
+    return addTemplate(layout, entries, pipelineLayout, set, true);
+}
+
+void DescriptorUpdater::update(VkDescriptorSet descriptorSet, DescriptorTemplate descriptorTemplate, const void *data){
+    const UpdateTemplate &updateTemplate = templates.at(descriptorTemplate);
+    
+    if(updateTemplate.handle != VK_NULL_HANDLE){
+        updateDescriptorSetWithTemplate(device, descriptorSet, updateTemplate.handle, data);
+        return;
+    }
+    
+    // No template support: same entries as regular descriptor writes
+    std::vector<VkWriteDescriptorSet> setWrites;
+    for(const VkDescriptorUpdateTemplateEntryKHR &entry: updateTemplate.entries){
+        for(uint32_t i=0; i<entry.descriptorCount; i++){
+            const char *info = static_cast<const char *>(data) + entry.offset + i * entry.stride;
+            
+            VkWriteDescriptorSet setWrite = {};
+            setWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            setWrite.dstSet = descriptorSet;                                    // Descriptor set to update
+            setWrite.dstBinding = entry.dstBinding;                             // Binding to update (matches with binding on layout/shader)
+            setWrite.dstArrayElement = entry.dstArrayElement + i;               // Index in array to update
+            setWrite.descriptorType = entry.descriptorType;                     // Type of descriptor (should match with type of descriptor set)
+            setWrite.descriptorCount = 1;                                       // Amount to update
+            
+            switch(entry.descriptorType){
+                case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+                case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+                case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+                    setWrite.pBufferInfo = reinterpret_cast<const VkDescriptorBufferInfo *>(info);
+                    break;
+                default:
+                    setWrite.pImageInfo = reinterpret_cast<const VkDescriptorImageInfo *>(info);
+                    break;
+            }
+            setWrites.push_back(setWrite);
+        }
+    }
+    
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+}
+
+// Write descriptors of a push template into command buffer, used by following draws (no descriptor set to allocate or bind)
+void DescriptorUpdater::push(VkCommandBuffer commandBuffer, DescriptorTemplate descriptorTemplate, const void *data){
+    const UpdateTemplate &updateTemplate = templates.at(descriptorTemplate);
+    if(!updateTemplate.push){
+        throw std::runtime_error("Descriptor template is not a push template!");
+    }
+    cmdPushDescriptorSetWithTemplate(commandBuffer, updateTemplate.handle, updateTemplate.pipelineLayout, updateTemplate.set, data);
+}
+
+bool DescriptorUpdater::hasPushDescriptors(){
+    return pushDescriptorsSupported;
+}
+
+void DescriptorUpdater::destroy(){
+    for(UpdateTemplate &updateTemplate: templates){
+        if(updateTemplate.handle != VK_NULL_HANDLE){
+            destroyDescriptorUpdateTemplate(device, updateTemplate.handle, nullptr);
+        }
+    }
+    templates.clear();
+}
+
+DescriptorTemplate DescriptorUpdater::addTemplate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntryKHR> &entries,
+                                                  VkPipelineLayout pipelineLayout, uint32_t set, bool push){
+    UpdateTemplate updateTemplate = {};
+    updateTemplate.handle = VK_NULL_HANDLE;
+    updateTemplate.entries = entries;
+    updateTemplate.pipelineLayout = pipelineLayout;
+    updateTemplate.set = set;
+    updateTemplate.push = push;
+    
+    if(templatesSupported){
+        VkDescriptorUpdateTemplateCreateInfoKHR templateCreateInfo = {};
+        templateCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+        templateCreateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+        templateCreateInfo.pDescriptorUpdateEntries = entries.data();
+        templateCreateInfo.templateType = push ? VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR : VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+        templateCreateInfo.descriptorSetLayout = layout;                        // Layout of sets updated (ignored for push templates)
+        templateCreateInfo.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS; // Push templates only
+        templateCreateInfo.pipelineLayout = pipelineLayout;                     // Push templates only
+        templateCreateInfo.set = set;                                           // Push templates only
+        
+        VkResult result = createDescriptorUpdateTemplate(device, &templateCreateInfo, nullptr, &updateTemplate.handle);
+        if(result != VK_SUCCESS){
+            throw std::runtime_error("Failed to create a Descriptor Update Template!");
+        }
+    }
+    
+    templates.push_back(updateTemplate);
+    return static_cast<DescriptorTemplate>(templates.size() - 1);
+}
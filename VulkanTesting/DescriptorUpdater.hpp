@@ -0,0 +1,67 @@
+//
+//  DescriptorUpdater.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 17/06/21.
+//
+
+#ifndef DescriptorUpdater_hpp
+#define DescriptorUpdater_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "Utilities.h"
+
+// Index of an update template in DescriptorUpdater
+typedef uint32_t DescriptorTemplate;
+
+// Writes descriptors from a plain struct laid out as described by a template's entries (offset/stride of each binding's
+// VkDescriptorBufferInfo / VkDescriptorImageInfo), so updates don't need VkWriteDescriptorSet arrays built by hand
+// - Uses VK_KHR_descriptor_update_template when the device has it, otherwise turns entries into vkUpdateDescriptorSets writes
+// - Push templates write straight into the command buffer (VK_KHR_push_descriptor), no descriptor set needed
+class DescriptorUpdater{
+public:
+    DescriptorUpdater();
+    ~DescriptorUpdater();
+    
+    void init(VkDevice newDevice, bool newTemplatesSupported, bool newPushDescriptorsSupported);
+    
+    DescriptorTemplate createTemplate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntryKHR> &entries);
+    DescriptorTemplate createPushTemplate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntryKHR> &entries,
+                                          VkPipelineLayout pipelineLayout, uint32_t set);
+    
+    void update(VkDescriptorSet descriptorSet, DescriptorTemplate descriptorTemplate, const void *data);
+    void push(VkCommandBuffer commandBuffer, DescriptorTemplate descriptorTemplate, const void *data);
+    
+    bool hasPushDescriptors();
+    void destroy();
+
+private:
+    struct UpdateTemplate{
+        VkDescriptorUpdateTemplateKHR handle;                   // VK_NULL_HANDLE if templates aren't supported
+        std::vector<VkDescriptorUpdateTemplateEntryKHR> entries;
+        VkPipelineLayout pipelineLayout;                        // Push templates only
+        uint32_t set;
+        bool push;
+    };
+    
+    VkDevice device;
+    bool templatesSupported = false;
+    bool pushDescriptorsSupported = false;
+    std::vector<UpdateTemplate> templates;
+    
+    // Extension functions (loaded from device)
+    PFN_vkCreateDescriptorUpdateTemplateKHR createDescriptorUpdateTemplate = nullptr;
+    PFN_vkDestroyDescriptorUpdateTemplateKHR destroyDescriptorUpdateTemplate = nullptr;
+    PFN_vkUpdateDescriptorSetWithTemplateKHR updateDescriptorSetWithTemplate = nullptr;
+    PFN_vkCmdPushDescriptorSetWithTemplateKHR cmdPushDescriptorSetWithTemplate = nullptr;
+    
+    DescriptorTemplate addTemplate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorUpdateTemplateEntryKHR> &entries,
+                                   VkPipelineLayout pipelineLayout, uint32_t set, bool push);
+};
+
+#endif /* DescriptorUpdater_hpp */
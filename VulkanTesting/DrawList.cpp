@@ -0,0 +1,180 @@
+//
+//  DrawList.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 18/06/21.
+//
+
+#include "DrawList.hpp"
+
+DrawList::DrawList(){
+
+}
+
+DrawList::~DrawList(){
+
+}
+
+// Start a new frame (storage is kept, so a frame of the same size doesn't allocate)
+void DrawList::clear(){
+    packets.clear();
+    entries.clear();
+    depths.clear();
+}
+
+// depth: distance from camera between 0 (near plane) and 1 (far plane)
+void DrawList::add(const DrawPacket &packet, float depth){
+    // Ids wrap when there are more objects than bits, which only makes sorting less effective, recording compares real handles
+    uint64_t pipelineId = packet.pipelineId & 0xFF;
+    uint64_t textureId = packet.textureId & 0xFFFF;
+    uint64_t geometryId = packet.geometryId & 0xFFFF;
+    uint64_t depthBits = static_cast<uint64_t>(glm::clamp(depth, 0.0f, 1.0f) * 0xFFFFFF);
+    
+    SortEntry entry = {};
+    entry.key = (pipelineId << 56) | (textureId << 40) | (geometryId << 24) | depthBits;
+    entry.packet = static_cast<uint32_t>(packets.size());
+    
+    packets.push_back(packet);
+    entries.push_back(entry);
+    depths.push_back(depth);
+}
+
+// LSD radix sort of keys, 8 bits per pass, skipping bytes that are the same in every key
+void DrawList::sort(){
+    if(order == DRAW_ORDER_FRONT_TO_BACK){
+        sortByDepth();
+        return;
+    }
+    
+    sortBuffer.resize(entries.size());
+    
+    for(uint32_t shift=0; shift<64; shift+=8){
+        uint32_t counts[256] = {};
+        for(const SortEntry &entry: entries){
+            counts[(entry.key >> shift) & 0xFF]++;
+        }
+        if(counts[(entries.empty() ? 0 : entries[0].key >> shift) & 0xFF] == entries.size()){
+            continue;               // Pass wouldn't change order
+        }
+        
+        // Start of each bucket in output
+        uint32_t offsets[256];
+        uint32_t offset = 0;
+        for(uint32_t i=0; i<256; i++){
+            offsets[i] = offset;
+            offset += counts[i];
+        }
+        
+        for(const SortEntry &entry: entries){
+            sortBuffer[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+        }
+        entries.swap(sortBuffer);
+    }
+}
+
+// Record draws in sorted order, only binding state that differs from the previous draw
+void DrawList::record(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const std::vector<glm::mat4> &transforms){
+    stats = {};
+    
+    VkPipeline currentPipeline = VK_NULL_HANDLE;
+    VkDescriptorSet currentTextureSet = VK_NULL_HANDLE;
+    VkBuffer currentVertexBuffer = VK_NULL_HANDLE;
+    VkBuffer currentIndexBuffer = VK_NULL_HANDLE;
+    uint32_t currentTransform = UINT32_MAX;
+    
+    for(const SortEntry &entry: entries){
+        const DrawPacket &packet = packets[entry.packet];
+        if(packet.culled){
+            stats.culledCount++;
+            continue;
+        }
+        
+        if(packet.pipeline != currentPipeline){
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline);
+            currentPipeline = packet.pipeline;
+            stats.bindCount++;
+        }
+        if(packet.transformIndex != currentTransform){
+            // "Push" constants to give shader stage directly (no buffer)
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &transforms[packet.transformIndex]);
+            currentTransform = packet.transformIndex;
+            stats.bindCount++;
+        }
+        if(packet.vertexBuffer != currentVertexBuffer){
+            VkDeviceSize offsets[] = { 0 };                                         // Offsets into buffer being bound
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &packet.vertexBuffer, offsets);
+            currentVertexBuffer = packet.vertexBuffer;
+            stats.bindCount++;
+        }
+        if(packet.indexBuffer != currentIndexBuffer){
+            vkCmdBindIndexBuffer(commandBuffer, packet.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+            currentIndexBuffer = packet.indexBuffer;
+            stats.bindCount++;
+        }
+        if(packet.textureSet != currentTextureSet && packet.textureSet != VK_NULL_HANDLE){
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &packet.textureSet, 0, nullptr);
+            currentTextureSet = packet.textureSet;
+            stats.bindCount++;
+        }
+        
+        if(packet.indirectBuffer != VK_NULL_HANDLE){
+            for(uint32_t first=0; first<packet.indirectDrawCount; first+=maxIndirectDrawCount){
+                uint32_t count = std::min(packet.indirectDrawCount - first, maxIndirectDrawCount);
+                vkCmdDrawIndexedIndirect(commandBuffer, packet.indirectBuffer, packet.indirectOffset + first * sizeof(VkDrawIndexedIndirectCommand),
+                                         count, sizeof(VkDrawIndexedIndirectCommand));
+            }
+            stats.drawCount += packet.indirectDrawCount;
+        }else{
+            vkCmdDrawIndexed(commandBuffer, packet.indexCount, 1, packet.firstIndex, packet.vertexOffset, 0);
+            stats.drawCount++;
+        }
+        stats.packetCount++;
+        stats.triangleCount += packet.indexCount / 3;
+    }
+    
+    // Without filtering every packet would bind all 5 pieces of state
+    stats.savedBindCount = stats.packetCount * 5 - stats.bindCount;
+}
+
+size_t DrawList::getDrawCount(){
+    return packets.size();
+}
+
+DrawListStats DrawList::getStats(){
+    return stats;
+}
+
+// Takes effect from next sort
+void DrawList::setOrder(DrawOrder newOrder){
+    order = newOrder;
+}
+
+// Larger indirect draws are split (count: 1, or VkPhysicalDeviceLimits::maxDrawIndirectCount with multiDrawIndirect enabled)
+void DrawList::setMaxIndirectDrawCount(uint32_t count){
+    maxIndirectDrawCount = std::max(count, 1u);
+}
+
+// Insertion sort by depth, starting from last frame's order (packets are expected to be added in the same order every frame):
+// while the camera moves smoothly only a few draws change place, so this stays close to linear time
+void DrawList::sortByDepth(){
+    if(depthOrder.size() != packets.size()){
+        depthOrder.resize(packets.size());
+        for(uint32_t i=0; i<depthOrder.size(); i++){
+            depthOrder[i] = i;
+        }
+    }
+    
+    for(size_t i=1; i<depthOrder.size(); i++){
+        uint32_t packet = depthOrder[i];
+        size_t j = i;
+        while(j > 0 && depths[depthOrder[j - 1]] > depths[packet]){
+            depthOrder[j] = depthOrder[j - 1];
+            j--;
+        }
+        depthOrder[j] = packet;
+    }
+    
+    for(size_t i=0; i<entries.size(); i++){
+        entries[i].packet = depthOrder[i];
+    }
+}
@@ -0,0 +1,92 @@
+//
+//  DrawList.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 18/06/21.
+//
+
+#ifndef DrawList_hpp
+#define DrawList_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "Utilities.h"
+
+// One indexed draw (or indirect draws of parts of a mesh) and the state it needs
+struct DrawPacket{
+    VkPipeline pipeline;
+    VkDescriptorSet textureSet;         // Bound as set 1 (VK_NULL_HANDLE: pipeline reads no texture)
+    VkBuffer vertexBuffer;
+    VkBuffer indexBuffer;
+    uint32_t indexCount;                // Total of the indirect draws when drawn indirectly
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t transformIndex;            // Model matrix pushed as push constant, index into transforms given to record
+    VkBuffer indirectBuffer;            // VkDrawIndexedIndirectCommands replacing the draw above (VK_NULL_HANDLE: direct draw)
+    VkDeviceSize indirectOffset;
+    uint32_t indirectDrawCount;
+    bool culled;                        // Hidden this frame: kept in list (so front to back order carries over) but not recorded
+    uint32_t pipelineId;                // Small ids of the state above, only used in sort keys (assigned by caller, e.g. from RenderList,
+    uint32_t textureId;                 // so adding a packet needs no lookups)
+    uint32_t geometryId;
+};
+
+// How sort orders draws
+enum DrawOrder{
+    DRAW_ORDER_STATE,                   // By sort key: fewest state changes, nearest first among draws sharing state
+    DRAW_ORDER_FRONT_TO_BACK,           // Nearest first (most early depth rejection), state changes as they fall
+};
+
+// Commands issued by last record
+struct DrawListStats{
+    uint32_t drawCount;                 // Draws issued (each draw of an indirect command counted)
+    uint32_t packetCount;               // Packets recorded (an indirect packet binds its state once however many draws it has)
+    uint32_t bindCount;                 // Pipeline, buffer, descriptor set binds and push constants issued
+    uint32_t savedBindCount;            // Binds skipped because state already matched
+    uint64_t triangleCount;
+    uint32_t culledCount;               // Packets skipped because they were culled
+};
+
+// Draws of a frame, sorted by a 64-bit key so draws sharing state are recorded next to each other
+// Key (high to low bits): pipeline (8) | texture (16) | geometry (16) | depth (24, near first)
+// or, with DRAW_ORDER_FRONT_TO_BACK, by depth alone (all draws are treated as opaque)
+class DrawList{
+public:
+    DrawList();
+    ~DrawList();
+    
+    void clear();
+    void add(const DrawPacket &packet, float depth);
+    void sort();
+    void setOrder(DrawOrder newOrder);
+    void setMaxIndirectDrawCount(uint32_t count);
+    void record(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const std::vector<glm::mat4> &transforms);
+    
+    size_t getDrawCount();
+    DrawListStats getStats();
+
+private:
+    struct SortEntry{
+        uint64_t key;
+        uint32_t packet;
+    };
+    
+    std::vector<DrawPacket> packets;
+    std::vector<SortEntry> entries;
+    std::vector<SortEntry> sortBuffer;              // Scratch space for radix sort passes
+    DrawOrder order = DRAW_ORDER_STATE;
+    uint32_t maxIndirectDrawCount = 1;              // Draws per vkCmdDrawIndexedIndirect (1 without multiDrawIndirect)
+    
+    // - Front to back
+    std::vector<float> depths;                      // Depth of each packet
+    std::vector<uint32_t> depthOrder;               // Packets nearest first, kept from last frame as starting order
+    DrawListStats stats = {};
+    
+    void sortByDepth();
+};
+
+#endif /* DrawList_hpp */
@@ -0,0 +1,307 @@
+//
+//  HiZBuffer.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 25/06/21.
+//
+
+#include "HiZBuffer.hpp"
+
+HiZBuffer::HiZBuffer(){
+
+}
+
+HiZBuffer::~HiZBuffer(){
+
+}
+
+void HiZBuffer::init(VkPhysicalDevice physicalDevice, VkDevice newDevice, VkExtent2D newDepthExtent, uint32_t newFrameCount){
+    device = newDevice;
+    depthExtent = newDepthExtent;
+    frameCount = newFrameCount;
+    
+    // Level sizes: half of the level below rounded up, so every texel below is covered
+    VkExtent2D extent = depthExtent;
+    do{
+        extent.width = (extent.width + 1) / 2;
+        extent.height = (extent.height + 1) / 2;
+        levelExtents.push_back(extent);
+    }while(extent.width > 1 || extent.height > 1);
+    
+    // CREATE PYRAMID IMAGE
+    VkImageCreateInfo imageCreateInfo = {};
+    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.extent = { levelExtents[0].width, levelExtents[0].height, 1 };
+    imageCreateInfo.mipLevels = static_cast<uint32_t>(levelExtents.size());
+    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.format = VK_FORMAT_R32_SFLOAT;                      // Storage image support is required for this format
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageCreateInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    
+    VkResult result = vkCreateImage(device, &imageCreateInfo, nullptr, &image);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create Hi-Z Image!");
+    }
+    
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+    
+    VkMemoryAllocateInfo memoryAllocInfo = {};
+    memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocInfo.allocationSize = memoryRequirements.size;
+    memoryAllocInfo.memoryTypeIndex = findMemoryTypeIndex(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    
+    result = vkAllocateMemory(device, &memoryAllocInfo, nullptr, &imageMemory);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate memory for Hi-Z Image!");
+    }
+    vkBindImageMemory(device, image, imageMemory, 0);
+    
+    // One view per level, each dispatch reads one level and writes the next
+    for(uint32_t level=0; level<levelExtents.size(); level++){
+        VkImageViewCreateInfo viewCreateInfo = {};
+        viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewCreateInfo.image = image;
+        viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewCreateInfo.format = VK_FORMAT_R32_SFLOAT;
+        viewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+        viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewCreateInfo.subresourceRange.baseMipLevel = level;
+        viewCreateInfo.subresourceRange.levelCount = 1;
+        viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+        viewCreateInfo.subresourceRange.layerCount = 1;
+        
+        VkImageView levelView;
+        result = vkCreateImageView(device, &viewCreateInfo, nullptr, &levelView);
+        if(result != VK_SUCCESS){
+            throw std::runtime_error("Failed to create Hi-Z Image View!");
+        }
+        levelViews.push_back(levelView);
+    }
+    
+    // READBACK BUFFERS
+    // Finer levels would cost more to copy and search than the draws they save
+    firstReadbackLevel = 0;
+    while(firstReadbackLevel + 1 < levelExtents.size() && levelExtents[firstReadbackLevel].width > HIZ_READBACK_WIDTH){
+        firstReadbackLevel++;
+    }
+    readbackTexelCount = 0;
+    for(uint32_t level=firstReadbackLevel; level<levelExtents.size(); level++){
+        readbackOffsets.push_back(readbackTexelCount);
+        readbackTexelCount += levelExtents[level].width * levelExtents[level].height;
+    }
+    
+    readbackBuffers.resize(frameCount);
+    readbackBufferMemory.resize(frameCount);
+    readbackPending.assign(frameCount, false);
+    readbackViewProjections.resize(frameCount);
+    for(uint32_t i=0; i<frameCount; i++){
+        createBuffer(physicalDevice, device, readbackTexelCount * sizeof(float), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &readbackBuffers[i], &readbackBufferMemory[i]);
+    }
+}
+
+// descriptorTemplate writes set's binding 0 (sampled source) & binding 1 (storage destination) from two VkDescriptorImageInfo
+void HiZBuffer::createDescriptorSets(DescriptorAllocator &allocator, DescriptorUpdater &updater, DescriptorTemplate descriptorTemplate,
+                                     VkDescriptorSetLayout setLayout, VkImageView depthView, VkSampler sampler){
+    for(uint32_t level=0; level<levelViews.size(); level++){
+        VkDescriptorImageInfo imageInfos[2] = {};
+        imageInfos[0].sampler = sampler;                                // Read with texelFetch, filtering is unused
+        imageInfos[0].imageView = level == 0 ? depthView : levelViews[level - 1];
+        imageInfos[0].imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+        imageInfos[1].imageView = levelViews[level];
+        imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        
+        VkDescriptorSet descriptorSet = allocator.allocate(setLayout);
+        updater.update(descriptorSet, descriptorTemplate, imageInfos);
+        levelDescriptorSets.push_back(descriptorSet);
+    }
+}
+
+void HiZBuffer::destroy(){
+    for(uint32_t i=0; i<readbackBuffers.size(); i++){
+        vkDestroyBuffer(device, readbackBuffers[i], nullptr);
+        vkFreeMemory(device, readbackBufferMemory[i], nullptr);
+    }
+    readbackBuffers.clear();
+    readbackBufferMemory.clear();
+    
+    for(VkImageView levelView: levelViews){
+        vkDestroyImageView(device, levelView, nullptr);
+    }
+    levelViews.clear();
+    levelDescriptorSets.clear();            // Freed with their allocator
+    
+    if(image != VK_NULL_HANDLE){
+        vkDestroyImage(device, image, nullptr);
+        vkFreeMemory(device, imageMemory, nullptr);
+        image = VK_NULL_HANDLE;
+    }
+}
+
+// Build pyramid from scene depth (left in DEPTH_STENCIL_READ_ONLY_OPTIMAL by the graph) and copy coarse levels for the host
+// Recorded outside render passes, after the frame's graph
+void HiZBuffer::record(VkCommandBuffer commandBuffer, uint32_t frame, VkPipeline pipeline, VkPipelineLayout pipelineLayout, const glm::mat4 &viewProjection){
+    // Every level is rewritten, so old contents are discarded (waits for last frame's dispatches & copy to finish with them)
+    VkImageMemoryBarrier imageBarrier = {};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = image;
+    imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageBarrier.subresourceRange.baseMipLevel = 0;
+    imageBarrier.subresourceRange.levelCount = static_cast<uint32_t>(levelExtents.size());
+    imageBarrier.subresourceRange.baseArrayLayer = 0;
+    imageBarrier.subresourceRange.layerCount = 1;
+    imageBarrier.srcAccessMask = 0;
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    
+    VkMemoryBarrier levelBarrier = {};
+    levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    
+    for(uint32_t level=0; level<levelExtents.size(); level++){
+        VkExtent2D sourceExtent = level == 0 ? depthExtent : levelExtents[level - 1];
+        HiZLevelSize levelSize = {};
+        levelSize.sourceWidth = static_cast<int32_t>(sourceExtent.width);
+        levelSize.sourceHeight = static_cast<int32_t>(sourceExtent.height);
+        levelSize.width = static_cast<int32_t>(levelExtents[level].width);
+        levelSize.height = static_cast<int32_t>(levelExtents[level].height);
+        
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &levelDescriptorSets[level], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZLevelSize), &levelSize);
+        vkCmdDispatch(commandBuffer, (levelExtents[level].width + 7) / 8, (levelExtents[level].height + 7) / 8, 1);    // 8x8 workgroups
+        
+        // Next level reads this one, the copy reads the last ones
+        bool lastLevel = level + 1 == levelExtents.size();
+        levelBarrier.dstAccessMask = lastLevel ? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, lastLevel ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &levelBarrier, 0, nullptr, 0, nullptr);
+    }
+    
+    // Coarse levels packed one after another into the frame's buffer
+    std::vector<VkBufferImageCopy> regions;
+    for(uint32_t level=firstReadbackLevel; level<levelExtents.size(); level++){
+        VkBufferImageCopy region = {};
+        region.bufferOffset = readbackOffsets[level - firstReadbackLevel] * sizeof(float);
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = { levelExtents[level].width, levelExtents[level].height, 1 };
+        regions.push_back(region);
+    }
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_GENERAL, readbackBuffers[frame], static_cast<uint32_t>(regions.size()), regions.data());
+    
+    // Make copy visible to host reads once the frame's fence signals
+    VkBufferMemoryBarrier bufferBarrier = {};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = readbackBuffers[frame];
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+    
+    readbackPending[frame] = true;
+    readbackViewProjections[frame] = viewProjection;
+}
+
+// Take frame's coarse levels as the culling pyramid (frame's fence must have signalled)
+void HiZBuffer::readResults(uint32_t frame){
+    if(readbackPending.empty() || !readbackPending[frame]){
+        return;
+    }
+    readbackPending[frame] = false;
+    
+    depths.resize(readbackTexelCount);
+    void *data;
+    vkMapMemory(device, readbackBufferMemory[frame], 0, readbackTexelCount * sizeof(float), 0, &data);
+    memcpy(depths.data(), data, readbackTexelCount * sizeof(float));
+    vkUnmapMemory(device, readbackBufferMemory[frame]);
+    
+    depthsViewProjection = readbackViewProjections[frame];
+    resultsValid = true;
+}
+
+// Forget the pyramid read so far (e.g. culling was off and later frames didn't build one), nothing is culled until the next read
+void HiZBuffer::clearResults(){
+    resultsValid = false;
+    std::fill(readbackPending.begin(), readbackPending.end(), false);
+}
+
+// Is mesh bounding box (model space) hidden behind the depth of the last pyramid read?
+// Conservative: anything crossing the near plane or reaching outside the screen rectangle counts as visible
+bool HiZBuffer::isOccluded(const glm::mat4 &model, const glm::vec3 &boundsCentre, const glm::vec3 &boundsExtent){
+    if(!resultsValid){
+        return false;
+    }
+    
+    // Screen rectangle & nearest depth of the box's corners, in the camera the pyramid was drawn with
+    glm::mat4 modelViewProjection = depthsViewProjection * model;
+    glm::vec2 minNdc(1.0f), maxNdc(-1.0f);
+    float nearestDepth = 1.0f;
+    for(int corner=0; corner<8; corner++){
+        glm::vec3 offset((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f);
+        glm::vec4 clip = modelViewProjection * glm::vec4(boundsCentre + boundsExtent * offset, 1.0f);
+        if(clip.w <= 0.0f){
+            return false;                   // Behind camera
+        }
+        glm::vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+        minNdc = glm::min(minNdc, ndc);
+        maxNdc = glm::max(maxNdc, ndc);
+        nearestDepth = std::min(nearestDepth, clip.z / clip.w);
+    }
+    if(nearestDepth < 0.0f || minNdc.x < -1.0f || minNdc.y < -1.0f || maxNdc.x > 1.0f || maxNdc.y > 1.0f){
+        return false;
+    }
+    
+    // Rectangle in depth image pixels
+    float x0 = (minNdc.x * 0.5f + 0.5f) * depthExtent.width;
+    float y0 = (minNdc.y * 0.5f + 0.5f) * depthExtent.height;
+    float x1 = (maxNdc.x * 0.5f + 0.5f) * depthExtent.width;
+    float y1 = (maxNdc.y * 0.5f + 0.5f) * depthExtent.height;
+    
+    // Level whose texels are at least as big as the rectangle, so it touches at most 2x2 of them
+    // (a texel of level L covers 2^(L+1) pixels each way)
+    float size = std::max(std::max(x1 - x0, y1 - y0), 1.0f);
+    uint32_t level = static_cast<uint32_t>(std::max(0.0f, std::ceil(std::log2(size)) - 1.0f));
+    level = std::min(std::max(level, firstReadbackLevel), static_cast<uint32_t>(levelExtents.size()) - 1);
+    
+    uint32_t shift = level + 1;
+    float maxDepth = getMaxDepth(level, static_cast<uint32_t>(x0) >> shift, static_cast<uint32_t>(y0) >> shift,
+                                 static_cast<uint32_t>(x1) >> shift, static_cast<uint32_t>(y1) >> shift);
+    return nearestDepth > maxDepth;
+}
+
+uint32_t HiZBuffer::getLevelCount(){
+    return static_cast<uint32_t>(levelExtents.size());
+}
+
+// Farthest depth of texels x0..x1, y0..y1 (inclusive, clamped to the level) of a read back level
+float HiZBuffer::getMaxDepth(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1){
+    const VkExtent2D &extent = levelExtents[level];
+    const float *levelDepths = depths.data() + readbackOffsets[level - firstReadbackLevel];
+    x1 = std::min(x1, extent.width - 1);
+    y1 = std::min(y1, extent.height - 1);
+    
+    float maxDepth = 0.0f;
+    for(uint32_t y=std::min(y0, y1); y<=y1; y++){
+        for(uint32_t x=std::min(x0, x1); x<=x1; x++){
+            maxDepth = std::max(maxDepth, levelDepths[y * extent.width + x]);
+        }
+    }
+    return maxDepth;
+}
@@ -0,0 +1,83 @@
+//
+//  HiZBuffer.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 25/06/21.
+//
+
+#ifndef HiZBuffer_hpp
+#define HiZBuffer_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "Utilities.h"
+#include "DescriptorAllocator.hpp"
+#include "DescriptorUpdater.hpp"
+
+// Push constants of hiz.comp
+struct HiZLevelSize{
+    int32_t sourceWidth;
+    int32_t sourceHeight;
+    int32_t width;
+    int32_t height;
+};
+
+// Hierarchical-Z pyramid of scene depth, built by a compute shader after the frame's graph
+// - Level 0 is half the depth image size (rounded up), every level halves again down to 1x1
+// - Each texel is the farthest depth of the area it covers, so geometry nearer than that may be visible, anything farther is hidden
+// - Coarse levels (HIZ_READBACK_WIDTH wide and smaller) are copied to host once the frame's fence signals, meshes are tested
+//   on the CPU against the pyramid of the last finished frame (MAX_FRAME_DRAWS frames old), projected with that frame's camera
+class HiZBuffer{
+public:
+    HiZBuffer();
+    ~HiZBuffer();
+    
+    void init(VkPhysicalDevice physicalDevice, VkDevice newDevice, VkExtent2D newDepthExtent, uint32_t newFrameCount);
+    void createDescriptorSets(DescriptorAllocator &allocator, DescriptorUpdater &updater, DescriptorTemplate descriptorTemplate,
+                              VkDescriptorSetLayout setLayout, VkImageView depthView, VkSampler sampler);
+    void destroy();
+    
+    void record(VkCommandBuffer commandBuffer, uint32_t frame, VkPipeline pipeline, VkPipelineLayout pipelineLayout, const glm::mat4 &viewProjection);
+    void readResults(uint32_t frame);
+    void clearResults();
+    
+    bool isOccluded(const glm::mat4 &model, const glm::vec3 &boundsCentre, const glm::vec3 &boundsExtent);
+    uint32_t getLevelCount();
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VkExtent2D depthExtent = {};
+    uint32_t frameCount = 0;
+    
+    // - Pyramid
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+    std::vector<VkImageView> levelViews;                // One view per mip level (written as storage image, read by next level)
+    std::vector<VkExtent2D> levelExtents;
+    std::vector<VkDescriptorSet> levelDescriptorSets;   // Source & destination of each level's dispatch
+    
+    // - Readback
+    uint32_t firstReadbackLevel = 0;
+    std::vector<VkDeviceSize> readbackOffsets;          // Offset (in texels) of each read back level, from firstReadbackLevel
+    VkDeviceSize readbackTexelCount = 0;
+    std::vector<VkBuffer> readbackBuffers;              // Coarse levels of each frame in flight
+    std::vector<VkDeviceMemory> readbackBufferMemory;
+    std::vector<bool> readbackPending;                  // Copy recorded for frame, not read yet
+    std::vector<glm::mat4> readbackViewProjections;     // Camera the frame's depth was drawn with
+    
+    // - Last finished frame's coarse levels
+    bool resultsValid = false;
+    std::vector<float> depths;
+    glm::mat4 depthsViewProjection;
+    
+    float getMaxDepth(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+};
+
+#endif /* HiZBuffer_hpp */
@@ -0,0 +1,89 @@
+//
+//  LoadProfiler.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 22/06/21.
+//
+
+#include "LoadProfiler.hpp"
+
+LoadProfiler::LoadProfiler(){
+    reset();
+}
+
+LoadProfiler::~LoadProfiler(){
+
+}
+
+// Start stage, pausing the stage it is nested in
+void LoadProfiler::begin(LoadStage stage){
+    if(!activeStages.empty()){
+        accumulate(activeStages.back());
+    }
+    
+    ActiveStage active = {};
+    active.stage = stage;
+    active.start = std::chrono::steady_clock::now();
+    active.allocationsAtStart = getAllocationCount();
+    activeStages.push_back(active);
+}
+
+// End innermost stage, resuming the stage it is nested in
+void LoadProfiler::end(uint64_t bytes){
+    if(activeStages.empty()){
+        return;
+    }
+    
+    ActiveStage &active = activeStages.back();
+    accumulate(active);
+    stats[active.stage].calls++;
+    stats[active.stage].bytes += bytes;
+    activeStages.pop_back();
+    
+    if(!activeStages.empty()){
+        activeStages.back().start = std::chrono::steady_clock::now();
+        activeStages.back().allocationsAtStart = getAllocationCount();
+    }
+}
+
+// Clear totals (and stages left open by a load that threw)
+void LoadProfiler::reset(){
+    stats.fill(LoadStageStats());
+    activeStages.clear();
+}
+
+void LoadProfiler::setAllocationCounter(std::function<uint64_t()> counter){
+    allocationCounter = counter;
+}
+
+LoadStageStats LoadProfiler::getStats(LoadStage stage){
+    return stats[stage];
+}
+
+const char *LoadProfiler::getStageName(LoadStage stage){
+    static const char *stageNames[LOAD_STAGE_COUNT] = {
+        "file_check",
+        "import",
+        "materials",
+        "texture_decode",
+        "mesh_conversion",
+        "meshlet_build",
+        "lod_generation",
+        "upload",
+    };
+    return stageNames[stage];
+}
+
+uint64_t LoadProfiler::getAllocationCount(){
+    return allocationCounter ? allocationCounter() : 0;
+}
+
+// Add time & allocations since stage (re)started
+void LoadProfiler::accumulate(ActiveStage &active){
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    uint64_t allocations = getAllocationCount();
+    stats[active.stage].time += std::chrono::duration<double, std::milli>(now - active.start).count();
+    stats[active.stage].allocations += allocations - active.allocationsAtStart;
+    active.start = now;
+    active.allocationsAtStart = allocations;
+}
@@ -0,0 +1,69 @@
+//
+//  LoadProfiler.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 22/06/21.
+//
+
+#ifndef LoadProfiler_hpp
+#define LoadProfiler_hpp
+
+#include <vector>
+#include <array>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+// Steps of loading a model or texture file
+enum LoadStage{
+    LOAD_STAGE_FILE_CHECK,              // Opening file to check it exists
+    LOAD_STAGE_IMPORT,                  // Assimp::Importer::ReadFile
+    LOAD_STAGE_MATERIALS,               // MeshModel::LoadMaterials
+    LOAD_STAGE_TEXTURE_DECODE,          // stbi_load
+    LOAD_STAGE_MESH_CONVERSION,         // MeshModel::LoadNode/LoadMesh, aiMesh to Vertex & index lists
+    LOAD_STAGE_MESHLET_BUILD,           // MeshletBuilder::buildMeshlets
+    LOAD_STAGE_LOD_GENERATION,          // MeshSimplifier::buildLodChain
+    LOAD_STAGE_UPLOAD,                  // Staging buffers & copies to device local buffers/images
+    LOAD_STAGE_COUNT
+};
+
+// Totals of one stage since last reset
+struct LoadStageStats{
+    uint32_t calls;
+    double time;                        // Milliseconds, excluding stages nested inside (e.g. uploads during mesh conversion)
+    uint64_t bytes;                     // Data the stage read or produced
+    uint64_t allocations;               // Heap allocations, only counted when an allocation counter is set
+};
+
+// Accumulates time, bytes & allocations of each load stage
+// Stages may nest, time and allocations of a nested stage are only counted for the nested stage
+class LoadProfiler{
+public:
+    LoadProfiler();
+    ~LoadProfiler();
+    
+    void begin(LoadStage stage);
+    void end(uint64_t bytes = 0);
+    void reset();
+    
+    void setAllocationCounter(std::function<uint64_t()> counter);
+    LoadStageStats getStats(LoadStage stage);
+    
+    static const char *getStageName(LoadStage stage);
+
+private:
+    struct ActiveStage{
+        LoadStage stage;
+        std::chrono::steady_clock::time_point start;
+        uint64_t allocationsAtStart;
+    };
+    
+    std::array<LoadStageStats, LOAD_STAGE_COUNT> stats;
+    std::vector<ActiveStage> activeStages;          // Innermost last
+    std::function<uint64_t()> allocationCounter;    // Total allocations made by the process so far
+    
+    uint64_t getAllocationCount();
+    void accumulate(ActiveStage &active);
+};
+
+#endif /* LoadProfiler_hpp */
@@ -11,9 +11,13 @@ Mesh::Mesh(){
     
 }
 
-Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice,VkQueue transferQueue,VkCommandPool transferCommandPool, std::vector<Vertex> *vertices, std::vector<uint32_t> *indices, int newTexId){
+// indices: every level of detail in lods (from MeshSimplifier::buildLodChain), all of them are uploaded
+// meshlets: from MeshletBuilder::buildMeshlets, which ordered the full detail level's triangles
+Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice,VkQueue transferQueue,VkCommandPool transferCommandPool, std::vector<Vertex> *vertices, std::vector<uint32_t> *indices, const std::vector<MeshLod> &newLods, const std::vector<Meshlet> &newMeshlets, int newTexId){
     vertexCount = vertices->size();
-    indexCount = indices->size();
+    lods = newLods;
+    meshlets = newMeshlets;
+    indexCount = lods[0].indexCount;
     physicalDevice = newPhysicalDevice;
     device = newDevice;
     createVertexBuffer(transferQueue, transferCommandPool, vertices);
@@ -21,6 +25,15 @@ Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice,VkQueue transf
     
     model.model = glm::mat4(1.0f);
     texId = newTexId;
+    
+    // Bounding box of vertices (for sorting draws by distance & occlusion culling)
+    glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+    for(size_t i=0; i<vertices->size(); i++){
+        boundsMin = i == 0 ? (*vertices)[i].pos : glm::min(boundsMin, (*vertices)[i].pos);
+        boundsMax = i == 0 ? (*vertices)[i].pos : glm::max(boundsMax, (*vertices)[i].pos);
+    }
+    boundsCentre = (boundsMin + boundsMax) * 0.5f;
+    boundsExtent = (boundsMax - boundsMin) * 0.5f;
 }
 
 int Mesh::getVertexCount(){
@@ -31,6 +44,14 @@ VkBuffer Mesh::getVertexBuffer(){
     return vertexBuffer;
 }
 
+glm::vec3 Mesh::getBoundsCentre(){
+    return boundsCentre;
+}
+
+glm::vec3 Mesh::getBoundsExtent(){
+    return boundsExtent;
+}
+
 Mesh::~Mesh(){
     
 }
@@ -108,6 +129,14 @@ VkBuffer Mesh::getIndexBuffer(){
     return indexBuffer;
 }
 
+const std::vector<MeshLod> &Mesh::getLods(){
+    return lods;
+}
+
+const std::vector<Meshlet> &Mesh::getMeshlets(){
+    return meshlets;
+}
+
 void Mesh::setModel(glm::mat4 newModel){
     model.model = newModel;
 }
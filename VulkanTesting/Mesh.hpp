@@ -14,15 +14,24 @@
 #include <vector>
 
 #include "Utilities.h"
+#include "MeshSimplifier.hpp"
+#include "MeshletBuilder.hpp"
 
 struct Model{
     glm::mat4 model;
 };
 
+// Geometry generated at runtime (instead of imported from a model file)
+struct MeshData{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    int textureId;                      // From createTexture, 0 for default texture
+};
+
 class Mesh{
 public:
     Mesh();
-    Mesh(VkPhysicalDevice physicalDevice, VkDevice newDevice,VkQueue transferQueue,VkCommandPool transferCommandPool, std::vector<Vertex> *vertices, std::vector<uint32_t> *indices, int newTexId);
+    Mesh(VkPhysicalDevice physicalDevice, VkDevice newDevice,VkQueue transferQueue,VkCommandPool transferCommandPool, std::vector<Vertex> *vertices, std::vector<uint32_t> *indices, const std::vector<MeshLod> &newLods, const std::vector<Meshlet> &newMeshlets, int newTexId);
     
     void setModel(glm::mat4 newModel);
     Model getModel();
@@ -34,6 +43,11 @@ public:
     
     int getIndexCount();
     VkBuffer getIndexBuffer();
+    const std::vector<MeshLod> &getLods();
+    const std::vector<Meshlet> &getMeshlets();
+    
+    glm::vec3 getBoundsCentre();
+    glm::vec3 getBoundsExtent();
     
     void destroyBuffers();
     
@@ -48,9 +62,14 @@ private:
     VkBuffer vertexBuffer;
     VkDeviceMemory vertexBufferMemory;
     
-    int indexCount;
-    VkBuffer indexBuffer;
+    int indexCount;                     // Of full detail level
+    VkBuffer indexBuffer;               // Indices of every level of detail, one after another
     VkDeviceMemory indexBufferMemory;
+    std::vector<MeshLod> lods;          // Full detail first, then coarser levels
+    std::vector<Meshlet> meshlets;      // Covering full detail level (empty for small meshes)
+    
+    glm::vec3 boundsCentre;             // Centre of vertex bounding box, in model space
+    glm::vec3 boundsExtent;             // Half size of vertex bounding box
     
     VkPhysicalDevice physicalDevice;
     VkDevice device;
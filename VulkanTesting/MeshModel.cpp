@@ -12,6 +12,12 @@ MeshModel::MeshModel(std::vector<Mesh> newMeshList){
     model = glm::mat4(1.0f);
 }
 
+MeshModel::MeshModel(std::vector<Mesh> newMeshList, std::string newCacheKey){
+    meshList = newMeshList;
+    model = glm::mat4(1.0f);
+    cacheKey = newCacheKey;
+}
+
 MeshModel::~MeshModel(){
     
 }
@@ -36,6 +42,10 @@ void MeshModel::setModel(glm::mat4 newModel){
     model = newModel;
 }
 
+std::string MeshModel::getCacheKey(){
+    return cacheKey;
+}
+
 void MeshModel::destroyMeshModel(){
     for(auto &mesh: meshList){
         mesh.destroyBuffers();
@@ -72,19 +82,19 @@ std::vector<std::string> MeshModel::LoadMaterials(const aiScene *scene){
     return textureList;
 }
 
-std::vector<Mesh> MeshModel::LoadNode(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, VkCommandPool transferCommandPool, aiNode *node, const aiScene *scene, std::vector<int> matToTex){
+std::vector<Mesh> MeshModel::LoadNode(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, VkCommandPool transferCommandPool, aiNode *node, const aiScene *scene, std::vector<int> matToTex, LoadProfiler *profiler){
     std::vector<Mesh> meshList;
     
     // Go through each Mesh at this Node and create it, then add it to our meshList
     for(size_t i=0; i<node->mNumMeshes; i++){
         // LOAD MESH HERE
         meshList.push_back(
-                           LoadMesh(newPhysicalDevice, newDevice, transferQueue, transferCommandPool, scene->mMeshes[node->mMeshes[i]], scene, matToTex));
+                           LoadMesh(newPhysicalDevice, newDevice, transferQueue, transferCommandPool, scene->mMeshes[node->mMeshes[i]], scene, matToTex, profiler));
     }
     
     // Go through each Node attached to this Node and load it, then append their meshes to this node's mesh list
     for(size_t i=0; i<node->mNumChildren; i++){
-        std::vector<Mesh> newList = LoadNode(newPhysicalDevice, newDevice, transferQueue, transferCommandPool, node->mChildren[i], scene, matToTex);
+        std::vector<Mesh> newList = LoadNode(newPhysicalDevice, newDevice, transferQueue, transferCommandPool, node->mChildren[i], scene, matToTex, profiler);
         meshList.insert(meshList.end(), newList.begin(), newList.end());
     }
     
@@ -92,7 +102,11 @@ std::vector<Mesh> MeshModel::LoadNode(VkPhysicalDevice newPhysicalDevice, VkDevi
 }
 
 
-Mesh MeshModel::LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, VkCommandPool transferCommandPool, aiMesh* mesh, const aiScene *scene, std::vector<int> matToTex){
+Mesh MeshModel::LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, VkCommandPool transferCommandPool, aiMesh* mesh, const aiScene *scene, std::vector<int> matToTex, LoadProfiler *profiler){
+    if(profiler){
+        profiler->begin(LOAD_STAGE_MESH_CONVERSION);
+    }
+    
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
     
@@ -126,8 +140,32 @@ Mesh MeshModel::LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice,
         }
     }
     
+    // Full detail triangles are regrouped into meshlets, then coarser levels of detail are appended to indices
+    if(profiler){
+        profiler->begin(LOAD_STAGE_MESHLET_BUILD);
+    }
+    std::vector<Meshlet> meshlets = MeshletBuilder::buildMeshlets(vertices, &indices);
+    if(profiler){
+        profiler->end(meshlets.size() * sizeof(Meshlet));
+        profiler->begin(LOAD_STAGE_LOD_GENERATION);
+    }
+    std::vector<MeshLod> lods = MeshSimplifier::buildLodChain(vertices, &indices);
+    if(profiler){
+        profiler->end(indices.size() * sizeof(uint32_t));
+    }
+    
+    uint64_t meshBytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t);
+    if(profiler){
+        profiler->begin(LOAD_STAGE_UPLOAD);
+    }
+    
     // Create new mesh with details and return it
-    Mesh newMesh = Mesh(newPhysicalDevice, newDevice, transferQueue, transferCommandPool, &vertices, &indices, matToTex[mesh->mMaterialIndex]);
+    Mesh newMesh = Mesh(newPhysicalDevice, newDevice, transferQueue, transferCommandPool, &vertices, &indices, lods, meshlets, matToTex[mesh->mMaterialIndex]);
+    
+    if(profiler){
+        profiler->end(meshBytes);       // Upload
+        profiler->end(meshBytes);       // Mesh conversion
+    }
     
     return newMesh;
 }
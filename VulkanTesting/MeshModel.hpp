@@ -9,15 +9,18 @@
 #define MeshModel_hpp
 
 #include <vector>
+#include <string>
 #include <glm/glm.hpp>
 #include <assimp/scene.h>
 #include "Mesh.hpp"
+#include "LoadProfiler.hpp"
 #include <stdio.h>
 
 class MeshModel{
 public:
     MeshModel();
     MeshModel(std::vector<Mesh> newMeshList);
+    MeshModel(std::vector<Mesh> newMeshList, std::string newCacheKey);
     ~MeshModel();
     
     size_t getMeshCount();
@@ -26,14 +29,17 @@ public:
     glm::mat4 getModel();
     void setModel(glm::mat4 newModel);
     
+    std::string getCacheKey();
+    
     void destroyMeshModel();
     
     static std::vector<std::string> LoadMaterials(const aiScene *scene);
-    static std::vector<Mesh> LoadNode(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, VkCommandPool transferCommandPool, aiNode* node, const aiScene* scene, std::vector<int> matToTex);
-    static Mesh LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, VkCommandPool transferCommandPool, aiMesh* mesh, const aiScene* scene, std::vector<int> matToTex);
+    static std::vector<Mesh> LoadNode(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, VkCommandPool transferCommandPool, aiNode* node, const aiScene* scene, std::vector<int> matToTex, LoadProfiler *profiler = nullptr);
+    static Mesh LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, VkCommandPool transferCommandPool, aiMesh* mesh, const aiScene* scene, std::vector<int> matToTex, LoadProfiler *profiler = nullptr);
     
 private:
     std::vector<Mesh> meshList;
     glm::mat4 model;
+    std::string cacheKey;       // Key of the ModelCache entry the meshes are shared through
 };
 #endif /* MeshModel_hpp */
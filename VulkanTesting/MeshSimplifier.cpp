@@ -0,0 +1,264 @@
+//
+//  MeshSimplifier.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 26/06/21.
+//
+
+#include "MeshSimplifier.hpp"
+
+// Full detail indices followed by each coarser level's indices (appended to indices), levels stop when a step can't
+// remove enough triangles within the error budget
+std::vector<MeshLod> MeshSimplifier::buildLodChain(const std::vector<Vertex> &vertices, std::vector<uint32_t> *indices){
+    std::vector<MeshLod> lods;
+    MeshLod fullLod = {};
+    fullLod.firstIndex = 0;
+    fullLod.indexCount = static_cast<uint32_t>(indices->size());
+    fullLod.error = 0.0f;
+    lods.push_back(fullLod);
+    if(vertices.empty() || indices->size() % 3 != 0){
+        return lods;
+    }
+    
+    // Error budget scales with mesh size
+    glm::vec3 boundsMin = vertices[0].pos, boundsMax = vertices[0].pos;
+    for(const Vertex &vertex: vertices){
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+    float maxError = MESH_LOD_MAX_ERROR * glm::length(boundsMax - boundsMin);
+    
+    // Each level simplifies the one before it, so its error is bounded by the sum of the steps' errors
+    std::vector<uint32_t> levelIndices = *indices;
+    float levelError = 0.0f;
+    while(lods.size() < MESH_LOD_MAX_LEVELS){
+        size_t targetIndexCount = static_cast<size_t>(levelIndices.size() / 3 * MESH_LOD_REDUCTION) * 3;
+        float stepError = 0.0f;
+        std::vector<uint32_t> simplified = simplify(vertices, levelIndices, targetIndexCount, maxError - levelError, &stepError);
+        
+        // Not worth a level (and its index memory) if little was removed: mostly locked vertices or error budget used up
+        if(simplified.empty() || simplified.size() > levelIndices.size() * 0.9){
+            break;
+        }
+        
+        levelError += stepError;
+        MeshLod lod = {};
+        lod.firstIndex = static_cast<uint32_t>(indices->size());
+        lod.indexCount = static_cast<uint32_t>(simplified.size());
+        lod.error = levelError;
+        indices->insert(indices->end(), simplified.begin(), simplified.end());
+        lods.push_back(lod);
+        
+        levelIndices.swap(simplified);
+    }
+    
+    return lods;
+}
+
+// Collapse edges, cheapest first, until targetIndexCount is reached or the next collapse would move the surface more than maxError
+// resultError: largest error of the collapses done
+std::vector<uint32_t> MeshSimplifier::simplify(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                               size_t targetIndexCount, float maxError, float *resultError){
+    size_t vertexCount = vertices.size();
+    std::vector<uint32_t> result = indices;
+    *resultError = 0.0f;
+    if(maxError <= 0.0f){
+        return result;
+    }
+    
+    // Lock vertices on open edges (edges used by one triangle): these include UV/normal seams,
+    // where neighbouring triangles use different vertices at the same position
+    std::vector<uint64_t> edges;
+    for(size_t i=0; i<result.size(); i+=3){
+        for(size_t e=0; e<3; e++){
+            uint64_t a = result[i + e], b = result[i + (e + 1) % 3];
+            edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    std::vector<bool> locked(vertexCount, false);
+    for(size_t i=0; i<edges.size();){
+        size_t j = i + 1;
+        while(j < edges.size() && edges[j] == edges[i]){
+            j++;
+        }
+        if(j - i == 1){
+            locked[edges[i] >> 32] = true;
+            locked[edges[i] & 0xffffffff] = true;
+        }
+        i = j;
+    }
+    
+    // Each vertex starts with the planes of the triangles around it
+    std::vector<Quadric> quadrics(vertexCount, Quadric());
+    for(size_t i=0; i<result.size(); i+=3){
+        const glm::vec3 &p0 = vertices[result[i]].pos;
+        glm::vec3 normal = glm::cross(vertices[result[i + 1]].pos - p0, vertices[result[i + 2]].pos - p0);
+        float length = glm::length(normal);
+        if(length == 0.0f){
+            continue;                   // Degenerate triangle has no plane
+        }
+        normal /= length;
+        Quadric plane = planeQuadric(normal, -glm::dot(normal, p0));
+        for(size_t j=0; j<3; j++){
+            addQuadric(&quadrics[result[i + j]], plane);
+        }
+    }
+    
+    double maxCost = (double) maxError * maxError;
+    double worstCost = 0.0;
+    
+    // Passes of independent collapses (no two touch the same triangles), adjacency is rebuilt between passes
+    while(result.size() > targetIndexCount){
+        // Triangles around each vertex
+        std::vector<uint32_t> triangleStart(vertexCount + 1, 0);
+        for(uint32_t index: result){
+            triangleStart[index + 1]++;
+        }
+        for(size_t i=0; i<vertexCount; i++){
+            triangleStart[i + 1] += triangleStart[i];
+        }
+        std::vector<uint32_t> triangles(result.size());
+        std::vector<uint32_t> cursor(triangleStart.begin(), triangleStart.end() - 1);
+        for(size_t i=0; i<result.size(); i++){
+            triangles[cursor[result[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+        
+        // Both directions of every edge, moving an unlocked vertex onto its neighbour
+        std::vector<Collapse> collapses;
+        for(size_t i=0; i<result.size(); i+=3){
+            for(size_t e=0; e<3; e++){
+                uint32_t a = result[i + e], b = result[i + (e + 1) % 3];
+                for(int direction=0; direction<2; direction++){
+                    uint32_t from = direction == 0 ? a : b, to = direction == 0 ? b : a;
+                    if(locked[from]){
+                        continue;
+                    }
+                    Quadric merged = quadrics[from];
+                    addQuadric(&merged, quadrics[to]);
+                    Collapse collapse = { from, to, quadricError(merged, vertices[to].pos) };
+                    collapses.push_back(collapse);
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b){ return a.cost < b.cost; });
+        
+        std::vector<uint32_t> remap(vertexCount);
+        for(size_t i=0; i<vertexCount; i++){
+            remap[i] = static_cast<uint32_t>(i);
+        }
+        std::vector<bool> touched(vertexCount, false);
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t removedTriangles = 0;
+        size_t collapseCount = 0;
+        
+        for(const Collapse &collapse: collapses){
+            if(collapse.cost > maxCost || removedTriangles >= trianglesToRemove){
+                break;
+            }
+            if(touched[collapse.from] || touched[collapse.to]){
+                continue;
+            }
+            std::vector<uint32_t> fromTriangles(triangles.begin() + triangleStart[collapse.from], triangles.begin() + triangleStart[collapse.from + 1]);
+            if(flipsTriangle(vertices, result, fromTriangles, collapse.from, collapse.to)){
+                continue;
+            }
+            
+            remap[collapse.from] = collapse.to;
+            addQuadric(&quadrics[collapse.to], quadrics[collapse.from]);
+            worstCost = std::max(worstCost, collapse.cost);
+            collapseCount++;
+            
+            // Triangles sharing the edge disappear, the rest around from change: none of their vertices may collapse again this pass
+            for(uint32_t triangle: fromTriangles){
+                bool sharesEdge = false;
+                for(size_t j=0; j<3; j++){
+                    touched[result[triangle * 3 + j]] = true;
+                    sharesEdge = sharesEdge || result[triangle * 3 + j] == collapse.to;
+                }
+                removedTriangles += sharesEdge ? 1 : 0;
+            }
+        }
+        
+        if(collapseCount == 0){
+            break;
+        }
+        
+        // Apply collapses, dropping triangles that became degenerate
+        std::vector<uint32_t> collapsed;
+        collapsed.reserve(result.size());
+        for(size_t i=0; i<result.size(); i+=3){
+            uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if(a == b || b == c || a == c){
+                continue;
+            }
+            collapsed.push_back(a);
+            collapsed.push_back(b);
+            collapsed.push_back(c);
+        }
+        result.swap(collapsed);
+    }
+    
+    *resultError = static_cast<float>(std::sqrt(worstCost));
+    return result;
+}
+
+// Quadric of plane normal.p + distance = 0
+MeshSimplifier::Quadric MeshSimplifier::planeQuadric(const glm::vec3 &normal, float distance){
+    Quadric quadric = {};
+    quadric.a00 = normal.x * normal.x;
+    quadric.a01 = normal.x * normal.y;
+    quadric.a02 = normal.x * normal.z;
+    quadric.a11 = normal.y * normal.y;
+    quadric.a12 = normal.y * normal.z;
+    quadric.a22 = normal.z * normal.z;
+    quadric.b0 = normal.x * distance;
+    quadric.b1 = normal.y * distance;
+    quadric.b2 = normal.z * distance;
+    quadric.c = distance * distance;
+    return quadric;
+}
+
+void MeshSimplifier::addQuadric(Quadric *quadric, const Quadric &other){
+    quadric->a00 += other.a00;
+    quadric->a01 += other.a01;
+    quadric->a02 += other.a02;
+    quadric->a11 += other.a11;
+    quadric->a12 += other.a12;
+    quadric->a22 += other.a22;
+    quadric->b0 += other.b0;
+    quadric->b1 += other.b1;
+    quadric->b2 += other.b2;
+    quadric->c += other.c;
+}
+
+// Sum of squared distances from point to the quadric's planes
+double MeshSimplifier::quadricError(const Quadric &quadric, const glm::vec3 &point){
+    double x = point.x, y = point.y, z = point.z;
+    double error = quadric.a00 * x * x + quadric.a11 * y * y + quadric.a22 * z * z
+                 + 2.0 * (quadric.a01 * x * y + quadric.a02 * x * z + quadric.a12 * y * z)
+                 + 2.0 * (quadric.b0 * x + quadric.b1 * y + quadric.b2 * z)
+                 + quadric.c;
+    return std::max(error, 0.0);        // Rounding can take it slightly below zero
+}
+
+// Would moving from onto to turn any remaining triangle around from over?
+bool MeshSimplifier::flipsTriangle(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                   const std::vector<uint32_t> &triangles, uint32_t from, uint32_t to){
+    for(uint32_t triangle: triangles){
+        uint32_t corners[3] = { indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2] };
+        if(corners[0] == to || corners[1] == to || corners[2] == to){
+            continue;                   // Collapses away
+        }
+        
+        glm::vec3 before = glm::cross(vertices[corners[1]].pos - vertices[corners[0]].pos, vertices[corners[2]].pos - vertices[corners[0]].pos);
+        for(uint32_t &corner: corners){
+            corner = corner == from ? to : corner;
+        }
+        glm::vec3 after = glm::cross(vertices[corners[1]].pos - vertices[corners[0]].pos, vertices[corners[2]].pos - vertices[corners[0]].pos);
+        if(glm::dot(before, after) <= 0.0f){
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,57 @@
+//
+//  MeshSimplifier.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 26/06/21.
+//
+
+#ifndef MeshSimplifier_hpp
+#define MeshSimplifier_hpp
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "Utilities.h"
+
+// Index range of one level of detail in a mesh's index buffer
+struct MeshLod{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;                        // Farthest the level's surface may be from the full mesh (model space units)
+};
+
+// Builds levels of detail of a mesh by edge collapse simplification guided by quadric error metrics
+// - Collapses move one vertex onto a neighbour (no new vertices), so every level shares the mesh's vertex buffer
+// - Vertices on open borders or UV/normal seams (several vertices at one position) never move, so levels don't tear
+// - Collapses that would flip a triangle are skipped
+class MeshSimplifier{
+public:
+    static std::vector<MeshLod> buildLodChain(const std::vector<Vertex> &vertices, std::vector<uint32_t> *indices);
+    static std::vector<uint32_t> simplify(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                          size_t targetIndexCount, float maxError, float *resultError);
+
+private:
+    // Sum of squared distances to a set of planes: error(p) = p^T A p + 2 b.p + c
+    struct Quadric{
+        double a00, a01, a02, a11, a12, a22;
+        double b0, b1, b2;
+        double c;
+    };
+    
+    struct Collapse{
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+    
+    static Quadric planeQuadric(const glm::vec3 &normal, float distance);
+    static void addQuadric(Quadric *quadric, const Quadric &other);
+    static double quadricError(const Quadric &quadric, const glm::vec3 &point);
+    static bool flipsTriangle(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                              const std::vector<uint32_t> &triangles, uint32_t from, uint32_t to);
+};
+
+#endif /* MeshSimplifier_hpp */
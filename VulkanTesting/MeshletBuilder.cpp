@@ -0,0 +1,181 @@
+//
+//  MeshletBuilder.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 27/06/21.
+//
+
+#include "MeshletBuilder.hpp"
+
+// Reorders indices (full detail level only, call before levels of detail are appended) so meshlets are consecutive
+// Meshes below MESHLET_MIN_MESH_TRIANGLES get no meshlets and keep their order
+std::vector<Meshlet> MeshletBuilder::buildMeshlets(const std::vector<Vertex> &vertices, std::vector<uint32_t> *indices){
+    std::vector<Meshlet> meshlets;
+    size_t triangleCount = indices->size() / 3;
+    if(vertices.empty() || indices->size() % 3 != 0 || triangleCount < MESHLET_MIN_MESH_TRIANGLES){
+        return meshlets;
+    }
+    
+    // Triangles around each vertex
+    size_t vertexCount = vertices.size();
+    std::vector<uint32_t> triangleStart(vertexCount + 1, 0);
+    for(uint32_t index: *indices){
+        triangleStart[index + 1]++;
+    }
+    for(size_t i=0; i<vertexCount; i++){
+        triangleStart[i + 1] += triangleStart[i];
+    }
+    std::vector<uint32_t> triangles(indices->size());
+    std::vector<uint32_t> cursor(triangleStart.begin(), triangleStart.end() - 1);
+    for(size_t i=0; i<indices->size(); i++){
+        triangles[cursor[(*indices)[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+    
+    std::vector<uint32_t> result;
+    result.reserve(indices->size());
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> vertexMeshlet(vertexCount, UINT32_MAX);       // Last meshlet a vertex was added to
+    std::vector<uint32_t> candidateMeshlet(triangleCount, UINT32_MAX);  // Last meshlet a triangle was a candidate of
+    std::vector<uint32_t> candidates;
+    size_t seed = 0;
+    
+    while(result.size() < indices->size()){
+        uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+        uint32_t firstIndex = static_cast<uint32_t>(result.size());
+        uint32_t meshletVertexCount = 0;
+        uint32_t meshletTriangleCount = 0;
+        candidates.clear();
+        
+        // Seed is the first triangle not in a meshlet yet, so meshlets follow the mesh's own (usually spatially coherent) order
+        while(emitted[seed]){
+            seed++;
+        }
+        uint32_t next = static_cast<uint32_t>(seed);
+        
+        while(true){
+            const uint32_t *corners = &(*indices)[next * 3];
+            uint32_t newVertexCount = 0;
+            for(size_t j=0; j<3; j++){
+                newVertexCount += vertexMeshlet[corners[j]] != meshletIndex ? 1 : 0;
+            }
+            if(meshletVertexCount + newVertexCount > MESHLET_MAX_VERTICES){
+                break;
+            }
+            
+            // Add triangle, its neighbours become candidates
+            emitted[next] = true;
+            meshletTriangleCount++;
+            for(size_t j=0; j<3; j++){
+                uint32_t vertex = corners[j];
+                result.push_back(vertex);
+                if(vertexMeshlet[vertex] != meshletIndex){
+                    vertexMeshlet[vertex] = meshletIndex;
+                    meshletVertexCount++;
+                }
+                for(uint32_t t=triangleStart[vertex]; t<triangleStart[vertex + 1]; t++){
+                    uint32_t triangle = triangles[t];
+                    if(!emitted[triangle] && candidateMeshlet[triangle] != meshletIndex){
+                        candidateMeshlet[triangle] = meshletIndex;
+                        candidates.push_back(triangle);
+                    }
+                }
+            }
+            if(meshletTriangleCount == MESHLET_MAX_TRIANGLES){
+                break;
+            }
+            
+            // Next: candidate adding fewest new vertices (earliest on ties), dropping candidates added meanwhile
+            uint32_t bestScore = UINT32_MAX;
+            size_t kept = 0;
+            for(size_t c=0; c<candidates.size(); c++){
+                uint32_t triangle = candidates[c];
+                if(emitted[triangle]){
+                    continue;
+                }
+                candidates[kept++] = triangle;
+                uint32_t score = 0;
+                for(size_t j=0; j<3; j++){
+                    score += vertexMeshlet[(*indices)[triangle * 3 + j]] != meshletIndex ? 1 : 0;
+                }
+                if(score < bestScore){
+                    bestScore = score;
+                    next = triangle;
+                }
+            }
+            candidates.resize(kept);
+            if(candidates.empty()){
+                break;                  // Meshlet covers a whole connected piece
+            }
+        }
+        
+        meshlets.push_back(computeBounds(vertices, result, firstIndex, static_cast<uint32_t>(result.size()) - firstIndex));
+    }
+    
+    indices->swap(result);
+    return meshlets;
+}
+
+// Camera position in the meshlet's (model) space: backfacing is a question of which side of each triangle's plane the camera
+// is on, which any model transform keeps, so no transformed bounds are needed
+bool MeshletBuilder::isBackfacing(const Meshlet &meshlet, const glm::vec3 &cameraPosition){
+    if(meshlet.coneCos <= 0.0f){
+        return false;
+    }
+    glm::vec3 view = meshlet.centre - cameraPosition;
+    float distance = glm::length(view);
+    if(distance <= meshlet.radius){
+        return false;                   // Camera inside bounds
+    }
+    
+    // Every point of the meshlet must be behind every triangle's plane: the view direction to the centre, widened by the cone
+    // spread, must still be more than the bounding radius away from facing the camera
+    float viewCos = glm::dot(view, meshlet.coneAxis) / distance;
+    float viewSin = std::sqrt(std::max(1.0f - viewCos * viewCos, 0.0f));
+    float coneSin = std::sqrt(std::max(1.0f - meshlet.coneCos * meshlet.coneCos, 0.0f));
+    return viewCos * meshlet.coneCos - viewSin * coneSin >= meshlet.radius / distance;
+}
+
+// Bounding sphere around the box of the meshlet's vertices, normal cone around the average triangle facing
+Meshlet MeshletBuilder::computeBounds(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, uint32_t firstIndex, uint32_t indexCount){
+    Meshlet meshlet = {};
+    meshlet.firstIndex = firstIndex;
+    meshlet.indexCount = indexCount;
+    
+    glm::vec3 boundsMin = vertices[indices[firstIndex]].pos, boundsMax = boundsMin;
+    for(uint32_t i=firstIndex; i<firstIndex + indexCount; i++){
+        boundsMin = glm::min(boundsMin, vertices[indices[i]].pos);
+        boundsMax = glm::max(boundsMax, vertices[indices[i]].pos);
+    }
+    meshlet.centre = (boundsMin + boundsMax) * 0.5f;
+    for(uint32_t i=firstIndex; i<firstIndex + indexCount; i++){
+        meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].pos - meshlet.centre));
+    }
+    
+    // Counter clockwise triangles are front facing, so normals from the cross product point towards the side that is drawn
+    std::vector<glm::vec3> normals;
+    glm::vec3 normalSum(0.0f);
+    for(uint32_t i=firstIndex; i<firstIndex + indexCount; i+=3){
+        const glm::vec3 &p0 = vertices[indices[i]].pos;
+        glm::vec3 normal = glm::cross(vertices[indices[i + 1]].pos - p0, vertices[indices[i + 2]].pos - p0);
+        float length = glm::length(normal);
+        if(length == 0.0f){
+            continue;                   // Degenerate triangle is never drawn
+        }
+        normals.push_back(normal / length);
+        normalSum += normal / length;
+    }
+    
+    float sumLength = glm::length(normalSum);
+    if(normals.empty() || sumLength < 1e-4f){
+        meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneCos = 0.0f;         // Faces every way
+        return meshlet;
+    }
+    meshlet.coneAxis = normalSum / sumLength;
+    meshlet.coneCos = 1.0f;
+    for(const glm::vec3 &normal: normals){
+        meshlet.coneCos = std::min(meshlet.coneCos, glm::dot(meshlet.coneAxis, normal));
+    }
+    
+    return meshlet;
+}
@@ -0,0 +1,41 @@
+//
+//  MeshletBuilder.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 27/06/21.
+//
+
+#ifndef MeshletBuilder_hpp
+#define MeshletBuilder_hpp
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "Utilities.h"
+
+// Cluster of neighbouring triangles of a mesh's full detail level, culled on its own
+struct Meshlet{
+    uint32_t firstIndex;                // Triangles of a meshlet are consecutive in the mesh's index buffer
+    uint32_t indexCount;
+    glm::vec3 centre;                   // Bounding sphere (model space)
+    float radius;
+    glm::vec3 coneAxis;                 // Average facing of the triangles
+    float coneCos;                      // Cosine of the widest angle between coneAxis and a triangle's normal (<= 0: never backfacing as a whole)
+};
+
+// Splits a mesh into meshlets of at most MESHLET_MAX_VERTICES unique vertices & MESHLET_MAX_TRIANGLES triangles
+// - Grown greedily from a seed triangle, adding the neighbour that brings fewest new vertices, so meshlets stay compact
+// - Triangles are reordered so each meshlet is one index range (drawn with one indexed draw, or merged with its neighbours)
+class MeshletBuilder{
+public:
+    static std::vector<Meshlet> buildMeshlets(const std::vector<Vertex> &vertices, std::vector<uint32_t> *indices);
+    
+    static bool isBackfacing(const Meshlet &meshlet, const glm::vec3 &cameraPosition);
+
+private:
+    static Meshlet computeBounds(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices, uint32_t firstIndex, uint32_t indexCount);
+};
+
+#endif /* MeshletBuilder_hpp */
@@ -0,0 +1,65 @@
+//
+//  ModelCache.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 12/06/21.
+//
+
+#include "ModelCache.hpp"
+
+ModelCache::ModelCache(){
+    
+}
+
+ModelCache::~ModelCache(){
+    
+}
+
+// Same file imported with different post process flags gives different meshes, so both make up the key
+std::string ModelCache::makeKey(const std::string &modelFile, unsigned int importFlags){
+    return modelFile + "|" + std::to_string(importFlags);
+}
+
+// If key is cached, copy out its meshes (same GPU buffers) and take a reference on them
+bool ModelCache::acquire(const std::string &key, std::vector<Mesh> *meshList){
+    auto entry = entries.find(key);
+    if(entry == entries.end()){
+        return false;
+    }
+    
+    entry->second.refCount++;
+    *meshList = entry->second.meshList;
+    return true;
+}
+
+// Add freshly loaded meshes to the cache, owned by the model that loaded them
+void ModelCache::insert(const std::string &key, const std::vector<Mesh> &meshList, bool ownsTextures){
+    ModelCacheEntry entry = {};
+    entry.meshList = meshList;
+    entry.refCount = 1;
+    entry.ownsTextures = ownsTextures;
+    entries[key] = entry;
+}
+
+// Drop a reference, returns true if it was the last one (entry removed and caller must destroy the buffers)
+bool ModelCache::release(const std::string &key, bool *ownsTextures){
+    auto entry = entries.find(key);
+    if(entry == entries.end()){
+        return false;
+    }
+    
+    entry->second.refCount--;
+    if(entry->second.refCount > 0){
+        return false;
+    }
+    
+    if(ownsTextures){
+        *ownsTextures = entry->second.ownsTextures;
+    }
+    entries.erase(entry);
+    return true;
+}
+
+size_t ModelCache::getEntryCount(){
+    return entries.size();
+}
@@ -0,0 +1,41 @@
+//
+//  ModelCache.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 12/06/21.
+//
+
+#ifndef ModelCache_hpp
+#define ModelCache_hpp
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Mesh.hpp"
+
+// Meshes of an imported model file, shared by every MeshModel created from the same file
+struct ModelCacheEntry{
+    std::vector<Mesh> meshList;     // Meshes holding the shared vertex/index buffers and texture IDs
+    int refCount;                   // Number of MeshModels currently using the meshes
+    bool ownsTextures;              // Textures were created by the import, destroyed with the meshes
+};
+
+class ModelCache{
+public:
+    ModelCache();
+    ~ModelCache();
+    
+    static std::string makeKey(const std::string &modelFile, unsigned int importFlags);
+    
+    bool acquire(const std::string &key, std::vector<Mesh> *meshList);
+    void insert(const std::string &key, const std::vector<Mesh> &meshList, bool ownsTextures = true);
+    bool release(const std::string &key, bool *ownsTextures = nullptr);
+    
+    size_t getEntryCount();
+    
+private:
+    std::map<std::string, ModelCacheEntry> entries;
+};
+
+#endif /* ModelCache_hpp */
@@ -0,0 +1,126 @@
+//
+//  PassQueries.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 24/06/21.
+//
+
+#include "PassQueries.hpp"
+
+PassQueries::PassQueries(){
+
+}
+
+PassQueries::~PassQueries(){
+
+}
+
+void PassQueries::init(VkDevice newDevice, uint32_t newFrameCount, bool statisticsSupported, bool preciseOcclusionSupported){
+    device = newDevice;
+    frameCount = newFrameCount;
+    writtenPasses.assign(frameCount, 0);
+    
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryCount = frameCount * QUERY_PASS_COUNT;
+    
+    // Result order follows bit order of the flags: vertices, vertex invocations, clipping primitives, fragment invocations
+    if(statisticsSupported){
+        queryPoolCreateInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        queryPoolCreateInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT
+                                                | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+                                                | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+                                                | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+        VkResult result = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &statisticsPool);
+        if(result != VK_SUCCESS){
+            throw std::runtime_error("Failed to create a Pipeline Statistics Query Pool!");
+        }
+    }
+    
+    // Without precise occlusion queries any non-zero count only means "some samples passed"
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+    queryPoolCreateInfo.pipelineStatistics = 0;
+    VkResult result = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &occlusionPool);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create an Occlusion Query Pool!");
+    }
+    occlusionFlags = preciseOcclusionSupported ? VK_QUERY_CONTROL_PRECISE_BIT : 0;
+}
+
+void PassQueries::destroy(){
+    if(statisticsPool != VK_NULL_HANDLE){
+        vkDestroyQueryPool(device, statisticsPool, nullptr);
+        statisticsPool = VK_NULL_HANDLE;
+    }
+    if(occlusionPool != VK_NULL_HANDLE){
+        vkDestroyQueryPool(device, occlusionPool, nullptr);
+        occlusionPool = VK_NULL_HANDLE;
+    }
+}
+
+void PassQueries::reset(VkCommandBuffer commandBuffer, uint32_t frame){
+    if(statisticsPool != VK_NULL_HANDLE){
+        vkCmdResetQueryPool(commandBuffer, statisticsPool, getQuery(frame, QUERY_PASS_SCENE), QUERY_PASS_COUNT);
+    }
+    vkCmdResetQueryPool(commandBuffer, occlusionPool, getQuery(frame, QUERY_PASS_SCENE), QUERY_PASS_COUNT);
+    writtenPasses[frame] = 0;
+}
+
+// Begin & end must be in the same subpass
+void PassQueries::begin(VkCommandBuffer commandBuffer, uint32_t frame, QueryPass pass){
+    if(statisticsPool != VK_NULL_HANDLE){
+        vkCmdBeginQuery(commandBuffer, statisticsPool, getQuery(frame, pass), 0);
+    }
+    vkCmdBeginQuery(commandBuffer, occlusionPool, getQuery(frame, pass), occlusionFlags);
+    writtenPasses[frame] |= 1u << pass;
+}
+
+void PassQueries::end(VkCommandBuffer commandBuffer, uint32_t frame, QueryPass pass){
+    vkCmdEndQuery(commandBuffer, occlusionPool, getQuery(frame, pass));
+    if(statisticsPool != VK_NULL_HANDLE){
+        vkCmdEndQuery(commandBuffer, statisticsPool, getQuery(frame, pass));
+    }
+}
+
+// Call after frame's fence has signalled; results not available yet keep their previous values
+void PassQueries::readResults(uint32_t frame){
+    for(uint32_t pass=0; pass<QUERY_PASS_COUNT; pass++){
+        if(!(writtenPasses[frame] & (1u << pass))){
+            stats[pass].valid = false;          // Pass didn't run (e.g. no post process effect)
+            continue;
+        }
+        
+        PassStats passStats = {};
+        uint64_t samplesPassed = 0;
+        if(vkGetQueryPoolResults(device, occlusionPool, getQuery(frame, static_cast<QueryPass>(pass)), 1, sizeof(samplesPassed), &samplesPassed, sizeof(samplesPassed), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS){
+            continue;
+        }
+        passStats.samplesPassed = samplesPassed;
+        
+        if(statisticsPool != VK_NULL_HANDLE){
+            uint64_t statistics[4] = {};
+            if(vkGetQueryPoolResults(device, statisticsPool, getQuery(frame, static_cast<QueryPass>(pass)), 1, sizeof(statistics), statistics, sizeof(statistics), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS){
+                continue;
+            }
+            passStats.inputVertices = statistics[0];
+            passStats.vertexShaderInvocations = statistics[1];
+            passStats.clippingPrimitives = statistics[2];
+            passStats.fragmentShaderInvocations = statistics[3];
+        }
+        
+        passStats.valid = true;
+        stats[pass] = passStats;
+    }
+}
+
+PassStats PassQueries::getStats(QueryPass pass){
+    return stats[pass];
+}
+
+bool PassQueries::hasStatistics(){
+    return statisticsPool != VK_NULL_HANDLE;
+}
+
+uint32_t PassQueries::getQuery(uint32_t frame, QueryPass pass){
+    return frame * QUERY_PASS_COUNT + pass;
+}
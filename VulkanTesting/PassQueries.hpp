@@ -0,0 +1,66 @@
+//
+//  PassQueries.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 24/06/21.
+//
+
+#ifndef PassQueries_hpp
+#define PassQueries_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+// Passes counted by PassQueries
+enum QueryPass{
+    QUERY_PASS_SCENE = 0,               // Subpass 0: meshes
+    QUERY_PASS_POST_PROCESS = 1,        // Subpass 1: fullscreen effect (not run in direct render path)
+    QUERY_PASS_COUNT
+};
+
+// Work done by a pass in the last frame its results were read for
+struct PassStats{
+    bool valid;                         // Pass ran in that frame and its results were available
+    uint64_t inputVertices;             // Vertices fetched by input assembly
+    uint64_t vertexShaderInvocations;   // Lower than inputVertices when post-transform cache reuses vertices
+    uint64_t clippingPrimitives;        // Primitives leaving clipping
+    uint64_t fragmentShaderInvocations; // Divided by pixel count gives overdraw
+    uint64_t samplesPassed;             // Samples passing depth test (occlusion query)
+};
+
+// Pipeline statistics & occlusion queries around each pass, one set of queries per frame in flight
+// Results are read once the frame's fence has signalled, so reading never waits on the GPU
+class PassQueries{
+public:
+    PassQueries();
+    ~PassQueries();
+    
+    void init(VkDevice newDevice, uint32_t newFrameCount, bool statisticsSupported, bool preciseOcclusionSupported);
+    void destroy();
+    
+    void reset(VkCommandBuffer commandBuffer, uint32_t frame);      // Outside render pass, before first begin of frame
+    void begin(VkCommandBuffer commandBuffer, uint32_t frame, QueryPass pass);
+    void end(VkCommandBuffer commandBuffer, uint32_t frame, QueryPass pass);
+    void readResults(uint32_t frame);
+    
+    PassStats getStats(QueryPass pass);
+    bool hasStatistics();
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    uint32_t frameCount = 0;
+    VkQueryPool statisticsPool = VK_NULL_HANDLE;                    // Null when pipelineStatisticsQuery feature is missing
+    VkQueryPool occlusionPool = VK_NULL_HANDLE;
+    VkQueryControlFlags occlusionFlags = 0;
+    
+    std::vector<uint32_t> writtenPasses;                            // Bit per pass begun in each frame since reset
+    PassStats stats[QUERY_PASS_COUNT] = {};
+    
+    uint32_t getQuery(uint32_t frame, QueryPass pass);
+};
+
+#endif /* PassQueries_hpp */
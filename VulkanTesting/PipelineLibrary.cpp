@@ -0,0 +1,539 @@
+//
+//  PipelineLibrary.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 14/06/21.
+//
+
+#include "PipelineLibrary.hpp"
+
+// Mix a value into a running hash (same mixing as boost::hash_combine)
+template <typename T>
+static void hashCombine(size_t &seed, const T &value){
+    seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+bool PipelineDescription::operator==(const PipelineDescription &other) const{
+    return vertexShader == other.vertexShader
+        && fragmentShader == other.fragmentShader
+        && vertexFormat == other.vertexFormat
+        && cullMode == other.cullMode
+        && depthTestEnable == other.depthTestEnable
+        && depthWriteEnable == other.depthWriteEnable
+        && depthCompareOp == other.depthCompareOp
+        && blendEnable == other.blendEnable
+        && additiveBlend == other.additiveBlend
+        && layout == other.layout
+        && renderPass == other.renderPass
+        && subpass == other.subpass
+        && fragmentConstants == other.fragmentConstants;
+}
+
+size_t PipelineDescriptionHash::operator()(const PipelineDescription &description) const{
+    size_t seed = 0;
+    hashCombine(seed, description.vertexShader);
+    hashCombine(seed, description.fragmentShader);
+    hashCombine(seed, static_cast<int>(description.vertexFormat));
+    hashCombine(seed, static_cast<uint32_t>(description.cullMode));
+    hashCombine(seed, static_cast<uint32_t>(description.depthTestEnable));
+    hashCombine(seed, static_cast<uint32_t>(description.depthWriteEnable));
+    hashCombine(seed, static_cast<int>(description.depthCompareOp));
+    hashCombine(seed, static_cast<uint32_t>(description.blendEnable));
+    hashCombine(seed, static_cast<uint32_t>(description.additiveBlend));
+    hashCombine(seed, reinterpret_cast<uintptr_t>(description.layout));
+    hashCombine(seed, reinterpret_cast<uintptr_t>(description.renderPass));
+    hashCombine(seed, description.subpass);
+    for(uint32_t constant: description.fragmentConstants){
+        hashCombine(seed, constant);
+    }
+    return seed;
+}
+
+PipelineLibrary::PipelineLibrary(){
+
+}
+
+PipelineLibrary::~PipelineLibrary(){
+
+}
+
+void PipelineLibrary::init(VkDevice newDevice, VkPipelineCache newPipelineCache){
+    device = newDevice;
+    pipelineCache = newPipelineCache;
+}
+
+// Get pipeline matching description, creating it now if it doesn't exist yet
+VkPipeline PipelineLibrary::getPipeline(const PipelineDescription &description){
+    auto pipeline = pipelines.find(description);
+    if(pipeline != pipelines.end()){
+        return pipeline->second;
+    }
+    
+    // Description may never have been requested, so its shaders may not be loaded yet
+    getShaderModule(description.vertexShader);
+    if(!description.fragmentShader.empty()){
+        getShaderModule(description.fragmentShader);
+    }
+    
+    VkPipeline newPipeline = createPipeline(description);
+    pipelines[description] = newPipeline;
+    return newPipeline;
+}
+
+// Queue a pipeline to be created by the next compilePending() call
+void PipelineLibrary::requestPipeline(const PipelineDescription &description){
+    // Skip if already created or already waiting
+    if(pipelines.find(description) != pipelines.end()
+       || std::find(pendingPipelines.begin(), pendingPipelines.end(), description) != pendingPipelines.end()){
+        return;
+    }
+    
+    pendingPipelines.push_back(description);
+}
+
+// Get compute pipeline running shader with layout, creating it now if it doesn't exist yet
+// (compute pipelines are few and only need one shader, so they aren't queued for compilePending)
+VkPipeline PipelineLibrary::getComputePipeline(const std::string &computeShader, VkPipelineLayout layout){
+    auto key = std::make_pair(computeShader, layout);
+    auto pipeline = computePipelines.find(key);
+    if(pipeline != computePipelines.end()){
+        return pipeline->second;
+    }
+    
+    getShaderModule(computeShader);
+    VkPipeline newPipeline = createComputePipeline(computeShader, layout);
+    computePipelines[key] = newPipeline;
+    return newPipeline;
+}
+
+// Create all queued pipelines, spread over worker threads
+void PipelineLibrary::compilePending(uint32_t threadCount){
+    if(pendingPipelines.empty()){
+        return;
+    }
+    
+    // Load shader modules up front, so worker threads only read the module list
+    for(const auto &description: pendingPipelines){
+        getShaderModule(description.vertexShader);
+        if(!description.fragmentShader.empty()){
+            getShaderModule(description.fragmentShader);
+        }
+    }
+    
+    // Add finished pipelines to library
+    std::string error;
+    std::vector<VkPipeline> newPipelines = createPipelines(pendingPipelines, threadCount, &error);
+    for(size_t i=0; i<pendingPipelines.size(); i++){
+        if(newPipelines[i] != VK_NULL_HANDLE){
+            pipelines[pendingPipelines[i]] = newPipelines[i];
+        }
+    }
+    pendingPipelines.clear();
+    
+    if(!error.empty()){
+        throw std::runtime_error(error);
+    }
+}
+
+// Create pipelines of descriptions (shader modules must be loaded) on worker threads
+// Pipelines that failed are VK_NULL_HANDLE, error is the first failure's message (empty if all were created)
+std::vector<VkPipeline> PipelineLibrary::createPipelines(const std::vector<PipelineDescription> &descriptions, uint32_t threadCount, std::string *error){
+    std::vector<VkPipeline> newPipelines(descriptions.size(), VK_NULL_HANDLE);
+    std::vector<std::string> errors(descriptions.size());
+    std::atomic<size_t> nextPipeline(0);
+    
+    // Each worker takes the next pipeline that hasn't been started until there are none left
+    // Note: vkCreateGraphicsPipelines can be called from multiple threads with the same (internally synchronized) pipeline cache
+    auto worker = [&](){
+        for(size_t i = nextPipeline++; i < descriptions.size(); i = nextPipeline++){
+            try{
+                newPipelines[i] = createPipeline(descriptions[i]);
+            }catch(const std::runtime_error &e){
+                errors[i] = e.what();
+            }
+        }
+    };
+    
+    threadCount = std::max(1u, std::min(threadCount, static_cast<uint32_t>(descriptions.size())));
+    std::vector<std::thread> workers;
+    for(uint32_t i=1; i<threadCount; i++){
+        workers.push_back(std::thread(worker));
+    }
+    worker();                                   // Calling thread works too
+    for(auto &thread: workers){
+        thread.join();
+    }
+    
+    error->clear();
+    for(size_t i=0; i<descriptions.size() && error->empty(); i++){
+        if(newPipelines[i] == VK_NULL_HANDLE){
+            *error = errors[i];
+        }
+    }
+    return newPipelines;
+}
+
+// Rebuild shader modules whose source files changed on disk, and only the (graphics & compute) pipelines using them
+// Returns true if any pipeline was rebuilt (previously returned handles of those pipelines are no longer valid)
+bool PipelineLibrary::reloadChangedShaders(){
+    // Don't touch the file system every frame
+    auto now = std::chrono::steady_clock::now();
+    if(std::chrono::duration<double>(now - lastReloadCheck).count() < SHADER_RELOAD_INTERVAL){
+        return false;
+    }
+    lastReloadCheck = now;
+    
+    // Compile changed shaders first, so a shader with errors leaves the old pipelines running
+    std::map<std::string, VkShaderModule> reloadedModules;
+    for(auto &modifiedTime: shaderModifiedTimes){
+        time_t newModifiedTime = shaderCompiler.getModifiedTime(modifiedTime.first);
+        if(newModifiedTime == 0 || newModifiedTime == modifiedTime.second){
+            continue;
+        }
+        modifiedTime.second = newModifiedTime;      // Don't retry a broken shader until it is saved again
+        
+        try{
+            reloadedModules[modifiedTime.first] = createShaderModule(shaderCompiler.compile(modifiedTime.first));
+        }catch(const std::runtime_error &e){
+            printf("ERROR: %s\n", e.what());
+        }
+    }
+    
+    if(reloadedModules.empty()){
+        return false;
+    }
+    
+    // Pipelines using a reloaded shader
+    std::vector<PipelineDescription> affectedPipelines;
+    for(const auto &pipeline: pipelines){
+        if(reloadedModules.count(pipeline.first.vertexShader) || reloadedModules.count(pipeline.first.fragmentShader)){
+            affectedPipelines.push_back(pipeline.first);
+        }
+    }
+    
+    std::vector<std::pair<std::string, VkPipelineLayout>> affectedComputePipelines;
+    for(const auto &pipeline: computePipelines){
+        if(reloadedModules.count(pipeline.first.first)){
+            affectedComputePipelines.push_back(pipeline.first);
+        }
+    }
+    
+    // Build replacements with the new modules while the old pipelines (and modules) stay untouched
+    std::map<std::string, VkShaderModule> oldModules;
+    for(auto &reloadedModule: reloadedModules){
+        oldModules[reloadedModule.first] = shaderModules[reloadedModule.first];
+        shaderModules[reloadedModule.first] = reloadedModule.second;
+    }
+    std::string error;
+    std::vector<VkPipeline> newPipelines = createPipelines(affectedPipelines, std::thread::hardware_concurrency(), &error);
+    std::vector<VkPipeline> newComputePipelines(affectedComputePipelines.size(), VK_NULL_HANDLE);
+    for(size_t i=0; i<affectedComputePipelines.size() && error.empty(); i++){
+        try{
+            newComputePipelines[i] = createComputePipeline(affectedComputePipelines[i].first, affectedComputePipelines[i].second);
+        }catch(const std::runtime_error &e){
+            error = e.what();
+        }
+    }
+    
+    // Any failure keeps everything as it was
+    if(!error.empty()){
+        for(VkPipeline newPipeline: newPipelines){
+            if(newPipeline != VK_NULL_HANDLE){
+                vkDestroyPipeline(device, newPipeline, nullptr);
+            }
+        }
+        for(VkPipeline newPipeline: newComputePipelines){
+            if(newPipeline != VK_NULL_HANDLE){
+                vkDestroyPipeline(device, newPipeline, nullptr);
+            }
+        }
+        for(auto &oldModule: oldModules){
+            vkDestroyShaderModule(device, shaderModules[oldModule.first], nullptr);
+            shaderModules[oldModule.first] = oldModule.second;
+        }
+        printf("ERROR: %s\n>>> Kept previous pipelines\n", error.c_str());
+        return false;
+    }
+    
+    // Old pipelines may still be in use by submitted command buffers
+    vkDeviceWaitIdle(device);
+    for(size_t i=0; i<affectedPipelines.size(); i++){
+        VkPipeline &pipeline = pipelines[affectedPipelines[i]];
+        vkDestroyPipeline(device, pipeline, nullptr);
+        pipeline = newPipelines[i];
+    }
+    for(size_t i=0; i<affectedComputePipelines.size(); i++){
+        VkPipeline &pipeline = computePipelines[affectedComputePipelines[i]];
+        vkDestroyPipeline(device, pipeline, nullptr);
+        pipeline = newComputePipelines[i];
+    }
+    for(auto &oldModule: oldModules){
+        vkDestroyShaderModule(device, oldModule.second, nullptr);
+        printf(">>> Reloaded shader %s\n", oldModule.first.c_str());
+    }
+    
+    printf(">>> Rebuilt %zu pipeline(s)\n", affectedPipelines.size() + affectedComputePipelines.size());
+    return !affectedPipelines.empty() || !affectedComputePipelines.empty();
+}
+
+size_t PipelineLibrary::getPipelineCount(){
+    return pipelines.size();
+}
+
+void PipelineLibrary::destroy(){
+    for(auto &pipeline: pipelines){
+        vkDestroyPipeline(device, pipeline.second, nullptr);
+    }
+    pipelines.clear();
+    pendingPipelines.clear();
+    for(auto &pipeline: computePipelines){
+        vkDestroyPipeline(device, pipeline.second, nullptr);
+    }
+    computePipelines.clear();
+    
+    for(auto &shaderModule: shaderModules){
+        vkDestroyShaderModule(device, shaderModule.second, nullptr);
+    }
+    shaderModules.clear();
+    shaderModifiedTimes.clear();
+}
+
+VkShaderModule PipelineLibrary::getShaderModule(const std::string &fileName){
+    auto shaderModule = shaderModules.find(fileName);
+    if(shaderModule != shaderModules.end()){
+        return shaderModule->second;
+    }
+    
+    // Compile GLSL source (or load cached SPIR-V) and remember which version of the file it came from
+    time_t modifiedTime = shaderCompiler.getModifiedTime(fileName);
+    VkShaderModule newShaderModule = createShaderModule(shaderCompiler.compile(fileName));
+    
+    shaderModules[fileName] = newShaderModule;
+    shaderModifiedTimes[fileName] = modifiedTime;
+    return newShaderModule;
+}
+
+VkShaderModule PipelineLibrary::createShaderModule(const std::vector<uint32_t> &code){
+    VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+    shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderModuleCreateInfo.codeSize = code.size() * sizeof(uint32_t);              // Size of code (in bytes)
+    shaderModuleCreateInfo.pCode = code.data();                                     // Pointer to code
+    
+    VkShaderModule shaderModule;
+    VkResult result = vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr, &shaderModule);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create a shader module!");
+    }
+    
+    return shaderModule;
+}
+
+// Compute pipeline running shader (its module must be loaded) with layout
+VkPipeline PipelineLibrary::createComputePipeline(const std::string &computeShader, VkPipelineLayout layout){
+    VkComputePipelineCreateInfo pipelineCreateInfo = {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineCreateInfo.stage.module = shaderModules.at(computeShader);
+    pipelineCreateInfo.stage.pName = "main";
+    pipelineCreateInfo.layout = layout;
+    
+    VkPipeline pipeline;
+    VkResult result = vkCreateComputePipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create a Compute Pipeline!");
+    }
+    
+    return pipeline;
+}
+
+VkPipeline PipelineLibrary::createPipeline(const PipelineDescription &description){
+    // -- SHADER STAGE CREATION INFORMATION --
+    // Vertex Stage creation information
+    VkPipelineShaderStageCreateInfo vertexShaderCreateInfo = {};
+    vertexShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertexShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;                          // Shader stage name
+    vertexShaderCreateInfo.module = shaderModules.at(description.vertexShader);         // Shader module to be used by stage
+    vertexShaderCreateInfo.pName = "main";                                              // Entry point to the shader
+    
+    // Fragment Stage creation information
+    VkPipelineShaderStageCreateInfo fragmentShaderCreateInfo = {};
+    fragmentShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragmentShaderCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;                      // Shader stage name
+    fragmentShaderCreateInfo.module = description.fragmentShader.empty() ? VK_NULL_HANDLE : shaderModules.at(description.fragmentShader);   // Shader module to be used by stage
+    fragmentShaderCreateInfo.pName = "main";                                            // Entry point to the shader
+    
+    // Specialization constants: constant_id i takes fragmentConstants[i], shader is optimized for these values when pipeline is created
+    std::vector<VkSpecializationMapEntry> fragmentMapEntries(description.fragmentConstants.size());
+    for(uint32_t i=0; i<fragmentMapEntries.size(); i++){
+        fragmentMapEntries[i].constantID = i;                                           // constant_id in shader
+        fragmentMapEntries[i].offset = i * sizeof(uint32_t);                            // Where value is in data
+        fragmentMapEntries[i].size = sizeof(uint32_t);                                  // int, uint, float and bool (VkBool32) are all 4 bytes
+    }
+    
+    VkSpecializationInfo fragmentSpecializationInfo = {};
+    fragmentSpecializationInfo.mapEntryCount = static_cast<uint32_t>(fragmentMapEntries.size());
+    fragmentSpecializationInfo.pMapEntries = fragmentMapEntries.data();
+    fragmentSpecializationInfo.dataSize = description.fragmentConstants.size() * sizeof(uint32_t);
+    fragmentSpecializationInfo.pData = description.fragmentConstants.data();
+    if(!description.fragmentConstants.empty()){
+        fragmentShaderCreateInfo.pSpecializationInfo = &fragmentSpecializationInfo;
+    }
+    
+    // Graphics Pipeline creation info requires array of shader stage creates
+    VkPipelineShaderStageCreateInfo shaderStages[] = {
+        vertexShaderCreateInfo, fragmentShaderCreateInfo
+    };
+    
+    // How the data for a single vertex (including info such as position, color, tex coords, normals, etc) is as a whole
+    VkVertexInputBindingDescription bindingDescription = {};
+    bindingDescription.binding = 0;                                 // Can bind multiple streams of data, this defines which one
+    bindingDescription.stride = sizeof(Vertex);                     // Size of a single vertex object
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;     // How to move between data after each vertex
+    
+    // How the data for an attribute is defined within a vertex
+    std::array<VkVertexInputAttributeDescription, 3> attributeDescription;
+    
+    // Position attribute
+    attributeDescription[0].binding = 0;                            // Which binding the data is at (should be same as above)
+    attributeDescription[0].location = 0;                           // Location in shader where data will be read from
+    attributeDescription[0].format = VK_FORMAT_R32G32B32_SFLOAT;    // Format the data will take (also helps define the size of data)
+    attributeDescription[0].offset = offsetof(Vertex, pos);         // Where this attribute is defined in the data for a single vertex
+    
+    // Color attribute
+    attributeDescription[1].binding = 0;
+    attributeDescription[1].location = 1;
+    attributeDescription[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescription[1].offset = offsetof(Vertex, col);
+    
+    // Texture Attributes
+    attributeDescription[2].binding = 0;
+    attributeDescription[2].location = 2;
+    attributeDescription[2].format = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescription[2].offset = offsetof(Vertex, tex);
+    
+    // -- VERTEX INPUT --
+    VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
+    vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    if(description.vertexFormat != VERTEX_FORMAT_NONE){
+        vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
+        vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;                 // List of vertex binding descriptions (data spacing, stride info, etc)
+        vertexInputCreateInfo.vertexAttributeDescriptionCount = description.vertexFormat == VERTEX_FORMAT_POS ? 1 : static_cast<uint32_t>(attributeDescription.size());
+        vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescription.data();       // List of vertex attribute descriptions (data format and where to bind to/from)
+    }
+    
+    // -- INPUT ASSEMBLY --
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;               // Primitive type to assemble vertices as
+    inputAssembly.primitiveRestartEnable = VK_FALSE;                            // Allow overriding of "strip" topology to start new primitives
+    
+    // -- VIEWPORT & SCISSOR --
+    // Only the count is fixed, actual viewport & scissor are set when recording commands (see dynamic states)
+    VkPipelineViewportStateCreateInfo viewportStageCreateInfo = {};
+    viewportStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportStageCreateInfo.viewportCount = 1;
+    viewportStageCreateInfo.pViewports = nullptr;
+    viewportStageCreateInfo.scissorCount = 1;
+    viewportStageCreateInfo.pScissors = nullptr;
+    
+    // -- DYNAMIC STATES --
+    // Pipelines don't depend on surface size, so resizing doesn't need new pipelines
+    std::array<VkDynamicState, 2> dynamicStateEnables = {
+        VK_DYNAMIC_STATE_VIEWPORT,      // Dynamic Viewport: set in command buffer with vkCmdSetViewport(commandBuffer, 0, 1, &viewport)
+        VK_DYNAMIC_STATE_SCISSOR        // Dynamic Scissor: set in command buffer with vkCmdSetScissor(commandBuffer, 0, 1, &scissor)
+    };
+    
+    VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+    dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
+    dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
+    
+    // -- RASTERIZER --
+    VkPipelineRasterizationStateCreateInfo rasterizationCreateInfo = {};
+    rasterizationCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizationCreateInfo.depthClampEnable = VK_FALSE;            // Change if fragments boyond near/far planes are clipped (default) or clamped to plane
+    rasterizationCreateInfo.rasterizerDiscardEnable = VK_FALSE;     // Whether to discard data and skip rasterizer
+    rasterizationCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;     // How to handle filling points between vertices
+    rasterizationCreateInfo.lineWidth = 1.0f;                       // How thick lines should be when drawn
+    rasterizationCreateInfo.cullMode = description.cullMode;        // Which face of the tri to cull
+    rasterizationCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;    // Winding to detetmine which side is front
+    rasterizationCreateInfo.depthBiasEnable = VK_FALSE;             // Whether to add depth bias to fragment
+    
+    // -- MULTISAMPLING --
+    VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo = {};
+    multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisamplingCreateInfo.sampleShadingEnable = VK_FALSE;                 // Enable multisample shading or not
+    multisamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;   // Number of sample to use per fragment
+    
+    // -- BLENDING --
+    VkPipelineColorBlendAttachmentState colorBlendingAttachmentState = {};
+    colorBlendingAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+                        | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;      // Colors to apply blending to
+    colorBlendingAttachmentState.blendEnable = description.blendEnable;
+    if(description.fragmentShader.empty()){
+        colorBlendingAttachmentState.colorWriteMask = 0;                            // No fragment shader, so no color to write
+        colorBlendingAttachmentState.blendEnable = VK_FALSE;
+    }
+    
+    // (new color alpha * new color) + ((1 - new color alpha) * old color)
+    colorBlendingAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendingAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendingAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+    
+    // (1 * new alpha) + (0 * old alpha) = new alpha
+    colorBlendingAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendingAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendingAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+    
+    // (1 * new color) + (1 * old color)
+    if(description.additiveBlend){
+        colorBlendingAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendingAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendingAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendingAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    }
+    
+    VkPipelineColorBlendStateCreateInfo colorBlendingCreateInfo = {};
+    colorBlendingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlendingCreateInfo.logicOpEnable = VK_FALSE;                       // Alternative to calculations is to use logical operations
+    colorBlendingCreateInfo.attachmentCount = 1;
+    colorBlendingCreateInfo.pAttachments = &colorBlendingAttachmentState;
+    
+    // -- DEPTH STENCIL TESTING --
+    VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+    depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencilCreateInfo.depthTestEnable = description.depthTestEnable;      // Enable checking depth to determine fragment write
+    depthStencilCreateInfo.depthWriteEnable = description.depthWriteEnable;    // Enable writing to depth buffer (to replace all values)
+    depthStencilCreateInfo.depthCompareOp = description.depthCompareOp;        // Comparison operation that allows an overwrite (is in front)
+    depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;                    // Depth Bounds Test: Does the depth value exists between two bounds
+    depthStencilCreateInfo.stencilTestEnable = VK_FALSE;                        // Enable Stencil Test
+    
+    // -- Graphics Pipeline Creation --
+    VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stageCount = description.fragmentShader.empty() ? 1 : 2;    // Number of shader stages
+    pipelineCreateInfo.pStages = shaderStages;                          // List of shader stages
+    pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;      // All the fixed funtion pipeline states
+    pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
+    pipelineCreateInfo.pViewportState = &viewportStageCreateInfo;
+    pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+    pipelineCreateInfo.pRasterizationState = &rasterizationCreateInfo;
+    pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
+    pipelineCreateInfo.pColorBlendState = &colorBlendingCreateInfo;
+    pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
+    pipelineCreateInfo.layout = description.layout;                     // Pipeline layout pipeline should use
+    pipelineCreateInfo.renderPass = description.renderPass;             // Renderpass description the pipeline is compatible with
+    pipelineCreateInfo.subpass = description.subpass;                   // Subpass of render pass to use with pipeline
+    pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;             // Existing pipeline to derive from
+    pipelineCreateInfo.basePipelineIndex = -1;                          // or index of pipeline being created to derive from
+    
+    // Create Graphics Pipeline
+    VkPipeline pipeline;
+    VkResult result = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create a Graphics Pipeline!");
+    }
+    
+    return pipeline;
+}
@@ -0,0 +1,96 @@
+//
+//  PipelineLibrary.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 14/06/21.
+//
+
+#ifndef PipelineLibrary_hpp
+#define PipelineLibrary_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <unordered_map>
+#include <array>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include "Utilities.h"
+#include "ShaderCompiler.hpp"
+
+// Layout of vertex data the pipeline reads
+enum VertexFormat{
+    VERTEX_FORMAT_NONE,                 // No vertex buffers, vertices generated in vertex shader (e.g. fullscreen triangle)
+    VERTEX_FORMAT_POS_COL_TEX,          // Vertex struct: position, color, texture coords
+    VERTEX_FORMAT_POS,                  // Vertex struct, position only read (e.g. depth only passes)
+};
+
+// Everything that makes one graphics pipeline different from another
+struct PipelineDescription{
+    std::string vertexShader;           // GLSL source of vertex stage (in Shaders directory)
+    std::string fragmentShader;         // GLSL source of fragment stage (in Shaders directory), empty for depth only pipelines
+    VertexFormat vertexFormat = VERTEX_FORMAT_POS_COL_TEX;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkBool32 depthTestEnable = VK_TRUE;
+    VkBool32 depthWriteEnable = VK_TRUE;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+    VkBool32 blendEnable = VK_TRUE;     // Alpha blending: (src alpha * new color) + ((1 - src alpha) * old color)
+    bool additiveBlend = false;         // Blend as new color + old color instead (e.g. counting fragments)
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+    std::vector<uint32_t> fragmentConstants;    // Specialization constant values of fragment stage (index = constant_id)
+    
+    bool operator==(const PipelineDescription &other) const;
+};
+
+struct PipelineDescriptionHash{
+    size_t operator()(const PipelineDescription &description) const;
+};
+
+class PipelineLibrary{
+public:
+    PipelineLibrary();
+    ~PipelineLibrary();
+    
+    void init(VkDevice newDevice, VkPipelineCache newPipelineCache);
+    
+    VkPipeline getPipeline(const PipelineDescription &description);
+    void requestPipeline(const PipelineDescription &description);
+    VkPipeline getComputePipeline(const std::string &computeShader, VkPipelineLayout layout);
+    void compilePending(uint32_t threadCount);
+    bool reloadChangedShaders();
+    
+    size_t getPipelineCount();
+    
+    void destroy();
+    
+private:
+    VkDevice device;
+    VkPipelineCache pipelineCache;
+    
+    std::unordered_map<PipelineDescription, VkPipeline, PipelineDescriptionHash> pipelines;
+    std::vector<PipelineDescription> pendingPipelines;
+    std::map<std::pair<std::string, VkPipelineLayout>, VkPipeline> computePipelines;
+    std::map<std::string, VkShaderModule> shaderModules;
+    
+    // - Hot reload
+    ShaderCompiler shaderCompiler;
+    std::map<std::string, time_t> shaderModifiedTimes;          // Source modification time each shader module was built from
+    std::chrono::steady_clock::time_point lastReloadCheck;
+    
+    VkShaderModule getShaderModule(const std::string &fileName);
+    VkShaderModule createShaderModule(const std::vector<uint32_t> &code);
+    VkPipeline createPipeline(const PipelineDescription &description);
+    VkPipeline createComputePipeline(const std::string &computeShader, VkPipelineLayout layout);
+    std::vector<VkPipeline> createPipelines(const std::vector<PipelineDescription> &descriptions, uint32_t threadCount, std::string *error);
+};
+
+#endif /* PipelineLibrary_hpp */
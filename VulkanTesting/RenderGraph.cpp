@@ -0,0 +1,754 @@
+//
+//  RenderGraph.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 16/06/21.
+//
+
+#include "RenderGraph.hpp"
+
+RenderGraph::RenderGraph(){
+
+}
+
+RenderGraph::~RenderGraph(){
+
+}
+
+void RenderGraph::init(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkExtent2D newExtent, uint32_t newFramebufferCount, uint32_t newInstanceCount){
+    physicalDevice = newPhysicalDevice;
+    device = newDevice;
+    extent = newExtent;
+    framebufferCount = newFramebufferCount;
+    instanceCount = newInstanceCount;
+    
+    resources.clear();
+    passes.clear();
+}
+
+// Image created and owned by the graph
+RenderResource RenderGraph::addAttachment(const std::string &name, VkFormat format, bool clear, VkClearValue clearValue){
+    RenderGraphResource resource = {};
+    resource.name = name;
+    resource.format = format;
+    resource.clear = clear;
+    resource.clearValue = clearValue;
+    
+    resources.push_back(resource);
+    return static_cast<RenderResource>(resources.size() - 1);
+}
+
+// Image owned outside the graph, views[i] is used by framebuffer i
+RenderResource RenderGraph::addExternalAttachment(const std::string &name, VkFormat format, const std::vector<VkImageView> &views, VkImageLayout finalLayout, bool clear, VkClearValue clearValue){
+    if(views.size() != framebufferCount){
+        throw std::runtime_error("External attachment " + name + " needs one view per framebuffer!");
+    }
+    
+    RenderGraphResource resource = {};
+    resource.name = name;
+    resource.format = format;
+    resource.clear = clear;
+    resource.clearValue = clearValue;
+    resource.external = true;
+    resource.externalViews = views;
+    resource.externalFinalLayout = finalLayout;
+    
+    resources.push_back(resource);
+    return static_cast<RenderResource>(resources.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const RenderGraphPass &pass){
+    passes.push_back(pass);
+    
+    // Check every resource the pass uses exists
+    for(const ResourceUse &use: getPassUses(static_cast<uint32_t>(passes.size() - 1))){
+        if(use.resource >= resources.size()){
+            passes.pop_back();
+            throw std::runtime_error("Render graph pass " + pass.name + " uses an unknown resource!");
+        }
+    }
+    
+    return static_cast<uint32_t>(passes.size() - 1);
+}
+
+// Create everything needed to execute the graph
+void RenderGraph::build(){
+    std::vector<std::vector<ResourceUse>> resourceUses = getResourceUses();
+    
+    createBatches();
+    createImages(resourceUses);
+    createRenderPasses(resourceUses);
+    createFramebuffers();
+    
+    printf(">>> Render graph: %zu passes in %zu render passes, %.1f MB attachment memory + %.1f MB lazily allocated (%.1f MB without aliasing)\n",
+           passes.size(), batches.size(), memorySize / (1024.0 * 1024.0), lazyMemorySize / (1024.0 * 1024.0), unaliasedMemorySize / (1024.0 * 1024.0));
+}
+
+// Record all passes (the command buffer must be recording)
+void RenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t imageIndex){
+    for(RenderPassBatch &batch: batches){
+        // Information about how to begin a render pass (only needed for graphical operation)
+        VkRenderPassBeginInfo renderPassBeginInfo = {};
+        renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassBeginInfo.renderPass = batch.renderPass;                          // render pass to begin
+        renderPassBeginInfo.framebuffer = batch.framebuffers[imageIndex];
+        renderPassBeginInfo.renderArea.offset = { 0,0 };                            // Start point of render pass in pixels
+        renderPassBeginInfo.renderArea.extent = extent;                             // Size of region to run render pass on (starting at offset)
+        renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(batch.clearValues.size());
+        renderPassBeginInfo.pClearValues = batch.clearValues.data();                // List of clear values (1:1 with attachments)
+        
+        // Begin render pass: this is going to call the clear function
+        vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        
+        // Viewport & scissor are dynamic state of every pipeline, set for the graph size (stays set for all subpasses)
+        VkViewport viewport = {};
+        viewport.x = 0.0f;                                  // x start coordinate
+        viewport.y = 0.0f;                                  // y start coordinate
+        viewport.width = (float) extent.width;              // width of view port
+        viewport.height = (float) extent.height;            // height of view port
+        viewport.minDepth = 0.0f;                           // min framebuffer depth
+        viewport.maxDepth = 1.0f;                           // max framebuffer depth
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        
+        VkRect2D scissor = {};
+        scissor.offset = { 0,0 };                           // Offset to use region from
+        scissor.extent = extent;                            // Extent to describe region to use, starting at offset
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        
+        for(size_t i=0; i<batch.passes.size(); i++){
+            if(i > 0){
+                vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+            }
+            
+            RenderGraphPass &pass = passes[batch.passes[i]];
+            if(pass.execute){
+                pass.execute(commandBuffer, imageIndex);
+            }
+        }
+        
+        // End render pass
+        vkCmdEndRenderPass(commandBuffer);
+    }
+}
+
+void RenderGraph::destroy(){
+    for(RenderPassBatch &batch: batches){
+        for(VkFramebuffer framebuffer: batch.framebuffers){
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+        }
+        vkDestroyRenderPass(device, batch.renderPass, nullptr);
+    }
+    batches.clear();
+    
+    for(size_t i=0; i<images.size(); i++){
+        for(size_t j=0; j<images[i].size(); j++){
+            vkDestroyImageView(device, imageViews[i][j], nullptr);
+            vkDestroyImage(device, images[i][j], nullptr);
+        }
+    }
+    images.clear();
+    imageViews.clear();
+    
+    for(VkDeviceMemory memory: slotMemory){
+        if(memory != VK_NULL_HANDLE){
+            vkFreeMemory(device, memory, nullptr);
+        }
+    }
+    slotMemory.clear();
+    memorySize = 0;
+    lazyMemorySize = 0;
+    unaliasedMemorySize = 0;
+}
+
+VkRenderPass RenderGraph::getRenderPass(uint32_t pass){
+    return batches.at(passBatch.at(pass)).renderPass;
+}
+
+uint32_t RenderGraph::getSubpass(uint32_t pass){
+    return passSubpass.at(pass);
+}
+
+VkImageView RenderGraph::getImageView(RenderResource resource, uint32_t imageIndex){
+    if(resources.at(resource).external){
+        return resources[resource].externalViews.at(imageIndex);
+    }
+    return imageViews.at(resource).at(imageIndex % instanceCount);
+}
+
+VkImage RenderGraph::getImage(RenderResource resource, uint32_t imageIndex){
+    if(resources.at(resource).external){
+        throw std::runtime_error("Render graph doesn't own image of external resource " + resources[resource].name + "!");
+    }
+    return images.at(resource).at(imageIndex % instanceCount);
+}
+
+size_t RenderGraph::getRenderPassCount(){
+    return batches.size();
+}
+
+VkDeviceSize RenderGraph::getMemorySize(){
+    return memorySize;
+}
+
+VkDeviceSize RenderGraph::getLazyMemorySize(){
+    return lazyMemorySize;
+}
+
+VkDeviceSize RenderGraph::getUnaliasedMemorySize(){
+    return unaliasedMemorySize;
+}
+
+std::vector<RenderGraph::ResourceUse> RenderGraph::getPassUses(uint32_t pass){
+    const RenderGraphPass &renderPass = passes[pass];
+    std::vector<ResourceUse> uses;
+    
+    for(RenderResource resource: renderPass.colorOutputs){
+        uses.push_back({ pass, resource, USE_COLOR_WRITE });
+    }
+    if(renderPass.depthOutput != RENDER_RESOURCE_NONE){
+        uses.push_back({ pass, renderPass.depthOutput, renderPass.depthReadOnly ? USE_DEPTH_READ : USE_DEPTH_WRITE });
+    }
+    for(RenderResource resource: renderPass.inputAttachments){
+        uses.push_back({ pass, resource, USE_INPUT_READ });
+    }
+    for(RenderResource resource: renderPass.sampledInputs){
+        uses.push_back({ pass, resource, USE_SAMPLED_READ });
+    }
+    
+    return uses;
+}
+
+// Uses of each resource in pass order
+std::vector<std::vector<RenderGraph::ResourceUse>> RenderGraph::getResourceUses(){
+    std::vector<std::vector<ResourceUse>> resourceUses(resources.size());
+    
+    for(uint32_t i=0; i<passes.size(); i++){
+        for(const ResourceUse &use: getPassUses(i)){
+            std::vector<ResourceUse> &uses = resourceUses[use.resource];
+            
+            // Shader reads need something written earlier in the frame
+            bool written = false;
+            for(const ResourceUse &earlierUse: uses){
+                written = written || isWrite(earlierUse.type);
+            }
+            if((use.type == USE_INPUT_READ || use.type == USE_SAMPLED_READ) && !written){
+                throw std::runtime_error("Render graph pass " + passes[i].name + " reads " + resources[use.resource].name + " before it is written!");
+            }
+            
+            uses.push_back(use);
+        }
+    }
+    
+    return resourceUses;
+}
+
+// Merge consecutive passes into subpasses of one render pass, until a pass samples an image written in the current render pass
+void RenderGraph::createBatches(){
+    batches.clear();
+    passBatch.resize(passes.size());
+    passSubpass.resize(passes.size());
+    
+    for(uint32_t i=0; i<passes.size(); i++){
+        bool newBatch = batches.empty();
+        
+        if(!newBatch){
+            for(RenderResource resource: passes[i].sampledInputs){
+                for(uint32_t batchPass: batches.back().passes){
+                    for(const ResourceUse &use: getPassUses(batchPass)){
+                        newBatch = newBatch || (use.resource == resource && isWrite(use.type));
+                    }
+                }
+            }
+        }
+        
+        if(newBatch){
+            batches.push_back(RenderPassBatch());
+        }
+        
+        passBatch[i] = static_cast<uint32_t>(batches.size() - 1);
+        passSubpass[i] = static_cast<uint32_t>(batches.back().passes.size());
+        batches.back().passes.push_back(i);
+    }
+}
+
+// Create graph-owned images, sharing memory between images whose lifetimes don't overlap
+void RenderGraph::createImages(const std::vector<std::vector<ResourceUse>> &resourceUses){
+    // Memory shared by one or more resources (one allocation per instance)
+    struct MemorySlot{
+        VkDeviceSize size;
+        uint32_t memoryTypeBits;
+        uint32_t lastPass;                  // Last pass using any resource in slot
+        bool external;                      // External resources get a slot of their own (no memory) for hazard tracking
+        bool transient;                     // Only holds transient images, can use lazily allocated memory
+    };
+    std::vector<MemorySlot> slots;
+    
+    images.assign(resources.size(), std::vector<VkImage>());
+    imageViews.assign(resources.size(), std::vector<VkImageView>());
+    resourceSlot.assign(resources.size(), 0);
+    
+    // Fill slots in order of first use, so a slot can be reused once its last resource is finished with
+    std::vector<RenderResource> order;
+    for(RenderResource i=0; i<resources.size(); i++){
+        if(!resourceUses[i].empty()){
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](RenderResource a, RenderResource b){
+        return resourceUses[a].front().pass < resourceUses[b].front().pass;
+    });
+    
+    for(RenderResource resource: order){
+        const std::vector<ResourceUse> &uses = resourceUses[resource];
+        
+        if(resources[resource].external){
+            resourceSlot[resource] = static_cast<uint32_t>(slots.size());
+            slots.push_back({ 0, 0, uses.back().pass, true, false });
+            continue;
+        }
+        
+        // Usage of image is everything the passes do with it
+        // Images only used as attachments inside one render pass never need to reach memory (tile-based GPUs can keep them on chip)
+        VkImageUsageFlags usage = 0;
+        bool transient = true;
+        for(const ResourceUse &use: uses){
+            transient = transient && use.type != USE_SAMPLED_READ && passBatch[use.pass] == passBatch[uses.front().pass];
+            switch(use.type){
+                case USE_COLOR_WRITE:   usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;           break;
+                case USE_DEPTH_WRITE:
+                case USE_DEPTH_READ:    usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;   break;
+                case USE_INPUT_READ:    usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;           break;
+                case USE_SAMPLED_READ:  usage |= VK_IMAGE_USAGE_SAMPLED_BIT;                    break;
+            }
+        }
+        if(transient){
+            usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
+        
+        // Image creation info (memory is bound once all images are known)
+        VkImageCreateInfo imageCreateInfo = {};
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;                       // Type of image (1D, 2D or 3D)
+        imageCreateInfo.extent.width = extent.width;                        // Width of image extent
+        imageCreateInfo.extent.height = extent.height;                      // Height of image extent
+        imageCreateInfo.extent.depth = 1;                                   // Depth of image (just 1, no 3D aspect)
+        imageCreateInfo.mipLevels = 1;                                      // Number of mipmap levels
+        imageCreateInfo.arrayLayers = 1;                                    // Number of levels in image array
+        imageCreateInfo.format = resources[resource].format;                // Format type of image
+        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;                   // How image data should be "tiled" (arranged for optimal reading)
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;          // Layout of image data on creation
+        imageCreateInfo.usage = usage;                                      // Bit flags defining what image will be used for
+        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;                    // Number of samples for multi-sampling
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;            // Whether image can be shared between queues
+        
+        images[resource].resize(instanceCount);
+        for(uint32_t i=0; i<instanceCount; i++){
+            VkResult result = vkCreateImage(device, &imageCreateInfo, nullptr, &images[resource][i]);
+            if(result != VK_SUCCESS){
+                throw std::runtime_error("Failed to create render graph image " + resources[resource].name + "!");
+            }
+        }
+        
+        VkMemoryRequirements memoryRequirements;
+        vkGetImageMemoryRequirements(device, images[resource][0], &memoryRequirements);
+        unaliasedMemorySize += memoryRequirements.size * instanceCount;
+        
+        // Find a slot that is free before this resource is first used and has a compatible memory type
+        uint32_t firstPass = uses.front().pass;
+        uint32_t slot = static_cast<uint32_t>(slots.size());
+        for(uint32_t i=0; i<slots.size(); i++){
+            if(!slots[i].external && slots[i].transient == transient && slots[i].lastPass < firstPass && (slots[i].memoryTypeBits & memoryRequirements.memoryTypeBits) != 0){
+                slot = i;
+                break;
+            }
+        }
+        if(slot == slots.size()){
+            slots.push_back({ 0, UINT32_MAX, 0, false, transient });
+        }
+        
+        slots[slot].size = std::max(slots[slot].size, memoryRequirements.size);
+        slots[slot].memoryTypeBits &= memoryRequirements.memoryTypeBits;
+        slots[slot].lastPass = uses.back().pass;
+        resourceSlot[resource] = slot;
+    }
+    
+    // Allocate memory of each slot
+    slotMemory.assign(slots.size() * instanceCount, VK_NULL_HANDLE);
+    for(size_t i=0; i<slots.size(); i++){
+        if(slots[i].external){
+            continue;
+        }
+        
+        // Transient images go in lazily allocated memory where supported (backing is only committed if the GPU needs it),
+        // otherwise (e.g. desktop GPUs) in regular device local memory
+        bool lazy = slots[i].transient && hasMemoryType(slots[i].memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+        
+        VkMemoryAllocateInfo memoryAllocateInfo = {};
+        memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        memoryAllocateInfo.allocationSize = slots[i].size;
+        memoryAllocateInfo.memoryTypeIndex = findMemoryTypeIndex(physicalDevice, slots[i].memoryTypeBits,
+                                                                 lazy ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        
+        for(uint32_t j=0; j<instanceCount; j++){
+            VkResult result = vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &slotMemory[i * instanceCount + j]);
+            if(result != VK_SUCCESS){
+                throw std::runtime_error("Failed to allocate memory for render graph images!");
+            }
+            if(lazy){
+                lazyMemorySize += slots[i].size;
+            }else{
+                memorySize += slots[i].size;
+            }
+        }
+    }
+    
+    // Bind images to memory of their slot and create views
+    for(RenderResource resource: order){
+        for(uint32_t i=0; i<images[resource].size(); i++){
+            vkBindImageMemory(device, images[resource][i], slotMemory[resourceSlot[resource] * instanceCount + i], 0);
+            
+            VkImageViewCreateInfo viewCreateInfo = {};
+            viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewCreateInfo.image = images[resource][i];                             // Image to create view for
+            viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;                        // Type of image (1D, 2D, 3D, Cube etc)
+            viewCreateInfo.format = resources[resource].format;                     // Format of image data
+            viewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;            // Allows remapping of rgba components to other rgba values
+            viewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+            viewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+            viewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+            viewCreateInfo.subresourceRange.aspectMask = isDepthFormat(resources[resource].format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+            viewCreateInfo.subresourceRange.baseMipLevel = 0;
+            viewCreateInfo.subresourceRange.levelCount = 1;
+            viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+            viewCreateInfo.subresourceRange.layerCount = 1;
+            
+            VkImageView imageView;
+            VkResult result = vkCreateImageView(device, &viewCreateInfo, nullptr, &imageView);
+            if(result != VK_SUCCESS){
+                throw std::runtime_error("Failed to create an Image view!");
+            }
+            imageViews[resource].push_back(imageView);
+        }
+    }
+}
+
+// Create a VkRenderPass per batch, with attachment load/store ops, layouts and dependencies worked out from resource uses
+void RenderGraph::createRenderPasses(const std::vector<std::vector<ResourceUse>> &resourceUses){
+    // SUBPASS DEPENDENCIES
+    // Each pair of consecutive uses of the same memory (a slot) where either use writes needs a dependency:
+    // between subpasses in the same render pass, through VK_SUBPASS_EXTERNAL across render passes,
+    // and from the last use of the previous frame to the first use of this frame
+    std::vector<std::map<std::pair<uint32_t, uint32_t>, VkSubpassDependency>> dependencies(batches.size());
+    auto addDependency = [&](uint32_t batch, uint32_t srcSubpass, uint32_t dstSubpass, const ResourceUse &src, const ResourceUse &dst, bool byRegion){
+        VkSubpassDependency &dependency = dependencies[batch][std::make_pair(srcSubpass, dstSubpass)];
+        bool first = dependency.srcStageMask == 0;
+        dependency.srcSubpass = srcSubpass;
+        dependency.dstSubpass = dstSubpass;
+        dependency.srcStageMask |= getStageMask(src.type);
+        dependency.srcAccessMask |= getAccessMask(src.type) & (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);   // Only writes need to be made available
+        dependency.dstStageMask |= getStageMask(dst.type);
+        dependency.dstAccessMask |= getAccessMask(dst.type);
+        dependency.dependencyFlags = (first || dependency.dependencyFlags) && byRegion ? VK_DEPENDENCY_BY_REGION_BIT : 0;     // Only pixel-local if every merged dependency is
+    };
+    
+    std::vector<std::vector<ResourceUse>> slotUses;
+    for(RenderResource i=0; i<resources.size(); i++){
+        if(resourceUses[i].empty()){
+            continue;
+        }
+        if(resourceSlot[i] >= slotUses.size()){
+            slotUses.resize(resourceSlot[i] + 1);
+        }
+        slotUses[resourceSlot[i]].insert(slotUses[resourceSlot[i]].end(), resourceUses[i].begin(), resourceUses[i].end());
+    }
+    
+    for(std::vector<ResourceUse> &uses: slotUses){
+        std::stable_sort(uses.begin(), uses.end(), [](const ResourceUse &a, const ResourceUse &b){ return a.pass < b.pass; });
+        
+        for(size_t i=0; i<uses.size(); i++){
+            const ResourceUse &dst = uses[i];
+            
+            // First use of the frame waits for last use of the previous frame (also covers waiting for swapchain image acquire)
+            if(i == 0){
+                addDependency(passBatch[dst.pass], VK_SUBPASS_EXTERNAL, passSubpass[dst.pass], uses.back(), dst, false);
+                // ...and previous frame's copy / compute read recorded after the graph
+                dependencies[passBatch[dst.pass]][std::make_pair(VK_SUBPASS_EXTERNAL, passSubpass[dst.pass])].srcStageMask |= getAfterGraphStageMask(dst.resource);
+                continue;
+            }
+            
+            const ResourceUse &src = uses[i - 1];
+            if(src.pass == dst.pass || (!isWrite(src.type) && !isWrite(dst.type) && src.resource == dst.resource)){
+                continue;
+            }
+            
+            if(passBatch[src.pass] == passBatch[dst.pass]){
+                addDependency(passBatch[src.pass], passSubpass[src.pass], passSubpass[dst.pass], src, dst, true);
+            }else{
+                addDependency(passBatch[src.pass], passSubpass[src.pass], VK_SUBPASS_EXTERNAL, src, dst, false);
+                addDependency(passBatch[dst.pass], VK_SUBPASS_EXTERNAL, passSubpass[dst.pass], src, dst, false);
+            }
+        }
+    }
+    
+    // External images (e.g. for presenting) are handed back after their last use
+    for(RenderResource i=0; i<resources.size(); i++){
+        if(resources[i].external && !resourceUses[i].empty()){
+            const ResourceUse &last = resourceUses[i].back();
+            VkSubpassDependency &dependency = dependencies[passBatch[last.pass]][std::make_pair(passSubpass[last.pass], VK_SUBPASS_EXTERNAL)];
+            dependency.srcSubpass = passSubpass[last.pass];
+            dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+            dependency.srcStageMask |= getStageMask(last.type);
+            dependency.srcAccessMask |= getAccessMask(last.type);
+            if(getAfterGraphStageMask(i) != 0){
+                dependency.dstStageMask |= getAfterGraphStageMask(i);
+                dependency.dstAccessMask |= getAfterGraphAccessMask(i);
+            }else{
+                dependency.dstStageMask |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+                dependency.dstAccessMask |= VK_ACCESS_MEMORY_READ_BIT;
+            }
+        }
+    }
+    
+    // ATTACHMENTS
+    std::vector<VkImageLayout> layoutAfter(resources.size(), VK_IMAGE_LAYOUT_UNDEFINED);    // Layout each resource was left in
+    std::vector<bool> written(resources.size(), false);                                     // Has contents from an earlier render pass
+    
+    for(uint32_t b=0; b<batches.size(); b++){
+        RenderPassBatch &batch = batches[b];
+        
+        // Attachments of this render pass, with the uses inside it
+        std::map<RenderResource, uint32_t> attachmentIndex;
+        std::vector<std::vector<ResourceUse>> attachmentUses;
+        for(uint32_t pass: batch.passes){
+            for(const ResourceUse &use: getPassUses(pass)){
+                if(use.type == USE_SAMPLED_READ){
+                    continue;                   // Read through a descriptor, not an attachment
+                }
+                if(attachmentIndex.find(use.resource) == attachmentIndex.end()){
+                    attachmentIndex[use.resource] = static_cast<uint32_t>(batch.attachments.size());
+                    batch.attachments.push_back(use.resource);
+                    attachmentUses.push_back(std::vector<ResourceUse>());
+                }
+                attachmentUses[attachmentIndex[use.resource]].push_back(use);
+            }
+        }
+        
+        std::vector<VkAttachmentDescription> attachmentDescriptions(batch.attachments.size());
+        for(size_t i=0; i<batch.attachments.size(); i++){
+            RenderResource resource = batch.attachments[i];
+            const RenderGraphResource &graphResource = resources[resource];
+            const ResourceUse &lastUse = attachmentUses[i].back();
+            
+            // Next use of resource after this render pass (if any)
+            const ResourceUse *nextUse = nullptr;
+            for(const ResourceUse &use: resourceUses[resource]){
+                if(use.pass > lastUse.pass){
+                    nextUse = &use;
+                    break;
+                }
+            }
+            
+            bool load = written[resource];                                                      // Keep contents from earlier render pass
+            bool store = graphResource.external || nextUse != nullptr;                          // Contents needed after this render pass
+            
+            VkAttachmentDescription &description = attachmentDescriptions[i];
+            description.format = graphResource.format;
+            description.samples = VK_SAMPLE_COUNT_1_BIT;
+            description.loadOp = load ? VK_ATTACHMENT_LOAD_OP_LOAD : (graphResource.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+            description.storeOp = store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            description.initialLayout = load ? layoutAfter[resource] : VK_IMAGE_LAYOUT_UNDEFINED;
+            description.finalLayout = nextUse != nullptr ? getLayout(*nextUse) : (graphResource.external ? graphResource.externalFinalLayout : getLayout(lastUse));
+            
+            // Attachments sharing memory within one render pass must say so
+            for(RenderResource other: batch.attachments){
+                if(other != resource && resourceSlot[other] == resourceSlot[resource]){
+                    description.flags |= VK_ATTACHMENT_DESCRIPTION_MAY_ALIAS_BIT;
+                }
+            }
+            
+            layoutAfter[resource] = description.finalLayout;
+            for(const ResourceUse &use: attachmentUses[i]){
+                written[resource] = written[resource] || isWrite(use.type);
+            }
+            
+            batch.clearValues.push_back(graphResource.clearValue);
+        }
+        
+        // SUBPASSES
+        // References must stay alive until render pass is created
+        std::vector<std::vector<VkAttachmentReference>> colorReferences(batch.passes.size());
+        std::vector<VkAttachmentReference> depthReferences(batch.passes.size());
+        std::vector<std::vector<VkAttachmentReference>> inputReferences(batch.passes.size());
+        std::vector<std::vector<uint32_t>> preserveAttachments(batch.passes.size());
+        std::vector<VkSubpassDescription> subpasses(batch.passes.size());
+        
+        for(uint32_t s=0; s<batch.passes.size(); s++){
+            const RenderGraphPass &pass = passes[batch.passes[s]];
+            
+            for(RenderResource resource: pass.colorOutputs){
+                colorReferences[s].push_back({ attachmentIndex[resource], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+            }
+            for(RenderResource resource: pass.inputAttachments){
+                inputReferences[s].push_back({ attachmentIndex[resource], getLayout({ batch.passes[s], resource, USE_INPUT_READ }) });
+            }
+            
+            subpasses[s].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+            subpasses[s].colorAttachmentCount = static_cast<uint32_t>(colorReferences[s].size());
+            subpasses[s].pColorAttachments = colorReferences[s].data();
+            subpasses[s].inputAttachmentCount = static_cast<uint32_t>(inputReferences[s].size());
+            subpasses[s].pInputAttachments = inputReferences[s].data();
+            
+            if(pass.depthOutput != RENDER_RESOURCE_NONE){
+                depthReferences[s].attachment = attachmentIndex[pass.depthOutput];
+                depthReferences[s].layout = pass.depthReadOnly ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                subpasses[s].pDepthStencilAttachment = &depthReferences[s];
+            }
+            
+            // Attachments used before and after this subpass (but not by it) must keep their contents
+            for(uint32_t i=0; i<batch.attachments.size(); i++){
+                bool usedBefore = false, usedHere = false, usedAfter = attachmentDescriptions[i].storeOp == VK_ATTACHMENT_STORE_OP_STORE;
+                for(const ResourceUse &use: attachmentUses[i]){
+                    usedBefore = usedBefore || passSubpass[use.pass] < s;
+                    usedHere = usedHere || passSubpass[use.pass] == s;
+                    usedAfter = usedAfter || passSubpass[use.pass] > s;
+                }
+                if(usedBefore && usedAfter && !usedHere){
+                    preserveAttachments[s].push_back(i);
+                }
+            }
+            subpasses[s].preserveAttachmentCount = static_cast<uint32_t>(preserveAttachments[s].size());
+            subpasses[s].pPreserveAttachments = preserveAttachments[s].data();
+        }
+        
+        std::vector<VkSubpassDependency> subpassDependencies;
+        for(auto &dependency: dependencies[b]){
+            subpassDependencies.push_back(dependency.second);
+        }
+        
+        // Create info for render pass
+        VkRenderPassCreateInfo renderPassCreateInfo = {};
+        renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassCreateInfo.attachmentCount = static_cast<uint32_t>(attachmentDescriptions.size());
+        renderPassCreateInfo.pAttachments = attachmentDescriptions.data();
+        renderPassCreateInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+        renderPassCreateInfo.pSubpasses = subpasses.data();
+        renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
+        renderPassCreateInfo.pDependencies = subpassDependencies.data();
+        
+        VkResult result = vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, &batch.renderPass);
+        if(result != VK_SUCCESS){
+            throw std::runtime_error("Failed to create a Renderpass!");
+        }
+    }
+}
+
+void RenderGraph::createFramebuffers(){
+    for(RenderPassBatch &batch: batches){
+        batch.framebuffers.resize(framebufferCount);
+        
+        for(uint32_t i=0; i<framebufferCount; i++){
+            std::vector<VkImageView> attachments;
+            for(RenderResource resource: batch.attachments){
+                attachments.push_back(getImageView(resource, i));
+            }
+            
+            VkFramebufferCreateInfo framebufferCreateInfo = {};
+            framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferCreateInfo.renderPass = batch.renderPass;                                    // Render pass layout the Framebuffer will be used with
+            framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+            framebufferCreateInfo.pAttachments = attachments.data();                                // List of attachments (1:1 with renderpass)
+            framebufferCreateInfo.width = extent.width;                                             // Framebuffer width
+            framebufferCreateInfo.height = extent.height;                                           // Framebuffer height
+            framebufferCreateInfo.layers = 1;                                                       // Framebuffer layers
+            
+            VkResult result = vkCreateFramebuffer(device, &framebufferCreateInfo, nullptr, &batch.framebuffers[i]);
+            if(result != VK_SUCCESS){
+                throw std::runtime_error("Failed to create a Framebuffer!");
+            }
+        }
+    }
+}
+
+// Whether any of the allowed memory types has the properties
+bool RenderGraph::hasMemoryType(uint32_t allowedTypes, VkMemoryPropertyFlags properties){
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    
+    for(uint32_t i=0; i<memoryProperties.memoryTypeCount; i++){
+        if((allowedTypes & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RenderGraph::isDepthFormat(VkFormat format){
+    return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 || format == VK_FORMAT_D32_SFLOAT
+        || format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+bool RenderGraph::isWrite(ResourceUseType type){
+    return type == USE_COLOR_WRITE || type == USE_DEPTH_WRITE;
+}
+
+// Stage of work recorded after the graph that reads an external image, from the layout it's left in (0 if none, e.g. presenting)
+// - TRANSFER_SRC_OPTIMAL: copied (e.g. reading results back to host)
+// - SHADER_READ_ONLY_OPTIMAL / DEPTH_STENCIL_READ_ONLY_OPTIMAL: sampled by a compute shader (e.g. building the Hi-Z pyramid)
+VkPipelineStageFlags RenderGraph::getAfterGraphStageMask(RenderResource resource){
+    if(!resources[resource].external){
+        return 0;
+    }
+    switch(resources[resource].externalFinalLayout){
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:              return VK_PIPELINE_STAGE_TRANSFER_BIT;
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:   return VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        default:                                                return 0;
+    }
+}
+
+VkAccessFlags RenderGraph::getAfterGraphAccessMask(RenderResource resource){
+    switch(getAfterGraphStageMask(resource)){
+        case VK_PIPELINE_STAGE_TRANSFER_BIT:        return VK_ACCESS_TRANSFER_READ_BIT;
+        case VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT:  return VK_ACCESS_SHADER_READ_BIT;
+        default:                                    return 0;
+    }
+}
+
+// Image layout a resource must be in for a use
+VkImageLayout RenderGraph::getLayout(const ResourceUse &use){
+    bool depth = isDepthFormat(resources[use.resource].format);
+    switch(use.type){
+        case USE_COLOR_WRITE:   return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        case USE_DEPTH_WRITE:   return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        case USE_DEPTH_READ:    return VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        case USE_INPUT_READ:
+        case USE_SAMPLED_READ:  return depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+    return VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+// Pipeline stages a use happens in
+VkPipelineStageFlags RenderGraph::getStageMask(ResourceUseType type){
+    switch(type){
+        case USE_COLOR_WRITE:   return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        case USE_DEPTH_WRITE:
+        case USE_DEPTH_READ:    return VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        case USE_INPUT_READ:
+        case USE_SAMPLED_READ:  return VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
+    return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+}
+
+// Memory accesses of a use
+VkAccessFlags RenderGraph::getAccessMask(ResourceUseType type){
+    switch(type){
+        case USE_COLOR_WRITE:   return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;          // Read for blending
+        case USE_DEPTH_WRITE:   return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        case USE_DEPTH_READ:    return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        case USE_INPUT_READ:    return VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+        case USE_SAMPLED_READ:  return VK_ACCESS_SHADER_READ_BIT;
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+//
+//  RenderGraph.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 16/06/21.
+//
+
+#ifndef RenderGraph_hpp
+#define RenderGraph_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <algorithm>
+
+#include "Utilities.h"
+
+// Index of a resource (attachment image) in the graph
+typedef uint32_t RenderResource;
+const RenderResource RENDER_RESOURCE_NONE = UINT32_MAX;
+
+// Attachment image read or written by passes
+struct RenderGraphResource{
+    std::string name;
+    VkFormat format;
+    bool clear = false;                             // Clear before first write of a frame (otherwise starts undefined)
+    VkClearValue clearValue = {};
+    
+    // External resources are owned outside the graph (e.g. swapchain images), one view per framebuffer
+    bool external = false;
+    std::vector<VkImageView> externalViews;
+    VkImageLayout externalFinalLayout = VK_IMAGE_LAYOUT_UNDEFINED;  // Layout to leave image in at end of graph
+                                                                    // (TRANSFER_SRC_OPTIMAL: copied from after the graph,
+                                                                    //  read-only depth / SHADER_READ_ONLY_OPTIMAL: sampled by compute after the graph)
+};
+
+// One rendering step: declares the resources it uses, records its draw commands in execute
+struct RenderGraphPass{
+    std::string name;
+    std::vector<RenderResource> colorOutputs;       // Written as color attachments
+    RenderResource depthOutput = RENDER_RESOURCE_NONE;
+    bool depthReadOnly = false;                     // Depth test against depthOutput without writing it
+    std::vector<RenderResource> inputAttachments;   // Read at the same pixel (subpassLoad)
+    std::vector<RenderResource> sampledInputs;      // Read at any pixel through a sampler (needs a separate render pass)
+    
+    std::function<void(VkCommandBuffer commandBuffer, uint32_t imageIndex)> execute;
+};
+
+// Builds render passes, subpass dependencies, framebuffers and attachment images from declared passes
+// - Passes run in the order they are added
+// - Consecutive passes are merged as subpasses of one render pass unless one samples an image written in the same render pass
+// - Images whose lifetimes (first to last pass using them) don't overlap share memory
+// - Images only used inside one render pass are transient attachments (lazily allocated memory where supported)
+class RenderGraph{
+public:
+    RenderGraph();
+    ~RenderGraph();
+    
+    void init(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkExtent2D newExtent, uint32_t newFramebufferCount, uint32_t newInstanceCount);
+    
+    RenderResource addAttachment(const std::string &name, VkFormat format, bool clear, VkClearValue clearValue);
+    RenderResource addExternalAttachment(const std::string &name, VkFormat format, const std::vector<VkImageView> &views, VkImageLayout finalLayout, bool clear, VkClearValue clearValue);
+    uint32_t addPass(const RenderGraphPass &pass);
+    
+    void build();
+    void execute(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void destroy();
+    
+    VkRenderPass getRenderPass(uint32_t pass);
+    uint32_t getSubpass(uint32_t pass);
+    VkImageView getImageView(RenderResource resource, uint32_t imageIndex);
+    VkImage getImage(RenderResource resource, uint32_t imageIndex);
+    size_t getRenderPassCount();
+    VkDeviceSize getMemorySize();
+    VkDeviceSize getLazyMemorySize();
+    VkDeviceSize getUnaliasedMemorySize();
+
+private:
+    enum ResourceUseType{
+        USE_COLOR_WRITE,
+        USE_DEPTH_WRITE,
+        USE_DEPTH_READ,
+        USE_INPUT_READ,
+        USE_SAMPLED_READ,
+    };
+    
+    struct ResourceUse{
+        uint32_t pass;
+        RenderResource resource;
+        ResourceUseType type;
+    };
+    
+    // Passes merged into one VkRenderPass
+    struct RenderPassBatch{
+        std::vector<uint32_t> passes;                   // Subpass i runs passes[i]
+        std::vector<RenderResource> attachments;        // Framebuffer attachment i
+        VkRenderPass renderPass;
+        std::vector<VkFramebuffer> framebuffers;        // One per framebuffer index (image index)
+        std::vector<VkClearValue> clearValues;
+    };
+    
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    VkExtent2D extent;
+    uint32_t framebufferCount;                          // Number of views of external resources (e.g. swapchain images)
+    uint32_t instanceCount;                             // Copies of each graph-owned image (image index % instanceCount), 1 is enough when the
+                                                        // wrap-around dependency serialises frames on the queue
+    
+    std::vector<RenderGraphResource> resources;
+    std::vector<RenderGraphPass> passes;
+    std::vector<RenderPassBatch> batches;
+    std::vector<uint32_t> passBatch;                    // Batch of each pass
+    std::vector<uint32_t> passSubpass;                  // Subpass of each pass in its batch
+    
+    // - Images & memory
+    std::vector<uint32_t> resourceSlot;                 // Memory slot of each resource, resources in the same slot alias
+    std::vector<std::vector<VkImage>> images;           // [resource][instance]
+    std::vector<std::vector<VkImageView>> imageViews;   // [resource][instance]
+    std::vector<VkDeviceMemory> slotMemory;             // [slot * instanceCount + instance]
+    VkDeviceSize memorySize = 0;
+    VkDeviceSize lazyMemorySize = 0;                    // Only committed by the driver if actually needed
+    VkDeviceSize unaliasedMemorySize = 0;
+    
+    std::vector<ResourceUse> getPassUses(uint32_t pass);
+    std::vector<std::vector<ResourceUse>> getResourceUses();
+    
+    void createBatches();
+    void createImages(const std::vector<std::vector<ResourceUse>> &resourceUses);
+    void createRenderPasses(const std::vector<std::vector<ResourceUse>> &resourceUses);
+    void createFramebuffers();
+    
+    bool hasMemoryType(uint32_t allowedTypes, VkMemoryPropertyFlags properties);
+    static bool isDepthFormat(VkFormat format);
+    static bool isWrite(ResourceUseType type);
+    VkPipelineStageFlags getAfterGraphStageMask(RenderResource resource);
+    VkAccessFlags getAfterGraphAccessMask(RenderResource resource);
+    VkImageLayout getLayout(const ResourceUse &use);
+    static VkPipelineStageFlags getStageMask(ResourceUseType type);
+    static VkAccessFlags getAccessMask(ResourceUseType type);
+};
+
+#endif /* RenderGraph_hpp */
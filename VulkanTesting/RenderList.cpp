@@ -0,0 +1,51 @@
+//
+//  RenderList.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 18/06/21.
+//
+
+#include "RenderList.hpp"
+
+void RenderList::clear(){
+    vertexBuffers.clear();
+    indexBuffers.clear();
+    vertexOffsets.clear();
+    firstIndices.clear();
+    indexCounts.clear();
+    textureIds.clear();
+    geometryIds.clear();
+    transformIndices.clear();
+    boundsCentres.clear();
+    boundsExtents.clear();
+    firstLods.clear();
+    lodCounts.clear();
+    lods.clear();
+    firstMeshlets.clear();
+    meshletCounts.clear();
+    meshlets.clear();
+    vertexBufferIds.clear();
+}
+
+void RenderList::addMesh(Mesh *mesh, uint32_t transformIndex){
+    vertexBuffers.push_back(mesh->getVertexBuffer());
+    indexBuffers.push_back(mesh->getIndexBuffer());
+    vertexOffsets.push_back(0);                             // Every mesh has buffers of its own
+    firstIndices.push_back(0);
+    indexCounts.push_back(static_cast<uint32_t>(mesh->getIndexCount()));
+    textureIds.push_back(static_cast<uint32_t>(mesh->getTexId()));
+    geometryIds.push_back(vertexBufferIds.insert({ mesh->getVertexBuffer(), static_cast<uint32_t>(vertexBufferIds.size()) }).first->second);
+    transformIndices.push_back(transformIndex);
+    boundsCentres.push_back(mesh->getBoundsCentre());
+    boundsExtents.push_back(mesh->getBoundsExtent());
+    firstLods.push_back(static_cast<uint32_t>(lods.size()));
+    lodCounts.push_back(static_cast<uint32_t>(mesh->getLods().size()));
+    lods.insert(lods.end(), mesh->getLods().begin(), mesh->getLods().end());
+    firstMeshlets.push_back(static_cast<uint32_t>(meshlets.size()));
+    meshletCounts.push_back(static_cast<uint32_t>(mesh->getMeshlets().size()));
+    meshlets.insert(meshlets.end(), mesh->getMeshlets().begin(), mesh->getMeshlets().end());
+}
+
+size_t RenderList::size(){
+    return indexCounts.size();
+}
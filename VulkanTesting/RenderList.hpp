@@ -0,0 +1,45 @@
+//
+//  RenderList.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 18/06/21.
+//
+
+#ifndef RenderList_hpp
+#define RenderList_hpp
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <map>
+
+#include "Mesh.hpp"
+
+// Draw data of every mesh in the scene as flat arrays (entry i of each array belongs to mesh i)
+// Rebuilt only when models are added or removed, so recording a frame just walks the arrays
+struct RenderList{
+    std::vector<VkBuffer> vertexBuffers;
+    std::vector<VkBuffer> indexBuffers;
+    std::vector<int32_t> vertexOffsets;         // Added to every index (vkCmdDrawIndexed vertexOffset)
+    std::vector<uint32_t> firstIndices;         // First index in index buffer
+    std::vector<uint32_t> indexCounts;
+    std::vector<uint32_t> textureIds;           // Index into samplerDescriptorSets
+    std::vector<uint32_t> geometryIds;          // Meshes sharing a vertex buffer share an id (compact, for draw sort keys)
+    std::vector<uint32_t> transformIndices;     // Model the mesh belongs to (index into model transforms)
+    std::vector<glm::vec3> boundsCentres;       // Centre of mesh bounds in model space
+    std::vector<glm::vec3> boundsExtents;       // Half size of mesh bounds
+    std::vector<uint32_t> firstLods;            // Mesh's levels of detail in lods (full detail first)
+    std::vector<uint32_t> lodCounts;
+    std::vector<MeshLod> lods;                  // Levels of detail of all meshes
+    std::vector<uint32_t> firstMeshlets;        // Mesh's meshlets in meshlets (none for small meshes)
+    std::vector<uint32_t> meshletCounts;
+    std::vector<Meshlet> meshlets;              // Meshlets of all meshes
+    std::map<VkBuffer, uint32_t> vertexBufferIds;   // Id given to each vertex buffer so far (only used while adding meshes)
+    
+    void clear();
+    void addMesh(Mesh *mesh, uint32_t transformIndex);
+    size_t size();
+};
+
+#endif /* RenderList_hpp */
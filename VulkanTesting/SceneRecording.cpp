@@ -0,0 +1,265 @@
+//
+//  SceneRecording.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 23/06/21.
+//
+
+#include "SceneRecording.hpp"
+#include "VulkanRenderer.hpp"
+
+// -- RECORDER --
+SceneRecorder::SceneRecorder(){
+
+}
+
+SceneRecorder::~SceneRecorder(){
+    close();
+}
+
+void SceneRecorder::open(const std::string &fileName){
+    close();
+    file.open(fileName, std::ios::binary | std::ios::trunc);
+    if(!file.is_open()){
+        throw std::runtime_error("Failed to open scene recording " + fileName + "!");
+    }
+    write(SCENE_RECORDING_MAGIC);
+    write(SCENE_RECORDING_VERSION);
+    frameCount = 0;
+}
+
+void SceneRecorder::close(){
+    if(file.is_open()){
+        file.close();
+    }
+}
+
+bool SceneRecorder::isRecording(){
+    return file.is_open();
+}
+
+uint32_t SceneRecorder::getFrameCount(){
+    return frameCount;
+}
+
+void SceneRecorder::recordCreateModel(const std::string &modelFile, unsigned int importFlags, ModelHandle model){
+    writeCommand(SCENE_COMMAND_CREATE_MODEL_FILE);
+    writeString(modelFile);
+    write(static_cast<uint32_t>(importFlags));
+    writeHandle(model);
+}
+
+void SceneRecorder::recordCreateModel(const std::vector<MeshData> &meshData, const std::string &cacheKey, ModelHandle model){
+    writeCommand(SCENE_COMMAND_CREATE_MODEL_DATA);
+    writeString(cacheKey);
+    write(static_cast<uint32_t>(meshData.size()));
+    for(const MeshData &mesh: meshData){
+        write(static_cast<uint32_t>(mesh.vertices.size()));
+        file.write(reinterpret_cast<const char *>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+        write(static_cast<uint32_t>(mesh.indices.size()));
+        file.write(reinterpret_cast<const char *>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+        write(static_cast<int32_t>(mesh.textureId));
+    }
+    writeHandle(model);
+}
+
+void SceneRecorder::recordDestroyModel(ModelHandle model){
+    writeCommand(SCENE_COMMAND_DESTROY_MODEL);
+    writeHandle(model);
+}
+
+void SceneRecorder::recordUpdateModel(ModelHandle model, const glm::mat4 &transform){
+    writeCommand(SCENE_COMMAND_UPDATE_MODEL);
+    writeHandle(model);
+    write(transform);
+}
+
+void SceneRecorder::recordCreateTexture(const std::string &fileName, int textureId){
+    writeCommand(SCENE_COMMAND_CREATE_TEXTURE_FILE);
+    writeString(fileName);
+    write(static_cast<int32_t>(textureId));
+}
+
+void SceneRecorder::recordCreateTexture(const std::vector<uint8_t> &pixels, int width, int height, int textureId){
+    writeCommand(SCENE_COMMAND_CREATE_TEXTURE_PIXELS);
+    write(static_cast<int32_t>(width));
+    write(static_cast<int32_t>(height));
+    file.write(reinterpret_cast<const char *>(pixels.data()), static_cast<size_t>(width) * height * 4);
+    write(static_cast<int32_t>(textureId));
+}
+
+void SceneRecorder::recordReleaseTexture(int textureId){
+    writeCommand(SCENE_COMMAND_RELEASE_TEXTURE);
+    write(static_cast<int32_t>(textureId));
+}
+
+void SceneRecorder::recordCamera(const glm::mat4 &view){
+    writeCommand(SCENE_COMMAND_SET_CAMERA);
+    write(view);
+}
+
+void SceneRecorder::recordFrame(){
+    writeCommand(SCENE_COMMAND_FRAME);
+    frameCount++;
+}
+
+template <typename T>
+void SceneRecorder::write(const T &value){
+    file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void SceneRecorder::writeString(const std::string &text){
+    write(static_cast<uint32_t>(text.size()));
+    file.write(text.data(), text.size());
+}
+
+void SceneRecorder::writeCommand(SceneCommand command){
+    write(static_cast<uint8_t>(command));
+}
+
+void SceneRecorder::writeHandle(ModelHandle model){
+    write(model.index);
+    write(model.generation);
+}
+
+// -- REPLAYER --
+SceneReplayer::SceneReplayer(){
+
+}
+
+SceneReplayer::~SceneReplayer(){
+
+}
+
+void SceneReplayer::open(const std::string &fileName){
+    file.open(fileName, std::ios::binary);
+    if(!file.is_open()){
+        throw std::runtime_error("Failed to open scene recording " + fileName + "!");
+    }
+    if(read<uint32_t>() != SCENE_RECORDING_MAGIC || read<uint32_t>() != SCENE_RECORDING_VERSION){
+        throw std::runtime_error("Not a scene recording (or recorded by another version): " + fileName + "!");
+    }
+    frameCount = 0;
+    models.clear();
+    textures.clear();
+}
+
+// Issue recorded calls up to next frame and draw it, false once recording has no frames left
+bool SceneReplayer::replayFrame(VulkanRenderer &renderer){
+    while(true){
+        uint8_t command = 0;
+        file.read(reinterpret_cast<char *>(&command), sizeof(command));
+        if(!file){
+            return false;
+        }
+        
+        switch(command){
+            case SCENE_COMMAND_CREATE_MODEL_FILE:{
+                std::string modelFile = readString();
+                unsigned int importFlags = read<uint32_t>();
+                ModelHandle recorded = readHandle();
+                models[getHandleKey(recorded)] = renderer.createMeshModel(modelFile, importFlags);
+                break;
+            }
+            case SCENE_COMMAND_CREATE_MODEL_DATA:{
+                std::string cacheKey = readString();
+                std::vector<MeshData> meshData(read<uint32_t>());
+                for(MeshData &mesh: meshData){
+                    mesh.vertices.resize(read<uint32_t>());
+                    file.read(reinterpret_cast<char *>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+                    mesh.indices.resize(read<uint32_t>());
+                    file.read(reinterpret_cast<char *>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+                    mesh.textureId = mapTexture(read<int32_t>());
+                }
+                ModelHandle recorded = readHandle();
+                models[getHandleKey(recorded)] = renderer.createMeshModel(meshData, cacheKey);
+                break;
+            }
+            case SCENE_COMMAND_DESTROY_MODEL:{
+                auto model = models.find(getHandleKey(readHandle()));
+                if(model != models.end()){
+                    renderer.destroyMeshModel(model->second);
+                    models.erase(model);
+                }
+                break;
+            }
+            case SCENE_COMMAND_UPDATE_MODEL:{
+                ModelHandle recorded = readHandle();
+                glm::mat4 transform = read<glm::mat4>();
+                auto model = models.find(getHandleKey(recorded));
+                if(model != models.end()){
+                    renderer.updateModel(model->second, transform);
+                }
+                break;
+            }
+            case SCENE_COMMAND_CREATE_TEXTURE_FILE:{
+                std::string fileName = readString();
+                int recorded = read<int32_t>();
+                textures[recorded] = renderer.createTexture(fileName);
+                break;
+            }
+            case SCENE_COMMAND_CREATE_TEXTURE_PIXELS:{
+                int width = read<int32_t>();
+                int height = read<int32_t>();
+                std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+                file.read(reinterpret_cast<char *>(pixels.data()), pixels.size());
+                int recorded = read<int32_t>();
+                textures[recorded] = renderer.createTexture(pixels, width, height);
+                break;
+            }
+            case SCENE_COMMAND_RELEASE_TEXTURE:{
+                int recorded = read<int32_t>();
+                renderer.releaseTexture(mapTexture(recorded));
+                textures.erase(recorded);
+                break;
+            }
+            case SCENE_COMMAND_SET_CAMERA:
+                renderer.setCamera(read<glm::mat4>());
+                break;
+            case SCENE_COMMAND_FRAME:
+                renderer.draw();
+                frameCount++;
+                return true;
+            default:
+                throw std::runtime_error("Unknown command in scene recording!");
+        }
+        
+        if(!file){
+            throw std::runtime_error("Scene recording ends in the middle of a command!");
+        }
+    }
+}
+
+uint32_t SceneReplayer::getFrameCount(){
+    return frameCount;
+}
+
+template <typename T>
+T SceneReplayer::read(){
+    T value = {};
+    file.read(reinterpret_cast<char *>(&value), sizeof(T));
+    return value;
+}
+
+std::string SceneReplayer::readString(){
+    std::string text(read<uint32_t>(), '\0');
+    file.read(&text[0], text.size());
+    return text;
+}
+
+ModelHandle SceneReplayer::readHandle(){
+    ModelHandle model = {};
+    model.index = read<uint32_t>();
+    model.generation = read<uint32_t>();
+    return model;
+}
+
+uint64_t SceneReplayer::getHandleKey(ModelHandle model){
+    return (static_cast<uint64_t>(model.index) << 32) | model.generation;
+}
+
+// Texture 0 (default texture) and ids created outside the recording keep their value
+int SceneReplayer::mapTexture(int textureId){
+    auto texture = textures.find(textureId);
+    return texture != textures.end() ? texture->second : textureId;
+}
@@ -0,0 +1,96 @@
+//
+//  SceneRecording.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 23/06/21.
+//
+
+#ifndef SceneRecording_hpp
+#define SceneRecording_hpp
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <cstdint>
+
+#include "Utilities.h"
+#include "Mesh.hpp"
+
+class VulkanRenderer;
+
+// Commands in a scene recording, each written as a 1 byte type followed by its data
+enum SceneCommand{
+    SCENE_COMMAND_CREATE_MODEL_FILE = 1,    // file, import flags, handle
+    SCENE_COMMAND_CREATE_MODEL_DATA,        // cache key, meshes (vertices, indices, texture), handle
+    SCENE_COMMAND_DESTROY_MODEL,            // handle
+    SCENE_COMMAND_UPDATE_MODEL,             // handle, matrix
+    SCENE_COMMAND_CREATE_TEXTURE_FILE,      // file, texture id
+    SCENE_COMMAND_CREATE_TEXTURE_PIXELS,    // width, height, pixels, texture id
+    SCENE_COMMAND_RELEASE_TEXTURE,          // texture id
+    SCENE_COMMAND_SET_CAMERA,               // view matrix
+    SCENE_COMMAND_FRAME,                    // draw() called, commands before it apply to this frame
+};
+
+const uint32_t SCENE_RECORDING_MAGIC = 0x52534B56;     // "VKSR"
+const uint32_t SCENE_RECORDING_VERSION = 1;
+
+// Writes renderer API calls to a binary log (native byte order, same machine/build family is expected to replay it)
+class SceneRecorder{
+public:
+    SceneRecorder();
+    ~SceneRecorder();
+    
+    void open(const std::string &fileName);
+    void close();
+    bool isRecording();
+    uint32_t getFrameCount();
+    
+    void recordCreateModel(const std::string &modelFile, unsigned int importFlags, ModelHandle model);
+    void recordCreateModel(const std::vector<MeshData> &meshData, const std::string &cacheKey, ModelHandle model);
+    void recordDestroyModel(ModelHandle model);
+    void recordUpdateModel(ModelHandle model, const glm::mat4 &transform);
+    void recordCreateTexture(const std::string &fileName, int textureId);
+    void recordCreateTexture(const std::vector<uint8_t> &pixels, int width, int height, int textureId);
+    void recordReleaseTexture(int textureId);
+    void recordCamera(const glm::mat4 &view);
+    void recordFrame();
+
+private:
+    std::ofstream file;
+    uint32_t frameCount = 0;
+    
+    template <typename T>
+    void write(const T &value);
+    void writeString(const std::string &text);
+    void writeCommand(SceneCommand command);
+    void writeHandle(ModelHandle model);
+};
+
+// Feeds a recording back into a renderer one frame at a time (a fixed step per frame, independent of wall clock)
+// Handles & texture ids from the recording are mapped to the ones the renderer hands out on replay
+class SceneReplayer{
+public:
+    SceneReplayer();
+    ~SceneReplayer();
+    
+    void open(const std::string &fileName);
+    bool replayFrame(VulkanRenderer &renderer);
+    uint32_t getFrameCount();
+
+private:
+    std::ifstream file;
+    uint32_t frameCount = 0;
+    std::map<uint64_t, ModelHandle> models;     // Recorded handle (index << 32 | generation) to replayed handle
+    std::map<int, int> textures;                // Recorded texture id to replayed texture id
+    
+    template <typename T>
+    T read();
+    std::string readString();
+    ModelHandle readHandle();
+    static uint64_t getHandleKey(ModelHandle model);
+    int mapTexture(int textureId);
+};
+
+#endif /* SceneRecording_hpp */
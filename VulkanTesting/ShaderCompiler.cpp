@@ -0,0 +1,123 @@
+//
+//  ShaderCompiler.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 15/06/21.
+//
+
+#include "ShaderCompiler.hpp"
+
+ShaderCompiler::ShaderCompiler(){
+    // Same settings the old compile_shader.sh used (glslangValidator -V): Vulkan 1.0 environment
+    options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+    options.SetOptimizationLevel(shaderc_optimization_level_performance);
+    
+    // Bump SHADER_CACHE_VERSION if any option above changes, so old cache files are not reused
+    optionsKey = "vulkan1.0|performance|" + std::to_string(SHADER_CACHE_VERSION);
+    
+    // getcwd allocates the path it returns
+    char *directory = getcwd(NULL, 0);
+    workingDirectory = directory ? directory : ".";
+    free(directory);
+}
+
+ShaderCompiler::~ShaderCompiler(){
+
+}
+
+// Get SPIR-V code of shader source file (in Shaders directory), from disk cache if possible
+std::vector<uint32_t> ShaderCompiler::compile(const std::string &sourceFile){
+    auto source = readFile(sourceFile);
+    std::string sourceText(source.begin(), source.end());
+    
+    // Cache file name is hash of everything that affects the output
+    char hashText[17];
+    snprintf(hashText, sizeof(hashText), "%016llx", (unsigned long long) hash(sourceFile + "|" + optionsKey + "|" + sourceText));
+    std::string cacheFile = workingDirectory + "/" + SHADER_CACHE_DIRECTORY + "/" + hashText + ".spv";
+    
+    std::vector<uint32_t> code;
+    if(readCachedCode(cacheFile, &code)){
+        return code;
+    }
+    
+    // Not cached yet, compile source
+    shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(sourceText, getShaderKind(sourceFile), sourceFile.c_str(), options);
+    if(result.GetCompilationStatus() != shaderc_compilation_status_success){
+        throw std::runtime_error("Failed to compile shader " + sourceFile + "!\n" + result.GetErrorMessage());
+    }
+    
+    code.assign(result.cbegin(), result.cend());
+    writeCachedCode(cacheFile, code);
+    printf(">>> Compiled shader %s\n", sourceFile.c_str());
+    
+    return code;
+}
+
+// Last modification time of shader source file (in Shaders directory), 0 if it can't be read
+time_t ShaderCompiler::getModifiedTime(const std::string &sourceFile){
+    std::string fullFilePath = workingDirectory + "/Shaders/" + sourceFile;
+    struct stat fileStat;
+    if(stat(fullFilePath.c_str(), &fileStat) != 0){
+        return 0;
+    }
+    return fileStat.st_mtime;
+}
+
+// Shader stage comes from file extension (same convention glslangValidator uses)
+shaderc_shader_kind ShaderCompiler::getShaderKind(const std::string &sourceFile){
+    static const std::map<std::string, shaderc_shader_kind> shaderKinds = {
+        { "vert", shaderc_vertex_shader },
+        { "frag", shaderc_fragment_shader },
+        { "comp", shaderc_compute_shader },
+    };
+    
+    std::string extension = sourceFile.substr(sourceFile.find_last_of('.') + 1);
+    auto shaderKind = shaderKinds.find(extension);
+    if(shaderKind == shaderKinds.end()){
+        throw std::runtime_error("Unknown shader stage for file " + sourceFile + "!");
+    }
+    return shaderKind->second;
+}
+
+// 64-bit FNV-1a hash
+uint64_t ShaderCompiler::hash(const std::string &text){
+    uint64_t value = 14695981039346656037ull;
+    for(unsigned char c: text){
+        value ^= c;
+        value *= 1099511628211ull;
+    }
+    return value;
+}
+
+bool ShaderCompiler::readCachedCode(const std::string &cacheFile, std::vector<uint32_t> *code){
+    std::ifstream file(cacheFile, std::ios::binary | std::ios::ate);
+    if(!file.is_open()){
+        return false;
+    }
+    
+    size_t fileSize = (size_t)file.tellg();
+    if(fileSize == 0 || fileSize % sizeof(uint32_t) != 0){
+        return false;                   // Damaged file, compile again
+    }
+    
+    code->resize(fileSize / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(code->data()), fileSize);
+    file.close();
+    
+    return true;
+}
+
+void ShaderCompiler::writeCachedCode(const std::string &cacheFile, const std::vector<uint32_t> &code){
+    // Make sure cache directory exists (fails harmlessly if it already does)
+    std::string directory = workingDirectory + "/" + SHADER_CACHE_DIRECTORY;
+    mkdir(directory.c_str(), 0755);
+    
+    std::ofstream file(cacheFile, std::ios::binary | std::ios::trunc);
+    if(!file.is_open()){
+        printf(">>> Failed to save shader cache (%s)\n", cacheFile.c_str());
+        return;
+    }
+    file.write(reinterpret_cast<const char *>(code.data()), code.size() * sizeof(uint32_t));
+    file.close();
+}
@@ -0,0 +1,47 @@
+//
+//  ShaderCompiler.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 15/06/21.
+//
+
+#ifndef ShaderCompiler_hpp
+#define ShaderCompiler_hpp
+
+#include <shaderc/shaderc.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <map>
+#include <sys/stat.h>
+#include <cstdlib>
+
+#include "Utilities.h"
+
+// Compiles GLSL sources in Shaders directory to SPIR-V at runtime
+// Compiled code is cached on disk (SHADER_CACHE_DIRECTORY), keyed by a hash of the source and compile options,
+// so unchanged shaders are only compiled once
+class ShaderCompiler{
+public:
+    ShaderCompiler();
+    ~ShaderCompiler();
+    
+    std::vector<uint32_t> compile(const std::string &sourceFile);
+    
+    time_t getModifiedTime(const std::string &sourceFile);
+
+private:
+    shaderc::Compiler compiler;
+    shaderc::CompileOptions options;
+    std::string optionsKey;             // Text form of options, part of the cache hash
+    std::string workingDirectory;       // Resolved once, modification times are polled for the whole session
+    
+    static shaderc_shader_kind getShaderKind(const std::string &sourceFile);
+    static uint64_t hash(const std::string &text);
+    
+    bool readCachedCode(const std::string &cacheFile, std::vector<uint32_t> *code);
+    void writeCachedCode(const std::string &cacheFile, const std::vector<uint32_t> &code);
+};
+
+#endif /* ShaderCompiler_hpp */
@@ -0,0 +1,162 @@
+//
+//  TaskGraph.cpp
+//  VulkanTesting
+//
+//  Created by Apple on 20/06/21.
+//
+
+#include "TaskGraph.hpp"
+
+TaskGraph::TaskGraph(){
+
+}
+
+TaskGraph::~TaskGraph(){
+
+}
+
+TaskId TaskGraph::addTask(const std::string &name, std::function<void()> run, const std::vector<TaskId> &dependencies, bool mainThread){
+    TaskId id = static_cast<TaskId>(tasks.size());
+    
+    Task task = {};
+    task.name = name;
+    task.run = run;
+    task.mainThread = mainThread;
+    for(TaskId dependency: dependencies){
+        if(dependency >= id){
+            throw std::runtime_error("Task " + name + " depends on a task that hasn't been added!");
+        }
+        tasks[dependency].dependents.push_back(id);
+        task.dependencyCount++;
+    }
+    
+    tasks.push_back(task);
+    return id;
+}
+
+// Run all tasks, calling thread works too (threadCount includes it)
+void TaskGraph::execute(uint32_t threadCount){
+    startTime = std::chrono::steady_clock::now();
+    timings.assign(tasks.size(), TaskTiming());
+    remainingDependencies.resize(tasks.size());
+    readyTasks.clear();
+    readyMainTasks.clear();
+    finishedCount = 0;
+    runningCount = 0;
+    error = nullptr;
+    
+    // Tasks without dependencies can start right away
+    for(TaskId i=0; i<tasks.size(); i++){
+        timings[i].name = tasks[i].name;
+        remainingDependencies[i] = tasks[i].dependencyCount;
+        if(remainingDependencies[i] == 0){
+            (tasks[i].mainThread ? readyMainTasks : readyTasks).push_back(i);
+        }
+    }
+    
+    threadCount = std::max(1u, threadCount);
+    std::vector<std::thread> workers;
+    for(uint32_t i=1; i<threadCount; i++){
+        workers.push_back(std::thread(&TaskGraph::work, this, i));
+    }
+    work(0);
+    for(auto &thread: workers){
+        thread.join();
+    }
+    
+    totalTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    
+    if(error){
+        std::rethrow_exception(error);
+    }
+}
+
+void TaskGraph::work(uint32_t thread){
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true){
+        // Wait for a task this thread may run, or for the graph to be done
+        TaskId id = 0;
+        bool found = false;
+        while(!found){
+            if(isDone()){
+                taskReady.notify_all();
+                return;
+            }
+            if(!error){
+                if(thread == 0 && !readyMainTasks.empty()){
+                    id = readyMainTasks.front();
+                    readyMainTasks.pop_front();
+                    found = true;
+                }else if(!readyTasks.empty()){
+                    id = readyTasks.front();
+                    readyTasks.pop_front();
+                    found = true;
+                }
+            }
+            if(!found){
+                taskReady.wait(lock);
+            }
+        }
+        runningCount++;
+        lock.unlock();
+        
+        // Run task
+        std::chrono::steady_clock::time_point taskStart = std::chrono::steady_clock::now();
+        std::exception_ptr taskError = nullptr;
+        try{
+            tasks[id].run();
+        }catch(...){
+            taskError = std::current_exception();
+        }
+        std::chrono::steady_clock::time_point taskEnd = std::chrono::steady_clock::now();
+        
+        lock.lock();
+        runningCount--;
+        finishedCount++;
+        timings[id].startTime = std::chrono::duration<double, std::milli>(taskStart - startTime).count();
+        timings[id].duration = std::chrono::duration<double, std::milli>(taskEnd - taskStart).count();
+        timings[id].thread = thread;
+        
+        if(taskError){
+            if(!error){
+                error = taskError;
+            }
+        }else{
+            // Release tasks that were only waiting on this one
+            for(TaskId dependent: tasks[id].dependents){
+                if(--remainingDependencies[dependent] == 0){
+                    (tasks[dependent].mainThread ? readyMainTasks : readyTasks).push_back(dependent);
+                }
+            }
+        }
+        taskReady.notify_all();
+    }
+}
+
+// All tasks finished, or one failed and the ones already running have finished
+bool TaskGraph::isDone(){
+    return finishedCount == tasks.size() || (error && runningCount == 0);
+}
+
+const std::vector<TaskTiming> &TaskGraph::getTimings(){
+    return timings;
+}
+
+double TaskGraph::getTotalTime(){
+    return totalTime;
+}
+
+// Breakdown of tasks in start order, plus how much running them in parallel saved
+void TaskGraph::printTimings(){
+    std::vector<TaskTiming> sortedTimings = timings;
+    std::sort(sortedTimings.begin(), sortedTimings.end(), [](const TaskTiming &a, const TaskTiming &b){
+        return a.startTime < b.startTime;
+    });
+    
+    double taskTime = 0.0;
+    for(const TaskTiming &timing: sortedTimings){
+        printf(">>>   %-28s %8.2f ms  (start %8.2f ms, thread %u)\n", timing.name.c_str(), timing.duration, timing.startTime, timing.thread);
+        taskTime += timing.duration;
+    }
+    printf(">>>   Total %.2f ms (%.2f ms if run in sequence)\n", totalTime, taskTime);
+}
@@ -0,0 +1,80 @@
+//
+//  TaskGraph.hpp
+//  VulkanTesting
+//
+//  Created by Apple on 20/06/21.
+//
+
+#ifndef TaskGraph_hpp
+#define TaskGraph_hpp
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <chrono>
+#include <cstdint>
+#include <stdio.h>
+
+// Index of a task in the graph
+typedef uint32_t TaskId;
+
+// When and where a task ran (milliseconds since start of execute)
+struct TaskTiming{
+    std::string name;
+    double startTime;
+    double duration;
+    uint32_t thread;                    // 0 is the thread that called execute
+};
+
+// Runs tasks on a pool of threads as soon as all tasks they depend on are finished
+// - Dependencies must be added before the tasks using them, so the graph can't have cycles
+// - Main thread tasks only run on the thread calling execute (e.g. GLFW window calls)
+// - If a task throws, no new tasks are started and execute rethrows the first exception once running tasks finish
+class TaskGraph{
+public:
+    TaskGraph();
+    ~TaskGraph();
+    
+    TaskId addTask(const std::string &name, std::function<void()> run, const std::vector<TaskId> &dependencies = {}, bool mainThread = false);
+    void execute(uint32_t threadCount);
+    
+    const std::vector<TaskTiming> &getTimings();
+    double getTotalTime();
+    void printTimings();
+
+private:
+    struct Task{
+        std::string name;
+        std::function<void()> run;
+        std::vector<TaskId> dependents;                 // Tasks waiting on this one
+        uint32_t dependencyCount = 0;
+        bool mainThread = false;
+    };
+    
+    std::vector<Task> tasks;
+    std::vector<TaskTiming> timings;                    // Same order as tasks
+    double totalTime = 0.0;
+    
+    // Execution state (guarded by mutex)
+    std::mutex mutex;
+    std::condition_variable taskReady;
+    std::deque<TaskId> readyTasks;
+    std::deque<TaskId> readyMainTasks;
+    std::vector<uint32_t> remainingDependencies;
+    size_t finishedCount = 0;
+    uint32_t runningCount = 0;
+    std::exception_ptr error;
+    std::chrono::steady_clock::time_point startTime;
+    
+    void work(uint32_t thread);
+    bool isDone();
+};
+
+#endif /* TaskGraph_hpp */
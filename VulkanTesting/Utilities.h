@@ -19,6 +19,37 @@
 
 const int MAX_FRAME_DRAWS = 2;
 const int MAX_OBJECTS = 20;
+const uint32_t DESCRIPTOR_POOL_SETS = 64;                           // Sets per descriptor pool, more pools are added when needed
+const float CAMERA_NEAR = 0.1f;                                     // Near & far plane of projection
+const float CAMERA_FAR = 100.0f;
+const uint32_t HIZ_READBACK_WIDTH = 128;                            // Hi-Z levels this wide or smaller are read back for culling
+const uint32_t MESH_LOD_MAX_LEVELS = 4;                             // Levels of detail per mesh, including full detail
+const float MESH_LOD_REDUCTION = 0.5f;                              // Triangles kept by each level, relative to level before it
+const float MESH_LOD_MAX_ERROR = 0.05f;                             // Largest simplification error, relative to mesh bounds diagonal
+const float LOD_PIXEL_ERROR = 1.0f;                                 // Largest on-screen error (pixels) allowed when picking a level
+const uint32_t MESHLET_MAX_VERTICES = 64;                           // Meshlet size limits
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+const uint32_t MESHLET_MIN_MESH_TRIANGLES = 1024;                   // Smaller meshes are culled as a whole only
+const uint32_t MESHLET_MAX_INDIRECT_DRAWS = 65536;                  // Indirect draw commands per frame for visible meshlets
+
+const char* const PIPELINE_CACHE_FILE = "pipeline_cache.bin";     // Saved VkPipelineCache data, relative to working directory
+const char* const SHADER_CACHE_DIRECTORY = "Shaders/cache";       // Compiled SPIR-V of shaders, relative to working directory
+const int SHADER_CACHE_VERSION = 1;                                 // Change to invalidate all cached SPIR-V
+const double SHADER_RELOAD_INTERVAL = 0.5;                          // Seconds between checks for edited shader sources
+
+// Effect applied by second subpass (POST_PROCESS_MODE specialization constant of second.frag)
+enum PostProcessMode{
+    POST_PROCESS_NONE = 0,              // Show color output unchanged
+    POST_PROCESS_DEPTH_SPLIT = 1,       // Depth shading on right half of screen only
+    POST_PROCESS_DEPTH = 2,             // Depth shading on whole screen
+    POST_PROCESS_OVERDRAW = 3,          // Fragments shaded per pixel as a heatmap (scene drawn with additive counting)
+    POST_PROCESS_MODE_COUNT
+};
+
+// Push constant data of second subpass
+struct PostProcessSettings{
+    float splitX;                       // Screen x coordinate where POST_PROCESS_DEPTH_SPLIT starts shading
+};
 
 const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME,
@@ -26,6 +57,35 @@ const std::vector<const char*> deviceExtensions = {
     //"VK_KHR_get_physical_device_properties2"
 };
 
+// Identifies a model of the renderer, stays invalid once the model is destroyed (even if its slot is reused)
+struct ModelHandle{
+    uint32_t index;         // Slot in renderer's model list
+    uint32_t generation;    // Generation of slot when model was created
+};
+
+// Cost of last finished frame
+struct FrameStats{
+    double cpuTime;         // Milliseconds spent in draw()
+    double gpuTime;         // Milliseconds between first and last command of frame on GPU (0 when timestamps unsupported)
+    bool gpuTimeValid;
+    uint32_t drawCount;
+    uint32_t bindCount;
+    uint64_t triangleCount;
+    uint32_t culledCount;   // Meshes skipped by occlusion culling (or with all meshlets culled)
+    uint32_t culledMeshletCount;    // Meshlets of full detail meshes outside the view or facing away
+};
+
+const int OVERDRAW_HISTOGRAM_SIZE = 16;                              // Last bucket also counts pixels shaded more often
+
+// Fragments shaded per pixel in last finished POST_PROCESS_OVERDRAW frame
+struct OverdrawHistogram{
+    bool valid;
+    uint32_t pixels[OVERDRAW_HISTOGRAM_SIZE];   // pixels[i]: pixels shaded i times
+    uint32_t maxCount;                          // Most fragments shaded on one pixel
+    uint64_t fragmentCount;                     // Fragments shaded in total
+    double average;                             // Fragments per covered pixel (1.0 = no overdraw)
+};
+
 // Vertex data representation
 struct Vertex{
     glm::vec3 pos;      // Vertex Position (x, y, z)
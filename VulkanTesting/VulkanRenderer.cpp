@@ -11,69 +11,85 @@
 
 // constructor
 VulkanRenderer::VulkanRenderer(){
-    
+    // Scene is opaque, so nearest first gives the most early depth rejection (prepass draws have no state to share anyway)
+    drawList.setOrder(DRAW_ORDER_FRONT_TO_BACK);
+    depthPrepassList.setOrder(DRAW_ORDER_FRONT_TO_BACK);
 }
 
 // vulkan initialization
 int VulkanRenderer::init(GLFWwindow *newWindow){
     printf(">>> Welcome to Init!\n");
+    initStartTime = std::chrono::steady_clock::now();
     this->window = newWindow;
     try{
-        createInstance();
-        printf(">>> createInstance!\n");
-        createSurface();
-        printf(">>> createSurface!\n");
-        getPhysicalDevice();
-        printf(">>> getPhysicalDevice!\n");
-        createLogicalDevice();
-        printf(">>> createLogicalDevice!\n");
-        createSwapChain();
-        printf(">>> createSwapChain!\n");
-        createColorBufferImage();
-        printf(">>> createColorBufferImage!\n");
-        createDepthBufferImage();
-        printf(">>> createDepthBufferImage!\n");
-        createRenderPass();
-        printf(">>> createRenderPass!\n");
-        createDescriptorSetLayout();
-        printf(">>> createDescriptorSetLayout!\n");
-        createPushConstantRange();
-        printf(">>> createPushConstantRange!\n");
-        createGraphicsPipeline();
-        printf(">>> createGraphicsPipeline!\n");
-        createFramebuffers();
-        printf(">>> createFramebuffers!\n");
-        createCommandPool();
-        printf(">>> createCommandPool!\n");
-        createCommandBuffers();
-        printf(">>> createCommandBuffers!\n");
-        createTextureSampler();
-        printf(">>> createTextureSampler!\n");
+        // Create steps run as soon as everything they read has been created, independent ones in parallel
+        // Note: Vulkan objects can be created from any thread, but the command pool, graphics queue & descriptor allocator
+        // need external synchronization, so every step using them is chained one after another:
+        // - Command pool: createCommandBuffers (allocates) -> createDefaultTexture (one time transfer command buffers)
+        // - Graphics queue: createDefaultTexture (transfer submits) only
+        // - Descriptor allocator: createInputDescriptorSets -> createHiZBuffer -> createDefaultTexture
+        TaskGraph initGraph;
+        int defaultTextureWidth = 0, defaultTextureHeight = 0;
+        VkDeviceSize defaultTextureSize = 0;
+        stbi_uc *defaultTextureData = nullptr;
+        
+        // Decoding the default "no texture" texture only needs the file
+        TaskId loadDefaultTexture = initGraph.addTask("loadDefaultTexture", [&](){
+            defaultTextureData = loadTextureFile("plain.png", &defaultTextureWidth, &defaultTextureHeight, &defaultTextureSize);
+        });
+        TaskId instance = initGraph.addTask("createInstance", [this](){ createInstance(); });
+        // Surface creation touches the window's NSView & CAMetalLayer, which AppKit only allows on the main thread
+        TaskId surface = initGraph.addTask("createSurface", [this](){ createSurface(); }, { instance }, true);
+        TaskId physicalDevice = initGraph.addTask("getPhysicalDevice", [this](){ getPhysicalDevice(); }, { surface });
+        TaskId device = initGraph.addTask("createLogicalDevice", [this](){ createLogicalDevice(); }, { physicalDevice });
+        // Swapchain reads window size, GLFW only allows that on the main thread
+        TaskId swapChain = initGraph.addTask("createSwapChain", [this](){ createSwapChain(); }, { device }, true);
+        TaskId renderGraphs = initGraph.addTask("createRenderGraphs", [this](){ createRenderGraphs(); }, { swapChain });
+        TaskId setLayouts = initGraph.addTask("createDescriptorSetLayout", [this](){ createDescriptorSetLayout(); }, { device });
+        TaskId pushConstants = initGraph.addTask("createPushConstantRange", [this](){ createPushConstantRange(); });
+        TaskId pipelineCacheTask = initGraph.addTask("createPipelineCache", [this](){ createPipelineCache(); }, { device });
+        TaskId pipelines = initGraph.addTask("createGraphicsPipeline", [this](){ createGraphicsPipeline(); }, { renderGraphs, setLayouts, pushConstants, pipelineCacheTask });
+        TaskId templates = initGraph.addTask("createDescriptorTemplates", [this](){ createDescriptorTemplates(); }, { pipelines });
+        TaskId commandPool = initGraph.addTask("createCommandPool", [this](){ createCommandPool(); }, { device });
+        TaskId commandBufferTask = initGraph.addTask("createCommandBuffers", [this](){ createCommandBuffers(); }, { commandPool, swapChain });
+        TaskId sampler = initGraph.addTask("createTextureSampler", [this](){ createTextureSampler(); }, { device });
         // Below commented code is for DYNAMIC UNIFORM BUFFERS and is kept for futher references
-        //allocateDynamicBufferTransferSpace();
-        //printf(">>> allocateDynamicBufferTransferSpace!\n");
-        createUniformBuffers();
-        printf(">>> createUniformBuffers!\n");
-        createDescriptorPool();
-        printf(">>> createDescriptorPool!\n");
-        createDescriptorSets();
-        printf(">>> createDescriptorSets!\n");
-        createInputDescriptorSets();
-        printf(">>> createInputDescriptorSets!\n");
-        createSynchronization();
-        printf(">>> createSynchronization!\n");
+        //initGraph.addTask("allocateDynamicBufferTransferSpace", [this](){ allocateDynamicBufferTransferSpace(); }, { physicalDevice });
+        TaskId uniformBuffers = initGraph.addTask("createUniformBuffers", [this](){ createUniformBuffers(); }, { swapChain });
+        TaskId allocators = initGraph.addTask("createDescriptorAllocators", [this](){ createDescriptorAllocators(); }, { device });
+        TaskId inputDescriptorSets = initGraph.addTask("createInputDescriptorSets", [this](){ createInputDescriptorSets(); }, { allocators, templates, renderGraphs });
+        initGraph.addTask("createSynchronization", [this](){ createSynchronization(); }, { device });
+        initGraph.addTask("createTimestampQueryPool", [this](){ createTimestampQueryPool(); }, { device });
+        initGraph.addTask("createPassQueries", [this](){ createPassQueries(); }, { device });
+        initGraph.addTask("createOverdrawReadback", [this](){ createOverdrawReadback(); }, { swapChain });
+        TaskId hizBufferTask = initGraph.addTask("createHiZBuffer", [this](){ createHiZBuffer(); }, { inputDescriptorSets, sampler });
+        initGraph.addTask("createMeshletDrawBuffers", [this](){ createMeshletDrawBuffers(); }, { device });
+        // Create a default "no texture" texture
+        initGraph.addTask("createDefaultTexture", [&](){
+            createTexture(defaultTextureData, defaultTextureWidth, defaultTextureHeight, defaultTextureSize);
+            defaultTextureData = nullptr;                       // Freed by createTexture
+        }, { loadDefaultTexture, commandBufferTask, sampler, hizBufferTask });
         
+        try{
+            initGraph.execute(std::thread::hardware_concurrency());
+        }catch(...){
+            if(defaultTextureData){
+                stbi_image_free(defaultTextureData);
+            }
+            throw;
+        }
+        printf(">>> Init steps:\n");
+        initGraph.printTimings();
         
-        uboViewProjection.projection = glm::perspective(glm::radians(45.0f), (float) swapchainExtent.width / (float) swapchainExtent.height, 0.1f, 100.0f);
+        uboViewProjection.projection = glm::perspective(glm::radians(45.0f), (float) swapchainExtent.width / (float) swapchainExtent.height, CAMERA_NEAR, CAMERA_FAR);
         uboViewProjection.view = glm::lookAt(
                                glm::vec3(10.0f, 4.0f, 20.0f), // eye - where the camera is
                                glm::vec3(0.0f, 0.0f, -2.0f), // target - where the camera is looking at
                                glm::vec3(0.0f, 1.0f, 0.0f)  // up vector
                                );
         uboViewProjection.projection[1][1] *= -1;
-
-        // Create a default "no texture" texture
-        createTexture("plain.png");
+        
+        printf(">>> Descriptor sets: %u allocated in %u pools\n", descriptorAllocator.getAllocatedSetCount(), descriptorAllocator.getPoolCount());
         printf(">>> Welcome to Vulkan, Rohit!\n");
     }catch(const std::runtime_error &e){
         printf(">>> Error Ocurred!\n");
@@ -126,6 +142,13 @@ void VulkanRenderer::createInstance(){
         throw std::runtime_error("VkInstance does not support required extensions!");
     }
     
+    // Optional extensions, enabled when available
+    std::vector<const char*> properties2Extension = { VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME };
+    physicalDeviceProperties2Enabled = checkInstanceExtensionsSupport(&properties2Extension);
+    if(physicalDeviceProperties2Enabled){
+        instanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    }
+    
     createInfo.enabledExtensionCount = static_cast<u_int32_t>(instanceExtensions.size());
     createInfo.ppEnabledExtensionNames = instanceExtensions.data();
     
@@ -168,43 +191,45 @@ bool VulkanRenderer::checkInstanceExtensionsSupport(std::vector<const char *> *c
 }
 
 void VulkanRenderer::cleanUp(){
+    stopRecording();
+    
     // Wait until no actions being run on device before destroying
     vkDeviceWaitIdle(mainDevice.logicalDevice);
     
     // Below commented code is for DYNAMIC UNIFORM BUFFERS and is kept for futher references
     //aligned_free(modelTransferSpace);
     
+    // Resources released while running
+    deletionQueue.flushAll();
+    
+    // Models created from the same file share buffers, so only the last model of each file destroys them
     for(size_t i=0; i<modelList.size(); i++){
-        modelList[i].destroyMeshModel();
+        if(modelAlive[i] && modelCache.release(modelList[i].getCacheKey())){
+            modelList[i].destroyMeshModel();
+        }
     }
     
-    vkDestroyDescriptorPool(mainDevice.logicalDevice, inputDescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(mainDevice.logicalDevice, hizSetLayout, nullptr);
+    
     vkDestroyDescriptorSetLayout(mainDevice.logicalDevice, inputSetLayout, nullptr);
     
-    vkDestroyDescriptorPool(mainDevice.logicalDevice, samplerDescriptorPool, nullptr);
     vkDestroyDescriptorSetLayout(mainDevice.logicalDevice, samplerSetLayout, nullptr);
     
     vkDestroySampler(mainDevice.logicalDevice, textureSampler, nullptr);
     
     for(size_t i=0; i<textureImages.size(); i++){
+        if(textureImages[i] == VK_NULL_HANDLE){
+            continue;           // Released
+        }
         vkDestroyImageView(mainDevice.logicalDevice, textureImageView[i], nullptr);
         vkDestroyImage(mainDevice.logicalDevice, textureImages[i], nullptr);
         vkFreeMemory(mainDevice.logicalDevice, textureImageMemory[i], nullptr);
     }
     
-    for(size_t i=0; i<depthBufferImage.size();i++){
-        vkDestroyImageView(mainDevice.logicalDevice, depthBufferImageView[i], nullptr);
-        vkDestroyImage(mainDevice.logicalDevice, depthBufferImage[i], nullptr);
-        vkFreeMemory(mainDevice.logicalDevice, depthBufferImageMemory[i], nullptr);
-    }
-    
-    for(size_t i=0; i<colorBufferImage.size();i++){
-        vkDestroyImageView(mainDevice.logicalDevice, colorBufferImageView[i], nullptr);
-        vkDestroyImage(mainDevice.logicalDevice, colorBufferImage[i], nullptr);
-        vkFreeMemory(mainDevice.logicalDevice, colorBufferImageMemory[i], nullptr);
+    for(DescriptorAllocator &frameDescriptorAllocator: frameDescriptorAllocators){
+        frameDescriptorAllocator.destroy();
     }
-    
-    vkDestroyDescriptorPool(mainDevice.logicalDevice, descriptorPool, nullptr);
+    descriptorAllocator.destroy();
     vkDestroyDescriptorSetLayout(mainDevice.logicalDevice, descriptorSetLayout, nullptr);
     for(size_t i=0; i<swapchainImages.size();i++){
         vkDestroyBuffer(mainDevice.logicalDevice, vpUniformBuffer[i], nullptr);
@@ -218,15 +243,36 @@ void VulkanRenderer::cleanUp(){
         vkDestroySemaphore(mainDevice.logicalDevice, imageAvailable[i], nullptr);
         vkDestroyFence(mainDevice.logicalDevice, drawFences[i], nullptr);
     }
-    vkDestroyCommandPool(mainDevice.logicalDevice, graphicsCommandPool, nullptr);
-    for(auto framebuffer: swapchainFramebuffers){
-        vkDestroyFramebuffer(mainDevice.logicalDevice, framebuffer, nullptr);
+    if(timestampQueryPool != VK_NULL_HANDLE){
+        vkDestroyQueryPool(mainDevice.logicalDevice, timestampQueryPool, nullptr);
     }
-    vkDestroyPipeline(mainDevice.logicalDevice, secondPipeline, nullptr);
+    passQueries.destroy();
+    hizBuffer.destroy();
+    vkDestroyCommandPool(mainDevice.logicalDevice, graphicsCommandPool, nullptr);
+    savePipelineCache();
+    vkDestroyPipelineCache(mainDevice.logicalDevice, pipelineCache, nullptr);
+    pipelineLibrary.destroy();
+    descriptorUpdater.destroy();
+    vkDestroyPipelineLayout(mainDevice.logicalDevice, hizPipelineLayout, nullptr);
     vkDestroyPipelineLayout(mainDevice.logicalDevice, secondPipelineLayout, nullptr);
-    vkDestroyPipeline(mainDevice.logicalDevice, graphicsPipeline, nullptr);
     vkDestroyPipelineLayout(mainDevice.logicalDevice, pipelineLayout, nullptr);
-    vkDestroyRenderPass(mainDevice.logicalDevice, renderpass, nullptr);
+    for(size_t i=0; i<overdrawReadbackBuffers.size(); i++){
+        vkDestroyBuffer(mainDevice.logicalDevice, overdrawReadbackBuffers[i], nullptr);
+        vkFreeMemory(mainDevice.logicalDevice, overdrawReadbackBufferMemory[i], nullptr);
+    }
+    for(size_t i=0; i<meshletDrawBuffers.size(); i++){
+        vkDestroyBuffer(mainDevice.logicalDevice, meshletDrawBuffers[i], nullptr);
+        vkFreeMemory(mainDevice.logicalDevice, meshletDrawBufferMemory[i], nullptr);
+    }
+    directGraph.destroy();
+    postProcessGraph.destroy();
+    overdrawGraph.destroy();
+    vkDestroyImageView(mainDevice.logicalDevice, sceneDepthImageView, nullptr);
+    vkDestroyImage(mainDevice.logicalDevice, sceneDepthImage, nullptr);
+    vkFreeMemory(mainDevice.logicalDevice, sceneDepthImageMemory, nullptr);
+    vkDestroyImageView(mainDevice.logicalDevice, overdrawCountImageView, nullptr);
+    vkDestroyImage(mainDevice.logicalDevice, overdrawCountImage, nullptr);
+    vkFreeMemory(mainDevice.logicalDevice, overdrawCountImageMemory, nullptr);
     for(auto image: swapchainImages){
         vkDestroyImageView(mainDevice.logicalDevice, image.imageView, nullptr);
     }
@@ -263,6 +309,22 @@ void VulkanRenderer::getPhysicalDevice(){
     VkPhysicalDeviceProperties deviceProperties;
     vkGetPhysicalDeviceProperties(mainDevice.physicalDevice, &deviceProperties);
     
+    // Timestamps on graphics queue for GPU frame time
+    timestampPeriod = deviceProperties.limits.timestampPeriod;
+    timestampsSupported = deviceProperties.limits.timestampComputeAndGraphics == VK_TRUE && timestampPeriod > 0.0f;
+    
+    // Optional query features for per pass counters
+    VkPhysicalDeviceFeatures deviceFeatures;
+    vkGetPhysicalDeviceFeatures(mainDevice.physicalDevice, &deviceFeatures);
+    pipelineStatisticsSupported = deviceFeatures.pipelineStatisticsQuery == VK_TRUE;
+    preciseOcclusionSupported = deviceFeatures.occlusionQueryPrecise == VK_TRUE;
+    
+    // Without multiDrawIndirect each indirect command needs a call of its own
+    multiDrawIndirectSupported = deviceFeatures.multiDrawIndirect == VK_TRUE;
+    maxDrawIndirectCount = multiDrawIndirectSupported ? deviceProperties.limits.maxDrawIndirectCount : 1;
+    drawList.setMaxIndirectDrawCount(maxDrawIndirectCount);
+    depthPrepassList.setMaxIndirectDrawCount(maxDrawIndirectCount);
+    
     // Below commented code is for DYNAMIC UNIFORM BUFFERS and is kept for futher references
     //minUniformBufferOffset = deviceProperties.limits.minUniformBufferOffsetAlignment;
 }
@@ -272,7 +334,7 @@ bool VulkanRenderer::doCheckDeviceSuitable(VkPhysicalDevice device){
     // Information about the device itself (ID, name, type, vendor, etc)
     VkPhysicalDeviceProperties deviceProperties;
     vkGetPhysicalDeviceProperties(device, &deviceProperties);
-     
+    
     // Information about what the device can do (geo shader, tess shader, wide lines, etc)
     VkPhysicalDeviceFeatures deviceFeatures;
     vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
@@ -340,7 +402,7 @@ void VulkanRenderer::createLogicalDevice(){
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = queueFamilyIndex;      // The index of the family to create the index from
         queueCreateInfo.queueCount = 1;                                 // Number of queues to create
-    
+        
         float priotity = 1.0f;
         queueCreateInfo.pQueuePriorities=&priotity;                     // Vulkan needs to know how to handle multiple queues, so decide priorities (1 = Highest Priority)
         queueCreateInfos.push_back(queueCreateInfo);
@@ -351,12 +413,27 @@ void VulkanRenderer::createLogicalDevice(){
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());     // Number of queue create infos
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();                               // List of queue create infos so device can create required queues
-    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());    // Number of enabled logical device extensions
-    deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();                         // List of enabled logical device extensions
+    // Required extensions, plus optional ones the device has
+    std::vector<const char*> enabledExtensions = deviceExtensions;
+    bool descriptorTemplatesSupported = checkOptionalDeviceExtensionSupport(mainDevice.physicalDevice, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+    bool pushDescriptorsSupported = descriptorTemplatesSupported && physicalDeviceProperties2Enabled
+                                    && checkOptionalDeviceExtensionSupport(mainDevice.physicalDevice, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    if(descriptorTemplatesSupported){
+        enabledExtensions.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+    }
+    if(pushDescriptorsSupported){
+        enabledExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    }
+    
+    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());   // Number of enabled logical device extensions
+    deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();                        // List of enabled logical device extensions
     
     // Physical device features the logical device will be using
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;                     // Enabling Anisotropy
+    deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsSupported ? VK_TRUE : VK_FALSE;  // Per pass vertex & fragment counts
+    deviceFeatures.occlusionQueryPrecise = preciseOcclusionSupported ? VK_TRUE : VK_FALSE;      // Exact samples passed
+    deviceFeatures.multiDrawIndirect = multiDrawIndirectSupported ? VK_TRUE : VK_FALSE;         // Visible meshlets of a mesh in one call
     deviceCreateInfo.pEnabledFeatures = &deviceFeatures;            // Physical device features logical device will use
     
     // Create the logical device for the given physical device
@@ -370,6 +447,9 @@ void VulkanRenderer::createLogicalDevice(){
     // From given logical device, of give queue family, of given queue index (0 since only one queue), place reference in give vkQueue
     vkGetDeviceQueue(mainDevice.logicalDevice, indices.graphicsFamily, 0, &graphicsQueue);
     vkGetDeviceQueue(mainDevice.logicalDevice, indices.presentationFamily, 0, &presentationQueue);
+    
+    descriptorUpdater.init(mainDevice.logicalDevice, descriptorTemplatesSupported, pushDescriptorsSupported);
+    printf(">>> Descriptor update templates: %s, push descriptors: %s\n", descriptorTemplatesSupported ? "yes" : "no", descriptorUpdater.hasPushDescriptors() ? "yes" : "no");
 }
 
 void VulkanRenderer::createSurface(){
@@ -414,6 +494,21 @@ bool VulkanRenderer::checkDeviceExtensionSupport(VkPhysicalDevice device){
     return true;
 }
 
+bool VulkanRenderer::checkOptionalDeviceExtensionSupport(VkPhysicalDevice device, const char *extensionName){
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+    
+    for(const auto &extension: extensions){
+        if(strcmp(extensionName, extension.extensionName) == 0){
+            return true;
+        }
+    }
+    return false;
+}
+
 SwapChainDetails VulkanRenderer::getSwapChainDetails(VkPhysicalDevice device){
     SwapChainDetails swapChainDetails;
     
@@ -485,7 +580,7 @@ void VulkanRenderer::createSwapChain(){
     
     // If Graphics and Presentation families are different, then swapchain must let images be shared between families
     if(indices.graphicsFamily != indices.presentationFamily){
-        
+    
         // Queues to share between
         uint32_t queueFamilyIndices[] = {
             (uint32_t)indices.graphicsFamily,
@@ -619,164 +714,6 @@ VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkIm
 }
 
 void VulkanRenderer::createGraphicsPipeline(){
-    // Read in SPIR-V code of shaders
-    //std::string shaderDirectory = "Shaders/";
-    auto vertexShaderCode = readFile("vert.spv");
-    auto fragmentShaderCode = readFile("frag.spv");
-    
-    // Build Shader Modules to link to Graphics Pipeline
-    // Create shader modules
-    VkShaderModule vertexShaderModule = createShaderModule(vertexShaderCode);
-    VkShaderModule fragmentShaderModule = createShaderModule(fragmentShaderCode);
-    
-    // -- SHADER STAGE CREATION INFORMATION --
-    // Vertex Stage creation information
-    VkPipelineShaderStageCreateInfo vertexShaderCreateInfo = {};
-    vertexShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertexShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;                  // Shader stage name
-    vertexShaderCreateInfo.module = vertexShaderModule;                         // Shader module to be used by stage
-    vertexShaderCreateInfo.pName = "main";                                      // Entry point to the shader
-    
-    // Fragment Stage creation information
-    VkPipelineShaderStageCreateInfo fragmentShaderCreateInfo = {};
-    fragmentShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragmentShaderCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;              // Shader stage name
-    fragmentShaderCreateInfo.module = fragmentShaderModule;                     // Shader module to be used by stage
-    fragmentShaderCreateInfo.pName = "main";                                    // Entry point to the shader
-    
-    // Put shader stage creation info in to array
-    // Graphics Pipeline creation info requires array of shader stage creates
-    VkPipelineShaderStageCreateInfo shaderStages[] = {
-        vertexShaderCreateInfo, fragmentShaderCreateInfo
-    };
-    
-    // How the data for a single vertex (including info such as position, color, tex coords, normals, etc) is as a whole
-    VkVertexInputBindingDescription bindingDescription = {};
-    bindingDescription.binding = 0;                                 // Can bind multiple streams of data, this defines which one
-    bindingDescription.stride = sizeof(Vertex);                     // Size of a single vertex object
-    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;     // How to move between data after each vertex
-                                                                    // VK_VERTEX_INPUT_RATE_VERTEX      : Move on to the next vertex
-                                                                    // VK_VERTEX_INPUT_RATE_INSTANCE    : Move to a vertex for the next instance
-    
-    // How the data for an attribute is defined within a vertex
-    std::array<VkVertexInputAttributeDescription, 3> attributeDescription;
-    
-    // Position attribute
-    attributeDescription[0].binding = 0;                            // Which binding the data is at (should be same as above)
-    attributeDescription[0].location = 0;                           // Location in shader where data will be read from
-    attributeDescription[0].format = VK_FORMAT_R32G32B32_SFLOAT;    // Format the data will take (also helps define the size of data)
-    attributeDescription[0].offset = offsetof(Vertex, pos);         // Where this attribute is defined in the data for a single vertex
-    
-    // Color attribute
-    attributeDescription[1].binding = 0;                            // Which binding the data is at (should be same as above)
-    attributeDescription[1].location = 1;                           // Location in shader where data will be read from
-    attributeDescription[1].format = VK_FORMAT_R32G32B32_SFLOAT;    // Format the data will take (also helps define the size of data)
-    attributeDescription[1].offset = offsetof(Vertex, col);         // Where this attribute is defined in the data for a single vertex
-    
-    // Texture Attributes
-    attributeDescription[2].binding = 0;                            // Which binding the data is at (should be same as above)
-    attributeDescription[2].location = 2;                           // Location in shader where data will be read from
-    attributeDescription[2].format = VK_FORMAT_R32G32_SFLOAT;    // Format the data will take (also helps define the size of data)
-    attributeDescription[2].offset = offsetof(Vertex, tex);         // Where this attribute is defined in the data for a single vertex
-    
-    // -- VERTEX INPUT --
-    VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
-    vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-    vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;                 // List of vertex binding descriptions (data spacing, stride info, etc)
-    vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescription.size());
-    vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescription.data();       // List of vertex attribute descriptions (data format and where to bind to/from)
-    
-    // -- INPUT ASSEMBLY --
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;               // Primitive type to assemble vertices as
-    inputAssembly.primitiveRestartEnable = VK_FALSE;                            // Allow overriding of "strip" topology to start new primitives
-    
-    // -- VIEWPORT & SCISSOR --
-    // Create a view port info struct
-    VkViewport viewport = {};
-    viewport.x = 0.0f;                                  // x start coordinate
-    viewport.y = 0.0f;                                  // y start coordinate
-    viewport.width = (float) swapchainExtent.width;     // width of view port
-    viewport.height = (float) swapchainExtent.height;   // height of view port
-    viewport.minDepth = 0.0f;                           // min framebuffer depth
-    viewport.maxDepth = 1.0f;                           // max framebuffer depth
-    
-    // Create s SCISSOR infor struct
-    VkRect2D scissor = {};
-    scissor.offset = { 0,0 };                           // Offset to use region from
-    scissor.extent = swapchainExtent;                   // Extent to describe region to use, starting at offset
-    
-    VkPipelineViewportStateCreateInfo viewportStageCreateInfo = {};
-    viewportStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportStageCreateInfo.viewportCount = 1;
-    viewportStageCreateInfo.pViewports = &viewport;
-    viewportStageCreateInfo.scissorCount = 1;
-    viewportStageCreateInfo.pScissors = &scissor;
-    
-    // -- DYNAMIC STATES --
-    /*
-    // Note: If you are resizing a window, also recreate swapchain, swapchain images and any images associated with the swapchain so that they can actually fit
-    // Dynamic states to enable
-    std::vector<VkDynamicState> dynamicStateEnables;
-    dynamicStateEnables.push_back(VK_DYNAMIC_STATE_VIEWPORT);   // Dynamic Viewport: can resize in command buffer with vkCommandSetViewport(commandBuffer, 0, 1, &viewport)
-    dynamicStateEnables.push_back(VK_DYNAMIC_STATE_SCISSOR);    // Dynamic Scissor: can resize in command buffer with vkCommandSetScissor(commandBuffer, 0, 1, &scissor)
-    
-    // Dynamic state creation info
-    VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
-    dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
-    dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
-    */
-    
-    // -- RASTERIZER --
-    // Converts the triangle into individual fragments on the screen to be used in fragment shader
-    VkPipelineRasterizationStateCreateInfo rasterizationCreateInfo = {};
-    rasterizationCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizationCreateInfo.depthClampEnable = VK_FALSE;            // Change if fragments boyond near/far planes are clipped (default) or clamped to plane
-    rasterizationCreateInfo.rasterizerDiscardEnable = VK_FALSE;     // Whether to discard data and skip rasterizer. Never creates fragment, only suitable for pipeline without framebuffer output
-    rasterizationCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;     // How to handle filling points between vertices
-    rasterizationCreateInfo.lineWidth = 1.0f;                       // How thick lines should be when drawn
-    rasterizationCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;       // Which face of the tri to cull
-    rasterizationCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;    // Winding to detetmine which side is front
-    rasterizationCreateInfo.depthBiasEnable = VK_FALSE;             // Whether to add depth bias to fragment (good for stopping "shadow acne" in shadow mapping)
-    
-    // -- MULTISAMPLING --
-    VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo = {};
-    multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisamplingCreateInfo.sampleShadingEnable = VK_FALSE;                 // Enable multisample shading or not
-    multisamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;   // Number of sample to use per fragment
-    
-    // -- BLENDING --
-    // Blending decides how to blend a new color being written to a fragment, with the old value
-    
-    // Blend attachment state (How blending is handled)
-    VkPipelineColorBlendAttachmentState colorBlendingAttachmentState = {};
-    colorBlendingAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
-                        | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;      // Colors to apply blending to
-    colorBlendingAttachmentState.blendEnable = VK_TRUE;                             // Enable blending
-    
-    // Blending uses equations: (srcColorBlendFactor * newColor) colorBlendOp (dstColorBlendFactor * oldColor)
-    colorBlendingAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-    colorBlendingAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    colorBlendingAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
-    
-    // Summarized: (VK_BLEND_FACTOR_SRC_ALPHA * newColor) + (VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA * oldColor)
-    //             (new color alpha * new color) + ((1 - new color alpha) * old color)
-    
-    colorBlendingAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendingAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendingAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
-    // Sumarised: (1 * new alpha) + (0 * old alpha) = new alpha
-    
-    VkPipelineColorBlendStateCreateInfo colorBlendingCreateInfo = {};
-    colorBlendingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlendingCreateInfo.logicOpEnable = VK_FALSE;                       // Alternative to calculations is to use logical operations
-    // colorBlendingCreateInfo.logicOp = VK_LOGIC_OP_COPY;                  // Default
-    colorBlendingCreateInfo.attachmentCount = 1;
-    colorBlendingCreateInfo.pAttachments = &colorBlendingAttachmentState;
-    
     // -- PIPELINE LAYOUT --
     std::array<VkDescriptorSetLayout, 2> descriptorSetLayouts = { descriptorSetLayout, samplerSetLayout};
     
@@ -793,292 +730,333 @@ void VulkanRenderer::createGraphicsPipeline(){
         throw std::runtime_error("Failed to create pipeline layout!");
     }
     
-    // -- DEPTH STENCIL TESTING --
-    VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo;
-    depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencilCreateInfo.depthTestEnable = VK_TRUE;               // Enable checking depth to determine fragment write
-    depthStencilCreateInfo.depthWriteEnable = VK_TRUE;              // Enable writing to depth buffer (to replace all values)
-    depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;     // Comparison operation that allows an overwrite (is in front)
-    depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;        //  Depth Bounds Test: Does the depth value exists between two bounds
-    // TODO: Enable stencil testing as well to avoid error on MacOS
-    depthStencilCreateInfo.stencilTestEnable = VK_FALSE;            // Enable Stencil Test
-    depthStencilCreateInfo.flags = 0;                               // ROHIT: Set to 0 to make it work on MacOS
-    depthStencilCreateInfo.pNext = nullptr;                         // ROHIT: needed to make it null explicitly to run on MacOS
-
-    
-    // -- Graphics Pipeline Creation --
-    VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
-    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineCreateInfo.stageCount = 2;                                  // Number of shader stages
-    pipelineCreateInfo.pStages = shaderStages;                          // List of shader stages
-    pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;      // All the fixed funtion pipeline states
-    pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
-    pipelineCreateInfo.pViewportState = &viewportStageCreateInfo;
-    pipelineCreateInfo.pDynamicState = nullptr;
-    pipelineCreateInfo.pRasterizationState = &rasterizationCreateInfo;
-    pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
-    pipelineCreateInfo.pColorBlendState = &colorBlendingCreateInfo;
-    pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
-    pipelineCreateInfo.layout = pipelineLayout;                         // Pipeline layout pipeline should use
-    pipelineCreateInfo.renderPass = renderpass;                         // Renderpass description the pipeline is compatible with
-    pipelineCreateInfo.subpass = 0;                                     // Subpass of render pass to use with pipeline
-    
-    // Pipeline derivatives : can create multiple pipelines that derive from one another for optimization
-    pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;             // Existing pipeline to derive from
-    pipelineCreateInfo.basePipelineIndex = -1;                         // or index of pipeline being created to derive from (in case creating multiple at once)
-        
-    // Create Graphics Pipeline
-    result = vkCreateGraphicsPipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &graphicsPipeline);
-    if(result != VK_SUCCESS){
-        throw std::runtime_error("Failed to create a Graphics Pipeline!");
-    }
-    
-    // Destroy shder module, no longer needed after Pipeline creation
-    vkDestroyShaderModule(mainDevice.logicalDevice, fragmentShaderModule, nullptr);
-    vkDestroyShaderModule(mainDevice.logicalDevice, vertexShaderModule, nullptr);
-    
-    
-    // CREATE SECOND PASS PIPELINE
-    // Second pass shaders
-    auto secondVertexShaderCode = readFile("second_vert.spv");
-    auto secondFragmentShaderCode = readFile("second_frag.spv");
-    
-    // Build Shaders
-    VkShaderModule secondVertexShaderModule = createShaderModule(secondVertexShaderCode);
-    VkShaderModule secondFragmentShaderModule = createShaderModule(secondFragmentShaderCode);
-    
-    // Set new shaders
-    vertexShaderCreateInfo.module = secondVertexShaderModule;
-    fragmentShaderCreateInfo.module = secondFragmentShaderModule;
-    
-    VkPipelineShaderStageCreateInfo secondShaderStages[] = {vertexShaderCreateInfo, fragmentShaderCreateInfo};
-    
-    // No vertex data for second pass
-    vertexInputCreateInfo.vertexBindingDescriptionCount = 0;
-    vertexInputCreateInfo.pVertexBindingDescriptions = nullptr;
-    vertexInputCreateInfo.vertexAttributeDescriptionCount = 0;
-    vertexInputCreateInfo.pVertexAttributeDescriptions = nullptr;
-    
-    // Don't want to write to Depth Buffer
-    depthStencilCreateInfo.depthWriteEnable = VK_FALSE;
-    
-    // Create new pipeline layout
+    // Create new pipeline layout for input attachment descriptor sets of second pass
     VkPipelineLayoutCreateInfo secondPipelineLayoutCreateInfo = {};
     secondPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     secondPipelineLayoutCreateInfo.setLayoutCount = 1;
     secondPipelineLayoutCreateInfo.pSetLayouts = &inputSetLayout;
-    secondPipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-    secondPipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+    secondPipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    secondPipelineLayoutCreateInfo.pPushConstantRanges = &secondPushConstantRange;
     
     result = vkCreatePipelineLayout(mainDevice.logicalDevice, &secondPipelineLayoutCreateInfo, nullptr, &secondPipelineLayout);
     if(result != VK_SUCCESS){
         throw std::runtime_error("Failed to create a Pipeline Layout!");
     }
     
-    pipelineCreateInfo.pStages = secondShaderStages;            // Update second shader stage list
-    pipelineCreateInfo.layout = secondPipelineLayout;           // Change pipeline layout for input attachment descriptor sets
-    pipelineCreateInfo.subpass = 1;                             // Use second subpass
-    
-    // Create second pipeline
-    result = vkCreateGraphicsPipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &secondPipeline);
-    if(result != VK_SUCCESS){
-        throw std::runtime_error("Failed to create a Graphics Pipeline!");
+    // Describe pipelines, library creates each unique description once
+    // First pass: draws meshes to color & depth attachments
+    mainPipelineDescription = {};
+    mainPipelineDescription.vertexShader = "shader.vert";
+    mainPipelineDescription.fragmentShader = "shader.frag";
+    mainPipelineDescription.layout = pipelineLayout;
+    mainPipelineDescription.renderPass = postProcessGraph.getRenderPass(scenePass);
+    mainPipelineDescription.subpass = postProcessGraph.getSubpass(scenePass);
+    
+    // Second pass: fullscreen triangle reading input attachments
+    secondPipelineDescription = mainPipelineDescription;
+    secondPipelineDescription.vertexShader = "second.vert";
+    secondPipelineDescription.fragmentShader = "second.frag";
+    secondPipelineDescription.vertexFormat = VERTEX_FORMAT_NONE;   // No vertex data for second pass
+    secondPipelineDescription.depthWriteEnable = VK_FALSE;          // Don't want to write to Depth Buffer
+    secondPipelineDescription.layout = secondPipelineLayout;
+    secondPipelineDescription.renderPass = postProcessGraph.getRenderPass(postProcessPass);
+    secondPipelineDescription.subpass = postProcessGraph.getSubpass(postProcessPass);
+    
+    // Overdraw pass: same inputs & depth test as first pass, but every shaded fragment adds 1 to the pixel's count
+    overdrawPipelineDescription = mainPipelineDescription;
+    overdrawPipelineDescription.fragmentShader = "overdraw.frag";
+    overdrawPipelineDescription.additiveBlend = true;
+    overdrawPipelineDescription.renderPass = overdrawGraph.getRenderPass(overdrawScenePass);
+    overdrawPipelineDescription.subpass = overdrawGraph.getSubpass(overdrawScenePass);
+    
+    // Depth prepass: positions only, no fragment shader, in the same subpass before the scene draws
+    depthPrepassPipelineDescription = mainPipelineDescription;
+    depthPrepassPipelineDescription.vertexShader = "depth.vert";
+    depthPrepassPipelineDescription.fragmentShader = "";
+    depthPrepassPipelineDescription.vertexFormat = VERTEX_FORMAT_POS;
+    depthPrepassPipelineDescription.blendEnable = VK_FALSE;
+    
+    // Request every specialization constant variant up front, so switching between them never waits on compilation
+    // Scene pipelines are needed for the render pass of every render path, with & without depth prepass
+    pipelineLibrary.init(mainDevice.logicalDevice, pipelineCache);
+    std::vector<std::pair<RenderGraph *, uint32_t>> sceneSubpasses = {
+        { &postProcessGraph, scenePass }, { &directGraph, directScenePass }, { &overdrawGraph, overdrawScenePass }
+    };
+    for(auto &sceneSubpass: sceneSubpasses){
+        PipelineDescription variant = depthPrepassPipelineDescription;
+        variant.renderPass = sceneSubpass.first->getRenderPass(sceneSubpass.second);
+        variant.subpass = sceneSubpass.first->getSubpass(sceneSubpass.second);
+        pipelineLibrary.requestPipeline(variant);
+    }
+    for(VkBool32 prepass: { VK_FALSE, VK_TRUE }){
+        for(int i=0; i<2; i++){                                                         // Overdraw graph has its own pipeline
+            for(VkBool32 sampling: { VK_TRUE, VK_FALSE }){
+                PipelineDescription variant = mainPipelineDescription;
+                variant.renderPass = sceneSubpasses[i].first->getRenderPass(sceneSubpasses[i].second);
+                variant.subpass = sceneSubpasses[i].first->getSubpass(sceneSubpasses[i].second);
+                variant.depthCompareOp = prepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
+                variant.depthWriteEnable = !prepass;
+                variant.fragmentConstants = { sampling };                               // TEXTURE_SAMPLING
+                pipelineLibrary.requestPipeline(variant);
+            }
+        }
+        PipelineDescription variant = overdrawPipelineDescription;
+        variant.depthCompareOp = prepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
+        variant.depthWriteEnable = !prepass;
+        pipelineLibrary.requestPipeline(variant);
+    }
+    for(uint32_t mode=POST_PROCESS_NONE + 1; mode<POST_PROCESS_MODE_COUNT; mode++){   // No second pass without an effect
+        PipelineDescription variant = secondPipelineDescription;
+        variant.fragmentConstants = { mode };                                           // POST_PROCESS_MODE
+        if(mode == POST_PROCESS_OVERDRAW){                                              // Heatmap runs in overdraw graph
+            variant.renderPass = overdrawGraph.getRenderPass(overdrawHeatmapPass);
+            variant.subpass = overdrawGraph.getSubpass(overdrawHeatmapPass);
+        }
+        pipelineLibrary.requestPipeline(variant);
     }
     
-    // Destory second shader modules
-    vkDestroyShaderModule(mainDevice.logicalDevice, secondFragmentShaderModule, nullptr);
-    vkDestroyShaderModule(mainDevice.logicalDevice, secondVertexShaderModule, nullptr);
+    // Compile all requested pipelines in parallel (shares the pipeline cache)
+    pipelineLibrary.compilePending(std::thread::hardware_concurrency());
+    
+    updatePipelines();
 }
 
-VkShaderModule VulkanRenderer::createShaderModule(const std::vector<char> &code){
-    VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
-    shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    shaderModuleCreateInfo.codeSize = code.size();                                  // Size of code
-    shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t *>(code.data()); // Pointer to code (of uint32_t pointer type)
-    
-    VkShaderModule shaderModule;
-    VkResult result = vkCreateShaderModule(mainDevice.logicalDevice, &shaderModuleCreateInfo, nullptr, &shaderModule);
-    if(result != VK_SUCCESS){
-        throw std::runtime_error("Failed to create a shader module!");
-    }
-    
-    return shaderModule;
+// Describe where descriptor data sits in the structs passed to descriptorUpdater (after pipeline layouts, push templates need them)
+void VulkanRenderer::createDescriptorTemplates(){
+    // View projection: one VkDescriptorBufferInfo
+    VkDescriptorUpdateTemplateEntryKHR vpEntry = {};
+    vpEntry.dstBinding = 0;                                         // Binding to update (matches with binding on layout/shader)
+    vpEntry.dstArrayElement = 0;                                    // Index in array to update
+    vpEntry.descriptorCount = 1;                                    // Amount to update
+    vpEntry.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;     // Type of descriptor (should match with type of descriptor set)
+    vpEntry.offset = 0;                                             // Position of VkDescriptorBufferInfo in data
+    vpEntry.stride = sizeof(VkDescriptorBufferInfo);
+    
+    if(descriptorUpdater.hasPushDescriptors()){
+        vpDescriptorTemplate = descriptorUpdater.createPushTemplate(descriptorSetLayout, { vpEntry }, pipelineLayout, 0);
+    }else{
+        vpDescriptorTemplate = descriptorUpdater.createTemplate(descriptorSetLayout, { vpEntry });
+    }
+    
+    // Texture: one VkDescriptorImageInfo
+    VkDescriptorUpdateTemplateEntryKHR samplerEntry = {};
+    samplerEntry.dstBinding = 0;
+    samplerEntry.dstArrayElement = 0;
+    samplerEntry.descriptorCount = 1;
+    samplerEntry.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    samplerEntry.offset = 0;
+    samplerEntry.stride = sizeof(VkDescriptorImageInfo);
+    samplerDescriptorTemplate = descriptorUpdater.createTemplate(samplerSetLayout, { samplerEntry });
+    
+    // Input attachments: VkDescriptorImageInfo of color then depth
+    VkDescriptorUpdateTemplateEntryKHR colorInputEntry = {};
+    colorInputEntry.dstBinding = 0;
+    colorInputEntry.dstArrayElement = 0;
+    colorInputEntry.descriptorCount = 1;
+    colorInputEntry.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    colorInputEntry.offset = 0;
+    colorInputEntry.stride = sizeof(VkDescriptorImageInfo);
+    
+    VkDescriptorUpdateTemplateEntryKHR depthInputEntry = colorInputEntry;
+    depthInputEntry.dstBinding = 1;
+    depthInputEntry.offset = sizeof(VkDescriptorImageInfo);
+    inputDescriptorTemplate = descriptorUpdater.createTemplate(inputSetLayout, { colorInputEntry, depthInputEntry });
+    
+    // Hi-Z level: VkDescriptorImageInfo of source then destination
+    VkDescriptorUpdateTemplateEntryKHR hizSourceEntry = samplerEntry;
+    VkDescriptorUpdateTemplateEntryKHR hizDestinationEntry = samplerEntry;
+    hizDestinationEntry.dstBinding = 1;
+    hizDestinationEntry.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    hizDestinationEntry.offset = sizeof(VkDescriptorImageInfo);
+    hizDescriptorTemplate = descriptorUpdater.createTemplate(hizSetLayout, { hizSourceEntry, hizDestinationEntry });
 }
 
-void VulkanRenderer::createRenderPass(){
-    // Array of our subpasses
-    std::array<VkSubpassDescription, 2> subpasses{};
-    
-    // ATTACHMENTS
-    // SUBPASS 1 ATTACHMENTS (INPUT ATTACHMENTS)
+void VulkanRenderer::createPipelineCache(){
+    // getcwd allocates the path it returns
+    char *directory = getcwd(NULL, 0);
+    pipelineCachePath = std::string(directory ? directory : ".") + "/" + PIPELINE_CACHE_FILE;
+    free(directory);
+    
+    // Read previously saved cache data (if any) from disk
+    std::ifstream file(pipelineCachePath, std::ios::binary | std::ios::ate);
+    
+    std::vector<char> cacheData;
+    if(file.is_open()){
+        size_t fileSize = (size_t)file.tellg();
+        cacheData.resize(fileSize);
+        file.seekg(0);
+        file.read(cacheData.data(), fileSize);
+        file.close();
+    }
     
-    // Color Attachment + References (Input)
-    VkAttachmentDescription colorAttachment = {};
-    colorAttachment.format = chooseSupportedFormat({VK_FORMAT_R8G8B8A8_UNORM}, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    // Only use the saved data if it was written by this same device and driver, otherwise start with an empty cache
+    if(!cacheData.empty()){
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(mainDevice.physicalDevice, &deviceProperties);
+        
+        VkPipelineCacheHeaderVersionOne header = {};
+        bool cacheValid = cacheData.size() >= sizeof(header);
+        if(cacheValid){
+            memcpy(&header, cacheData.data(), sizeof(header));
+            cacheValid = header.headerSize >= sizeof(header)
+                        && header.headerSize <= cacheData.size()                            // Not truncated
+                        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+                        && header.vendorID == deviceProperties.vendorID                     // Same GPU vendor
+                        && header.deviceID == deviceProperties.deviceID                     // Same GPU
+                        && memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;    // Same driver cache format
+        }
+        
+        if(!cacheValid){
+            printf(">>> Ignoring stale pipeline cache (%s)\n", pipelineCachePath.c_str());
+            cacheData.clear();
+        }
+    }
     
-    // Depth Attachment (Input)
-    VkAttachmentDescription depthAttachment = {};
+    // Pipeline cache creation info
+    VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
+    pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCreateInfo.initialDataSize = cacheData.size();                         // Size of saved cache data (0 for empty cache)
+    pipelineCacheCreateInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();  // Saved cache data to start from
     
-    // Choose supported formats for depth buffer
-    depthBufferFormat = chooseSupportedFormat(
-          {VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT},
-                                                  VK_IMAGE_TILING_OPTIMAL,
-                                                  VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
-                                                  );
-    depthAttachment.format = depthBufferFormat;
-    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-    
-    // Color Attachment (Input) Reference
-    VkAttachmentReference colorAttachmentReference = {};
-    colorAttachmentReference.attachment = 1;
-    colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    
-    // Depth Attachment (Input) Reference
-    VkAttachmentReference depthAttachmentReference = {};
-    depthAttachmentReference.attachment = 2;
-    depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-    
-    // Set up subpass 1
-    subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpasses[0].colorAttachmentCount = 1;
-    subpasses[0].pColorAttachments = &colorAttachmentReference;
-    subpasses[0].pDepthStencilAttachment = &depthAttachmentReference;
-    
-    
-    
-    // SUBPASS 2 ATTACHMENTS + REFERENCES
-    
-    // Swapchain Color Attachment
-    VkAttachmentDescription swapchainColorAttachment = {};
-    swapchainColorAttachment.format = swapchainImageFormat;                  // Format to use for attachment
-    swapchainColorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;                // Number of samples to write for multisampling
-    swapchainColorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;           // Describes what to do with attachment before rendering (what glClear does)
-    swapchainColorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;         // Describes what to do with attachment after rendering
-    swapchainColorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;// Describes what to do with stencil before rendering
-    swapchainColorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;// Describes what to do with stencil after rendering
-    
-    // Framebuffer data will be stored as an image, but images can be given different data layouts
-    // to give optimal use for certain operations
-    swapchainColorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;      // Image data layout before render pass starts
-    swapchainColorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;  // Image data layout after render pass (to change to)
-    
-    // Attachment reference uses an attachment index that refers to index in the attachment list passed to renderPassCreateInfo
-    VkAttachmentReference swapchainColorAttachmentReference = {};
-    swapchainColorAttachmentReference.attachment = 0;
-    swapchainColorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    
-    // References to attachments that subpass will take input from
-    std::array<VkAttachmentReference, 2> inputReferences;
-    inputReferences[0].attachment = 1;
-    inputReferences[0].layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    inputReferences[1].attachment = 2;
-    inputReferences[1].layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    
-    // Set up Subpass 2
-    subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpasses[1].colorAttachmentCount = 1;
-    subpasses[1].pColorAttachments = &swapchainColorAttachmentReference;
-    subpasses[1].inputAttachmentCount = static_cast<uint32_t>(inputReferences.size());
-    subpasses[1].pInputAttachments = inputReferences.data();
-    
-    
-    // SUBPASS DEPENDENCIES
-    
-    // Need to determine when layout transition occur using subpass dependencies
-    std::array<VkSubpassDependency, 3> subpassDependencies;
-    
-    // Conversion from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-    // Transition must happen after...
-    subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;                            // Subpass index (VK_SUBPASS_EXTERNAL = Special value meaning outside of renderpass)
-    subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;         // Pipeline stage
-    subpassDependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;                   // Stage access mask (memory access)
-    // But must happen before...
-    subpassDependencies[0].dstSubpass = 0;
-    subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    subpassDependencies[0].dependencyFlags = 0;
-    
-    // Subpass 1 layout (color/depth) to Subpass 2 layout (shader read)
-    subpassDependencies[1].srcSubpass = 0;
-    subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    subpassDependencies[1].dstSubpass = 1;
-    subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    subpassDependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    subpassDependencies[1].dependencyFlags = 0;
-    
-    // Conversion from VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL to VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
-    // Transition must happen after...
-    subpassDependencies[2].srcSubpass = 0;                                                  // Subpass index (VK_SUBPASS_EXTERNAL = Special value meaning outside of renderpass)
-    subpassDependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;    // Pipeline stage
-    subpassDependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
-                                | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;                     // Stage access mask (memory access)
-    // But must happen before...
-    subpassDependencies[2].dstSubpass = VK_SUBPASS_EXTERNAL;
-    subpassDependencies[2].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-    subpassDependencies[2].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-    subpassDependencies[2].dependencyFlags = 0;
-    
-    std::array<VkAttachmentDescription, 3> renderPassAttachment = { swapchainColorAttachment, colorAttachment, depthAttachment};
-    
-    // Create info for render pass
-    VkRenderPassCreateInfo renderPassCreateInfo = {};
-    renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassCreateInfo.attachmentCount = static_cast<uint32_t>(renderPassAttachment.size());
-    renderPassCreateInfo.pAttachments = renderPassAttachment.data();
-    renderPassCreateInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
-    renderPassCreateInfo.pSubpasses = subpasses.data();
-    renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
-    renderPassCreateInfo.pDependencies = subpassDependencies.data();
-    
-    VkResult result = vkCreateRenderPass(mainDevice.logicalDevice, &renderPassCreateInfo, nullptr, &renderpass);
+    VkResult result = vkCreatePipelineCache(mainDevice.logicalDevice, &pipelineCacheCreateInfo, nullptr, &pipelineCache);
     if(result != VK_SUCCESS){
-        throw std::runtime_error("Failed to create a Renderpass!");
+        throw std::runtime_error("Failed to create a Pipeline Cache!");
     }
 }
 
-void VulkanRenderer::createFramebuffers(){
-    // resize framebuffer count to equals swapchain image count
-    swapchainFramebuffers.resize(swapchainImages.size());
+void VulkanRenderer::savePipelineCache(){
+    if(pipelineCachePath.empty()){
+        return;                 // Cache was never created
+    }
     
-    // create a framebuffer for each swapchain image
-    for(size_t i=0; i< swapchainFramebuffers.size(); i++){
-        std::array<VkImageView, 3> attachments = {
-            swapchainImages[i].imageView,
-            colorBufferImageView[i],
-            depthBufferImageView[i]
-        };
-        
-        VkFramebufferCreateInfo framebufferCreateInfo;
-        framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferCreateInfo.renderPass = renderpass;                                          // Render pass layout the Framebuffer will be used with
-        framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-        framebufferCreateInfo.pAttachments = attachments.data();                                // List of attachments (1:1 with renderpass)
-        framebufferCreateInfo.width = swapchainExtent.width;                                    // Framebuffer width
-        framebufferCreateInfo.height = swapchainExtent.height;                                  // Framebuffer height
-        framebufferCreateInfo.layers = 1;                                                       // Framebuffer layers
-        framebufferCreateInfo.pNext = nullptr;                                                  // ROHIT: Needed to explicitly set it to null to avoid program crash
-        
-        VkResult result = vkCreateFramebuffer(mainDevice.logicalDevice, &framebufferCreateInfo, nullptr, &swapchainFramebuffers[i]);
-        if(result != VK_SUCCESS){
-            throw std::runtime_error("Failed to create a Framebuffer!");
-        }
+    // Get size of cache data, then the data itself
+    size_t cacheSize = 0;
+    vkGetPipelineCacheData(mainDevice.logicalDevice, pipelineCache, &cacheSize, nullptr);
+    std::vector<char> cacheData(cacheSize);
+    VkResult result = vkGetPipelineCacheData(mainDevice.logicalDevice, pipelineCache, &cacheSize, cacheData.data());
+    if(result != VK_SUCCESS || cacheSize == 0){
+        return;
+    }
+    
+    // Write cache data to disk so the next launch can skip pipeline compilation
+    // Written to a temporary file first and renamed over the old one, so a crash mid-write never leaves a truncated cache
+    std::string tempFilePath = pipelineCachePath + ".tmp";
+    std::ofstream file(tempFilePath, std::ios::binary | std::ios::trunc);
+    if(!file.is_open()){
+        printf(">>> Failed to save pipeline cache (%s)\n", tempFilePath.c_str());
+        return;
+    }
+    file.write(cacheData.data(), cacheSize);
+    file.close();
+    if(file.fail() || rename(tempFilePath.c_str(), pipelineCachePath.c_str()) != 0){
+        printf(">>> Failed to save pipeline cache (%s)\n", pipelineCachePath.c_str());
+        remove(tempFilePath.c_str());
     }
 }
 
+void VulkanRenderer::createRenderGraphs(){
+    // Get supported formats for attachments
+    VkFormat colorFormat = chooseSupportedFormat({ VK_FORMAT_R8G8B8A8_UNORM }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+    depthBufferFormat = chooseSupportedFormat(
+          {VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT},
+                                                  VK_IMAGE_TILING_OPTIMAL,
+                                                  VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+                                                  );
+    
+    // Scene depth belongs to the renderer and is shared by all graphs, it's left in read-only layout for the Hi-Z build
+    // that follows the graph
+    sceneDepthImage = createImage(swapchainExtent.width, swapchainExtent.height, depthBufferFormat, VK_IMAGE_TILING_OPTIMAL,
+                                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &sceneDepthImageMemory);
+    sceneDepthImageView = createImageView(sceneDepthImage, depthBufferFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+    std::vector<VkImageView> sceneDepthImageViews(swapchainImages.size(), sceneDepthImageView);
+    
+    std::vector<VkImageView> swapchainImageViews;
+    for(SwapchainImage &image: swapchainImages){
+        swapchainImageViews.push_back(image.imageView);
+    }
+    
+    VkClearValue swapchainClear = {};
+    swapchainClear.color = {0.0f, 0.0f, 0.0f, 1.0f};           // clear values for swapchain image
+    VkClearValue colorClear = {};
+    colorClear.color = {0.6f, 0.65f, 0.4f, 1.0f};              // clears background of color buffer
+    VkClearValue depthClear = {};
+    depthClear.depthStencil.depth = 1.0f;                       // clears depth buffer
+    
+    RenderGraphPass scene;
+    scene.name = "scene";
+    scene.execute = [this](VkCommandBuffer commandBuffer, uint32_t imageIndex){ recordScenePass(commandBuffer, imageIndex); };
+    
+    // POST PROCESS GRAPH
+    // One framebuffer per swapchain image, all sharing a single copy of the intermediate attachments:
+    // they are only read inside the render pass that writes them, and the graph's dependency on the previous frame's
+    // last use stops frames in flight from overwriting each other's
+    postProcessGraph.init(mainDevice.physicalDevice, mainDevice.logicalDevice, swapchainExtent,
+                          static_cast<uint32_t>(swapchainImages.size()), 1);
+    
+    swapchainAttachment = postProcessGraph.addExternalAttachment("swapchain", swapchainImageFormat, swapchainImageViews, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, true, swapchainClear);
+    colorAttachment = postProcessGraph.addAttachment("color", colorFormat, true, colorClear);
+    depthAttachment = postProcessGraph.addExternalAttachment("depth", depthBufferFormat, sceneDepthImageViews, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, true, depthClear);
+    
+    // Scene: draw meshes to color & depth
+    scene.colorOutputs = { colorAttachment };
+    scene.depthOutput = depthAttachment;
+    scenePass = postProcessGraph.addPass(scene);
+    
+    // Post process: read scene color & depth at each pixel, write to swapchain image
+    RenderGraphPass postProcess;
+    postProcess.name = "post process";
+    postProcess.colorOutputs = { swapchainAttachment };
+    postProcess.inputAttachments = { colorAttachment, depthAttachment };
+    postProcess.execute = [this](VkCommandBuffer commandBuffer, uint32_t imageIndex){ recordPostProcessPass(commandBuffer, imageIndex); };
+    postProcessPass = postProcessGraph.addPass(postProcess);
+    
+    // Create render passes, dependencies, images and framebuffers
+    postProcessGraph.build();
+    
+    // DIRECT GRAPH
+    // Scene drawn straight to swapchain image (cleared to the scene background), saves a fullscreen read & write per frame
+    directGraph.init(mainDevice.physicalDevice, mainDevice.logicalDevice, swapchainExtent,
+                     static_cast<uint32_t>(swapchainImages.size()), 1);
+    
+    RenderResource directSwapchainAttachment = directGraph.addExternalAttachment("swapchain", swapchainImageFormat, swapchainImageViews, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, true, colorClear);
+    RenderResource directDepthAttachment = directGraph.addExternalAttachment("depth", depthBufferFormat, sceneDepthImageViews, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, true, depthClear);
+    
+    scene.colorOutputs = { directSwapchainAttachment };
+    scene.depthOutput = directDepthAttachment;
+    directScenePass = directGraph.addPass(scene);
+    
+    directGraph.build();
+    
+    // OVERDRAW GRAPH
+    // Count image belongs to the renderer and is left in transfer layout, so the histogram copy can follow the graph
+    // (R16_SFLOAT supports blending on every device, counts are exact up to 2048)
+    overdrawCountImage = createImage(swapchainExtent.width, swapchainExtent.height, VK_FORMAT_R16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+                                     VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &overdrawCountImageMemory);
+    overdrawCountImageView = createImageView(overdrawCountImage, VK_FORMAT_R16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT);
+    
+    overdrawGraph.init(mainDevice.physicalDevice, mainDevice.logicalDevice, swapchainExtent,
+                       static_cast<uint32_t>(swapchainImages.size()), 1);
+    
+    VkClearValue countClear = {};
+    countClear.color = {0.0f, 0.0f, 0.0f, 0.0f};                // no fragments yet
+    RenderResource overdrawSwapchainAttachment = overdrawGraph.addExternalAttachment("swapchain", swapchainImageFormat, swapchainImageViews, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, true, swapchainClear);
+    RenderResource overdrawCountAttachment = overdrawGraph.addExternalAttachment("overdraw count", VK_FORMAT_R16_SFLOAT,
+                                                                                 std::vector<VkImageView>(swapchainImages.size(), overdrawCountImageView),
+                                                                                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, true, countClear);
+    overdrawDepthAttachment = overdrawGraph.addExternalAttachment("depth", depthBufferFormat, sceneDepthImageViews, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, true, depthClear);
+    
+    scene.colorOutputs = { overdrawCountAttachment };
+    scene.depthOutput = overdrawDepthAttachment;
+    overdrawScenePass = overdrawGraph.addPass(scene);
+    
+    postProcess.colorOutputs = { overdrawSwapchainAttachment };
+    postProcess.inputAttachments = { overdrawCountAttachment, overdrawDepthAttachment };
+    overdrawHeatmapPass = overdrawGraph.addPass(postProcess);
+    
+    overdrawGraph.build();
+}
 
 void VulkanRenderer::createCommandPool(){
     // Get indices of Queue Family from device
@@ -1098,7 +1076,7 @@ void VulkanRenderer::createCommandPool(){
 
 void VulkanRenderer::createCommandBuffers(){
     // Resize command buffer count to have one for each framebuffer
-    commandBuffers.resize(swapchainFramebuffers.size());
+    commandBuffers.resize(swapchainImages.size());
     
     VkCommandBufferAllocateInfo cbAllocInfo = {};
     cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1120,94 +1098,219 @@ void VulkanRenderer::recordCommands(uint32_t currentImage){
     bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT; // Buffer can be resubmitted when it has already been submitted and is awaiting execution
     
-    // Information about how to begin a render pass (only needed for graphical operation)
-    VkRenderPassBeginInfo renderPassBeginInfo = {};
-    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassBeginInfo.renderPass = renderpass;                            // render pass to begin
-    renderPassBeginInfo.renderArea.offset = { 0,0 };                        // Start point of render pass in pixels
-    renderPassBeginInfo.renderArea.extent = swapchainExtent;                // Size of region to run render pass on (starting at offset)
+    // Start recording commands to command buffer!
+    VkResult result = vkBeginCommandBuffer(commandBuffers[currentImage], &bufferBeginInfo);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to start recording a command buffer!");
+    }
     
-    std::array<VkClearValue, 3> clearValues = {};
-    clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f};            // clear values for swapchain image
-    clearValues[1].color = {0.6f, 0.65f, 0.4f, 1.0f};           // clears background of color buffer
-    clearValues[2].depthStencil.depth = 1.0f;                   // clears depth buffer
+    // Timestamp queries of this frame in flight, read back once its fence signals
+    if(timestampQueryPool != VK_NULL_HANDLE){
+        vkCmdResetQueryPool(commandBuffers[currentImage], timestampQueryPool, currentFrame * 2, 2);
+        vkCmdWriteTimestamp(commandBuffers[currentImage], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, currentFrame * 2);
+    }
+    // Pass queries can't be reset inside a render pass
+    passQueries.reset(commandBuffers[currentImage], currentFrame);
     
-    renderPassBeginInfo.pClearValues = clearValues.data();                         // List of clear values
-    renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    // Render passes of the graph, each pass records its own commands (recordScenePass, recordPostProcessPass)
+    getActiveRenderGraph().execute(commandBuffers[currentImage], currentImage);
     
-        renderPassBeginInfo.framebuffer = swapchainFramebuffers[currentImage];
-        
-        // Start recording commands to command buffer!
-        VkResult result = vkBeginCommandBuffer(commandBuffers[currentImage], &bufferBeginInfo);
-        if(result != VK_SUCCESS){
-            throw std::runtime_error("Failed to start recording a command buffer!");
-        }
-        
-        // Begin render pass: this is going to call the clear function
-        vkCmdBeginRenderPass(commandBuffers[currentImage], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    if(postProcessMode == POST_PROCESS_OVERDRAW){
+        recordOverdrawReadback(commandBuffers[currentImage]);
+    }
+    
+    // Pyramid of this frame's depth, for culling a later frame
+    if(occlusionCulling){
+        hizBuffer.record(commandBuffers[currentImage], currentFrame, hizPipeline, hizPipelineLayout,
+                         uboViewProjection.projection * uboViewProjection.view);
+    }
+    
+    if(timestampQueryPool != VK_NULL_HANDLE){
+        vkCmdWriteTimestamp(commandBuffers[currentImage], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, currentFrame * 2 + 1);
+    }
+    
+    // Stop recording to command buffer
+    result = vkEndCommandBuffer(commandBuffers[currentImage]);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to stop recording a command buffer!");
+    }
+}
+
+void VulkanRenderer::recordScenePass(VkCommandBuffer commandBuffer, uint32_t currentImage){
+    passQueries.begin(commandBuffer, currentFrame, QUERY_PASS_SCENE);
+    
+    // View projection (set 0) is the same for all meshes
+    VkDescriptorBufferInfo vpBufferInfo = {};
+    vpBufferInfo.buffer = vpUniformBuffer[currentImage];    // Buffer to get data from
+    vpBufferInfo.offset = 0;                                // Position of start of the data
+    vpBufferInfo.range = sizeof(UBOViewProjection);         // Size of data
+    if(descriptorUpdater.hasPushDescriptors()){
+        descriptorUpdater.push(commandBuffer, vpDescriptorTemplate, &vpBufferInfo);
+    }else{
+        // Below commented code is for DYNAMIC UNIFORM BUFFERS and is kept for futher references
+        // Note: add a model entry to vpDescriptorTemplate when below code is needed back
+        /*
+        // MODEL DESCRIPTOR
+        // Model Buffer binding infor
+        VkDescriptorBufferInfo modelBufferInfo = {};
+        modelBufferInfo.buffer = modelDUniformBuffer[currentImage];
+        modelBufferInfo.offset = 0;
+        modelBufferInfo.range = modelUniformAlignment;*/
         
-        // Bind pipeline to be used in render pass
-        vkCmdBindPipeline(commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        // One-frame set, its pool is reset once this frame's fence has signalled
+        VkDescriptorSet vpDescriptorSet = frameDescriptorAllocators[currentFrame].allocate(descriptorSetLayout);
+        descriptorUpdater.update(vpDescriptorSet, vpDescriptorTemplate, &vpBufferInfo);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &vpDescriptorSet, 0, nullptr);
+    }
+    
+    updateRenderList();
+    
+    // Distance of each mesh's bounds centre from camera, 0 at near plane to 1 at far plane
+    // Level of detail: coarsest whose error stays within LOD_PIXEL_ERROR pixels on screen, seen from the nearest point of the bounds
+    float pixelsPerUnit = std::abs(uboViewProjection.projection[1][1]) * swapchainExtent.height * 0.5f;     // At distance 1
+    meshDepths.resize(renderList.size());
+    meshLods.resize(renderList.size());
+    for(size_t i=0; i<renderList.size(); i++){
+        const glm::mat4 &model = modelTransforms[renderList.transformIndices[i]];
+        glm::vec4 viewPosition = uboViewProjection.view * model * glm::vec4(renderList.boundsCentres[i], 1.0f);
+        meshDepths[i] = (-viewPosition.z - CAMERA_NEAR) / (CAMERA_FAR - CAMERA_NEAR);
         
-        for(size_t j=0; j<modelList.size(); j++){
-            MeshModel thisModel = modelList[j];
-            glm::mat4 thisModelsModel = thisModel.getModel();
-            // "Push" constants to give shader stage directly (no buffer)
-            vkCmdPushConstants(commandBuffers[currentImage], pipelineLayout,
-                               VK_SHADER_STAGE_VERTEX_BIT,  // Stage to push constant to
-                               0,                           // Offset of push constant to update
-                               sizeof(Model),               // Size of data being pushed
-                               &thisModelsModel        // Actual data being pushed
-                               );
-            
-            for(size_t k=0; k<thisModel.getMeshCount(); k++){
-                VkBuffer vertexBuffers[] = { thisModel.getMesh(k)->getVertexBuffer() };             // Buffers to bind
-                VkDeviceSize offsets[] = { 0 };                                         // Offsets into buffer being bound
-                vkCmdBindVertexBuffers(commandBuffers[currentImage], 0, 1, vertexBuffers, offsets);// Command to bind vertex buffer before drawing with them
-                
-                // Bind mesh index buffer, with 0 offset and using the uint32 format
-                vkCmdBindIndexBuffer(commandBuffers[currentImage], thisModel.getMesh(k)->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
-                
-                // Dynamic Offset Amount
-                //uint32_t dynamicOffset = static_cast<uint32_t>(modelUniformAlignment) * j;
-                Model model = thisModel.getMesh(k)->getModel();
-                
-                std::array<VkDescriptorSet, 2> descriptorSetGroup = { descriptorSets[currentImage], samplerDescriptorSets[thisModel.getMesh(k)->getTexId()] };
-                
-                // Bind descriptor sets
-                vkCmdBindDescriptorSets(commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, static_cast<uint32_t>(descriptorSetGroup.size()), descriptorSetGroup.data(), 0, nullptr);
-                
-                // Execute pipeline
-                //vkCmdDraw(commandBuffers[i], static_cast<uint32_t>(firstMesh.getVertexCount()), 1, 0, 0);
-                vkCmdDrawIndexed(commandBuffers[currentImage], thisModel.getMesh(k)->getIndexCount(), 1, 0, 0, 0);
+        meshLods[i] = renderList.firstLods[i];
+        if(!lodSelection){
+            continue;
+        }
+        float scale = std::max(std::max(glm::length(model[0]), glm::length(model[1])), glm::length(model[2]));
+        float distance = std::max(-viewPosition.z - glm::length(renderList.boundsExtents[i]) * scale, CAMERA_NEAR);
+        for(uint32_t lod=1; lod<renderList.lodCounts[i]; lod++){
+            if(renderList.lods[renderList.firstLods[i] + lod].error * scale * pixelsPerUnit / distance > LOD_PIXEL_ERROR){
+                break;
             }
+            meshLods[i] = renderList.firstLods[i] + lod;
         }
+    }
     
-        // START SECOND SUBPASS
-    vkCmdNextSubpass(commandBuffers[currentImage], VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, secondPipeline);
-    vkCmdBindDescriptorSets(commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, secondPipelineLayout, 0, 1, &inputDescriptorSets[currentImage], 0, nullptr);
-    vkCmdDraw(commandBuffers[currentImage], 3, 1, 0, 0);
-        // End render pass
-        vkCmdEndRenderPass(commandBuffers[currentImage]);
-        
-        // Stop recording to command buffer
-        result = vkEndCommandBuffer(commandBuffers[currentImage]);
-        if(result != VK_SUCCESS){
-            throw std::runtime_error("Failed to stop recording a command buffer!");
+    // Meshes behind nearer geometry in last finished frame's depth are kept in the lists (so sort order carries over) but skipped
+    meshCulled.assign(renderList.size(), false);
+    if(occlusionCulling){
+        for(size_t i=0; i<renderList.size(); i++){
+            meshCulled[i] = hizBuffer.isOccluded(modelTransforms[renderList.transformIndices[i]], renderList.boundsCentres[i], renderList.boundsExtents[i]);
         }
+    }
+    
+    // Full detail meshes draw only their visible meshlets
+    cullMeshlets();
+    
+    // Collect a draw for every mesh, sorted nearest first (or so meshes sharing pipeline, texture & buffers are drawn together)
+    drawList.clear();
+    for(size_t i=0; i<renderList.size(); i++){
+        DrawPacket packet = {};
+        packet.pipeline = graphicsPipeline;
+        packet.textureSet = samplerDescriptorSets[renderList.textureIds[i]];
+        packet.vertexBuffer = renderList.vertexBuffers[i];
+        packet.indexBuffer = renderList.indexBuffers[i];
+        packet.indexCount = renderList.lods[meshLods[i]].indexCount;
+        packet.firstIndex = renderList.firstIndices[i] + renderList.lods[meshLods[i]].firstIndex;
+        packet.vertexOffset = renderList.vertexOffsets[i];
+        packet.transformIndex = renderList.transformIndices[i];
+        packet.culled = meshCulled[i];
+        packet.pipelineId = 0;                                              // One pipeline (variant) for the whole pass
+        packet.textureId = renderList.textureIds[i];
+        packet.geometryId = renderList.geometryIds[i];
+        if(meshMeshletDraws[i] != UINT32_MAX){                              // Visible meshlets only, drawn indirectly
+            packet.indexCount = meshMeshletIndexCounts[i];
+            packet.indirectBuffer = meshletDrawBuffers[currentFrame];
+            packet.indirectOffset = meshMeshletDraws[i] * sizeof(VkDrawIndexedIndirectCommand);
+            packet.indirectDrawCount = meshMeshletDrawCounts[i];
+            packet.culled = packet.culled || packet.indirectDrawCount == 0;
+        }
+        drawList.add(packet, meshDepths[i]);
+    }
+    drawList.sort();
+    
+    // Depth prepass: same geometry, positions only, nearest first so later draws fail the depth test early
+    if(depthPrepass){
+        depthPrepassList.clear();
+        for(size_t i=0; i<renderList.size(); i++){
+            DrawPacket packet = {};
+            packet.pipeline = depthPrepassPipeline;
+            packet.textureSet = VK_NULL_HANDLE;
+            packet.vertexBuffer = renderList.vertexBuffers[i];
+            packet.indexBuffer = renderList.indexBuffers[i];
+            packet.indexCount = renderList.lods[meshLods[i]].indexCount;        // Same level as shading pass, so depths match exactly
+            packet.firstIndex = renderList.firstIndices[i] + renderList.lods[meshLods[i]].firstIndex;
+            packet.vertexOffset = renderList.vertexOffsets[i];
+            packet.transformIndex = renderList.transformIndices[i];
+            packet.culled = meshCulled[i];
+            packet.geometryId = renderList.geometryIds[i];
+            if(meshMeshletDraws[i] != UINT32_MAX){
+                packet.indexCount = meshMeshletIndexCounts[i];
+                packet.indirectBuffer = meshletDrawBuffers[currentFrame];
+                packet.indirectOffset = meshMeshletDraws[i] * sizeof(VkDrawIndexedIndirectCommand);
+                packet.indirectDrawCount = meshMeshletDrawCounts[i];
+                packet.culled = packet.culled || packet.indirectDrawCount == 0;
+            }
+            depthPrepassList.add(packet, meshDepths[i]);
+        }
+        depthPrepassList.sort();
+        depthPrepassList.record(commandBuffer, pipelineLayout, modelTransforms);
+    }
+    
+    // Execute pipeline
+    drawList.record(commandBuffer, pipelineLayout, modelTransforms);
     
+    // Report when scene changes
+    DrawListStats stats = drawList.getStats();
+    if(stats.drawCount != drawStats.drawCount || stats.savedBindCount != drawStats.savedBindCount){
+        printf(">>> Draw list: %u draws, %u binds (%u saved by sorting), %u culled\n", stats.drawCount, stats.bindCount, stats.savedBindCount, stats.culledCount);
+        drawStats = stats;
+    }
+    
+    passQueries.end(commandBuffer, currentFrame, QUERY_PASS_SCENE);
+}
+
+void VulkanRenderer::recordPostProcessPass(VkCommandBuffer commandBuffer, uint32_t currentImage){
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, secondPipeline);
+    VkDescriptorSet inputSet = postProcessMode == POST_PROCESS_OVERDRAW ? overdrawInputDescriptorSets[currentImage] : inputDescriptorSets[currentImage];
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, secondPipelineLayout, 0, 1, &inputSet, 0, nullptr);
+    PostProcessSettings postProcessSettings = {};
+    postProcessSettings.splitX = swapchainExtent.width / 2.0f;          // Split screen in half
+    vkCmdPushConstants(commandBuffer, secondPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PostProcessSettings), &postProcessSettings);
+    passQueries.begin(commandBuffer, currentFrame, QUERY_PASS_POST_PROCESS);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);                               // Fullscreen triangle
+    passQueries.end(commandBuffer, currentFrame, QUERY_PASS_POST_PROCESS);
 }
 
 void VulkanRenderer::draw(){
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+    if(sceneRecorder.isRecording()){
+        sceneRecorder.recordFrame();
+    }
+    
     // 1. Get next available image to draw to and set something to signal when we are finished with image (a semaphore)
     // Wait for give fence to signal (open) from last draw before continuing
     vkWaitForFences(mainDevice.logicalDevice, 1, &drawFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
     // Manually reset (close) fences
     vkResetFences(mainDevice.logicalDevice, 1, &drawFences[currentFrame]);
+    // Previous frame using this slot has finished, so its timestamps & pass queries are ready
+    readFrameTimestamps();
+    readPassQueries();
+    readOverdrawHistogram();
+    hizBuffer.readResults(currentFrame);
+    // GPU is done with this frame's previous use, so its one-frame descriptor sets can be recycled
+    frameDescriptorAllocators[currentFrame].reset();
+    // ...and every frame before it is done too, so resources released before then can be destroyed
+    if(submittedFrameCount + 1 >= MAX_FRAME_DRAWS){
+        deletionQueue.flush(submittedFrameCount + 1 - MAX_FRAME_DRAWS);
+    }
     // Wait for the device to become idle
     vkDeviceWaitIdle(mainDevice.logicalDevice);
     
+    // Pick up edited shaders, only affected pipelines are rebuilt
+    if(pipelineLibrary.reloadChangedShaders()){
+        updatePipelines();
+        hizPipeline = pipelineLibrary.getComputePipeline("hiz.comp", hizPipelineLayout);
+    }
+    
     uint32_t imageIndex;
     vkAcquireNextImageKHR(mainDevice.logicalDevice, swapchain, std::numeric_limits<uint64_t>::max(), imageAvailable[currentFrame], VK_NULL_HANDLE, &imageIndex);
     
@@ -1250,8 +1353,29 @@ void VulkanRenderer::draw(){
         throw std::runtime_error("Failed to present rendered image to Screen!");
     }
     
+    DrawListStats drawListStats = drawList.getStats();
+    frameStats.drawCount = drawListStats.drawCount;
+    frameStats.bindCount = drawListStats.bindCount;
+    frameStats.triangleCount = drawListStats.triangleCount;
+    frameStats.culledCount = drawListStats.culledCount;
+    frameStats.culledMeshletCount = culledMeshletCount;
+    if(depthPrepass){
+        DrawListStats prepassStats = depthPrepassList.getStats();
+        frameStats.drawCount += prepassStats.drawCount;
+        frameStats.bindCount += prepassStats.bindCount;
+        frameStats.triangleCount += prepassStats.triangleCount;
+    }
+    frameStats.cpuTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    
+    // Startup KPI: init, scene loading and first frame
+    if(submittedFrameCount == 0){
+        double timeToFirstFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - initStartTime).count();
+        printf(">>> Time to first frame: %.2f ms\n", timeToFirstFrame);
+    }
+    
     // Get next frame (use % MAX_FRAME_DRAWS to keep value below MAX_FRAME_DRAWS)
     currentFrame = (currentFrame + 1) % MAX_FRAME_DRAWS;
+    submittedFrameCount++;
 }
 
 void VulkanRenderer::createSynchronization(){
@@ -1277,6 +1401,188 @@ void VulkanRenderer::createSynchronization(){
     }
 }
 
+void VulkanRenderer::createTimestampQueryPool(){
+    if(!timestampsSupported){
+        printf(">>> Timestamp queries not supported, GPU frame time not measured\n");
+        return;
+    }
+    
+    VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = MAX_FRAME_DRAWS * 2;               // Start & end of each frame in flight
+    
+    VkResult result = vkCreateQueryPool(mainDevice.logicalDevice, &queryPoolCreateInfo, nullptr, &timestampQueryPool);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create a Query Pool!");
+    }
+}
+
+// GPU time of the frame last submitted with currentFrame (call after its fence has signalled)
+void VulkanRenderer::readFrameTimestamps(){
+    if(timestampQueryPool == VK_NULL_HANDLE || submittedFrameCount < MAX_FRAME_DRAWS){
+        return;                 // Not measured, or no frame submitted with currentFrame yet
+    }
+    
+    uint64_t timestamps[2];
+    VkResult result = vkGetQueryPoolResults(mainDevice.logicalDevice, timestampQueryPool, currentFrame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if(result != VK_SUCCESS){
+        return;
+    }
+    frameStats.gpuTime = (timestamps[1] - timestamps[0]) * timestampPeriod / 1000000.0;
+    frameStats.gpuTimeValid = true;
+}
+
+FrameStats VulkanRenderer::getFrameStats(){
+    return frameStats;
+}
+
+void VulkanRenderer::createPassQueries(){
+    if(!pipelineStatisticsSupported){
+        printf(">>> Pipeline statistics queries not supported, only samples passed counted per pass\n");
+    }
+    passQueries.init(mainDevice.logicalDevice, MAX_FRAME_DRAWS, pipelineStatisticsSupported, preciseOcclusionSupported);
+}
+
+void VulkanRenderer::readPassQueries(){
+    passQueries.readResults(currentFrame);
+    
+    // Report when scene pass work changes
+    PassStats stats = passQueries.getStats(QUERY_PASS_SCENE);
+    if(!stats.valid || !passQueries.hasStatistics()
+       || (stats.vertexShaderInvocations == scenePassStats.vertexShaderInvocations && stats.clippingPrimitives == scenePassStats.clippingPrimitives)){
+        return;
+    }
+    double vertexReuse = stats.vertexShaderInvocations > 0 ? (double) stats.inputVertices / stats.vertexShaderInvocations : 0.0;
+    double overdraw = (double) stats.fragmentShaderInvocations / (swapchainExtent.width * swapchainExtent.height);
+    printf(">>> Scene pass: %llu vertices, %llu vertex shader invocations (reuse %.2f), %llu primitives, %llu fragments (overdraw %.2f)\n",
+           (unsigned long long) stats.inputVertices, (unsigned long long) stats.vertexShaderInvocations, vertexReuse,
+           (unsigned long long) stats.clippingPrimitives, (unsigned long long) stats.fragmentShaderInvocations, overdraw);
+    scenePassStats = stats;
+}
+
+// Host visible copy of overdraw count image for each frame in flight
+void VulkanRenderer::createOverdrawReadback(){
+    VkDeviceSize bufferSize = swapchainExtent.width * swapchainExtent.height * sizeof(uint16_t);     // R16_SFLOAT
+    overdrawReadbackBuffers.resize(MAX_FRAME_DRAWS);
+    overdrawReadbackBufferMemory.resize(MAX_FRAME_DRAWS);
+    overdrawReadbackPending.assign(MAX_FRAME_DRAWS, false);
+    for(size_t i=0; i<MAX_FRAME_DRAWS; i++){
+        createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &overdrawReadbackBuffers[i], &overdrawReadbackBufferMemory[i]);
+    }
+}
+
+// Copy counts of this frame to its readback buffer (graph left the count image in TRANSFER_SRC_OPTIMAL)
+void VulkanRenderer::recordOverdrawReadback(VkCommandBuffer commandBuffer){
+    VkBufferImageCopy region = {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { swapchainExtent.width, swapchainExtent.height, 1 };
+    vkCmdCopyImageToBuffer(commandBuffer, overdrawCountImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, overdrawReadbackBuffers[currentFrame], 1, &region);
+    
+    // Make copy visible to host reads once the frame's fence signals
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = overdrawReadbackBuffers[currentFrame];
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    
+    overdrawReadbackPending[currentFrame] = true;
+}
+
+// Build histogram from counts copied by the frame that last used currentFrame (its fence has signalled)
+void VulkanRenderer::readOverdrawHistogram(){
+    if(overdrawReadbackPending.empty() || !overdrawReadbackPending[currentFrame]){
+        return;
+    }
+    overdrawReadbackPending[currentFrame] = false;
+    if(postProcessMode != POST_PROCESS_OVERDRAW){
+        return;                 // Switched away since copy was recorded
+    }
+    
+    uint32_t pixelCount = swapchainExtent.width * swapchainExtent.height;
+    void *data;
+    vkMapMemory(mainDevice.logicalDevice, overdrawReadbackBufferMemory[currentFrame], 0, pixelCount * sizeof(uint16_t), 0, &data);
+    const uint16_t *counts = static_cast<const uint16_t *>(data);
+    
+    OverdrawHistogram histogram = {};
+    uint32_t coveredPixels = 0;
+    for(uint32_t i=0; i<pixelCount; i++){
+        // Half float holding a small whole number: 1.mantissa * 2^(exponent - 15)
+        uint32_t exponent = (counts[i] >> 10) & 0x1f;
+        uint32_t mantissa = counts[i] & 0x3ff;
+        uint32_t count = exponent == 0 ? 0 : static_cast<uint32_t>(ldexp(1.0 + mantissa / 1024.0, static_cast<int>(exponent) - 15) + 0.5);
+        
+        histogram.pixels[std::min(count, static_cast<uint32_t>(OVERDRAW_HISTOGRAM_SIZE - 1))]++;
+        histogram.maxCount = std::max(histogram.maxCount, count);
+        histogram.fragmentCount += count;
+        coveredPixels += count > 0 ? 1 : 0;
+    }
+    vkUnmapMemory(mainDevice.logicalDevice, overdrawReadbackBufferMemory[currentFrame]);
+    
+    histogram.average = coveredPixels > 0 ? (double) histogram.fragmentCount / coveredPixels : 0.0;
+    histogram.valid = true;
+    overdrawHistogram = histogram;
+}
+
+// Hi-Z pyramid of scene depth with its compute pipeline & one descriptor set per level
+void VulkanRenderer::createHiZBuffer(){
+    hizBuffer.init(mainDevice.physicalDevice, mainDevice.logicalDevice, swapchainExtent, MAX_FRAME_DRAWS);
+    
+    // Level sizes are pushed with each dispatch
+    VkPushConstantRange hizPushConstantRange = {};
+    hizPushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    hizPushConstantRange.offset = 0;
+    hizPushConstantRange.size = sizeof(HiZLevelSize);
+    
+    VkPipelineLayoutCreateInfo hizPipelineLayoutCreateInfo = {};
+    hizPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    hizPipelineLayoutCreateInfo.setLayoutCount = 1;
+    hizPipelineLayoutCreateInfo.pSetLayouts = &hizSetLayout;
+    hizPipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    hizPipelineLayoutCreateInfo.pPushConstantRanges = &hizPushConstantRange;
+    
+    VkResult result = vkCreatePipelineLayout(mainDevice.logicalDevice, &hizPipelineLayoutCreateInfo, nullptr, &hizPipelineLayout);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create Hi-Z Pipeline Layout!");
+    }
+    hizPipeline = pipelineLibrary.getComputePipeline("hiz.comp", hizPipelineLayout);
+    
+    hizBuffer.createDescriptorSets(descriptorAllocator, descriptorUpdater, hizDescriptorTemplate, hizSetLayout, sceneDepthImageView, textureSampler);
+    printf(">>> Hi-Z pyramid: %u levels\n", hizBuffer.getLevelCount());
+}
+
+// Indirect draws of visible meshlets, written by host each frame (the frame's fence has signalled before it is overwritten)
+void VulkanRenderer::createMeshletDrawBuffers(){
+    VkDeviceSize bufferSize = MESHLET_MAX_INDIRECT_DRAWS * sizeof(VkDrawIndexedIndirectCommand);
+    meshletDrawBuffers.resize(MAX_FRAME_DRAWS);
+    meshletDrawBufferMemory.resize(MAX_FRAME_DRAWS);
+    for(size_t i=0; i<MAX_FRAME_DRAWS; i++){
+        createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, bufferSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &meshletDrawBuffers[i], &meshletDrawBufferMemory[i]);
+    }
+}
+
+// Histogram of the most recently finished overdraw frame, valid is false outside POST_PROCESS_OVERDRAW
+OverdrawHistogram VulkanRenderer::getOverdrawHistogram(){
+    return overdrawHistogram;
+}
+
+// Counters of pass in the most recently finished frame, valid is false if pass didn't run or results weren't ready
+PassStats VulkanRenderer::getPassStats(QueryPass pass){
+    return passQueries.getStats(pass);
+}
+
+LoadProfiler &VulkanRenderer::getLoadProfiler(){
+    return loadProfiler;
+}
+
 void VulkanRenderer::createDescriptorSetLayout(){
     // UNIFORM VALUES DESCRIPTOR SET LAYOUT
     // MVP Binding info
@@ -1304,6 +1610,9 @@ void VulkanRenderer::createDescriptorSetLayout(){
     // Create Descriptor set layout with give bindings
     VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
     layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    if(descriptorUpdater.hasPushDescriptors()){
+        layoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;  // Written into command buffer each frame, no sets allocated
+    }
     layoutCreateInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());                  // Number of binding infos
     layoutCreateInfo.pBindings = layoutBindings.data();     // Array of binding infos
     
@@ -1365,6 +1674,34 @@ void VulkanRenderer::createDescriptorSetLayout(){
     if(result != VK_SUCCESS){
         throw std::runtime_error("Failed to create a Input Sampler Descriptor Set Layout!");
     }
+    
+    
+    // CREATE HI-Z LEVEL DESCRIPTOR SET LAYOUT
+    // Source (scene depth or previous level) Binding
+    VkDescriptorSetLayoutBinding hizSourceLayoutBinding = {};
+    hizSourceLayoutBinding.binding = 0;
+    hizSourceLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    hizSourceLayoutBinding.descriptorCount = 1;
+    hizSourceLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    
+    // Destination level Binding
+    VkDescriptorSetLayoutBinding hizDestinationLayoutBinding = {};
+    hizDestinationLayoutBinding.binding = 1;
+    hizDestinationLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    hizDestinationLayoutBinding.descriptorCount = 1;
+    hizDestinationLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    
+    std::vector<VkDescriptorSetLayoutBinding> hizBindings = {hizSourceLayoutBinding, hizDestinationLayoutBinding};
+    
+    VkDescriptorSetLayoutCreateInfo hizLayoutCreateInfo = {};
+    hizLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    hizLayoutCreateInfo.bindingCount = static_cast<uint32_t>(hizBindings.size());
+    hizLayoutCreateInfo.pBindings = hizBindings.data();
+    
+    result = vkCreateDescriptorSetLayout(mainDevice.logicalDevice, &hizLayoutCreateInfo, nullptr, &hizSetLayout);
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to create a Hi-Z Descriptor Set Layout!");
+    }
 }
 
 void VulkanRenderer::createUniformBuffers(){
@@ -1391,145 +1728,45 @@ void VulkanRenderer::createUniformBuffers(){
     }
 }
 
-void VulkanRenderer::createDescriptorPool(){
-    // CREATE UNIFORM DESCRIPTOR POOL
-    
+void VulkanRenderer::createDescriptorAllocators(){
     // Type of descriptors + how many DESCRIPTORS, not Descriptor Sets (combined makes the pool size)
-    // ViewProjection Pool
+    // Enough for one set of any of our layouts, pools are chained as they fill up so there is no limit on sets
+    // ViewProjection
     VkDescriptorPoolSize vpPoolSize = {};
     vpPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    vpPoolSize.descriptorCount = static_cast<uint32_t>(vpUniformBuffer.size());
+    vpPoolSize.descriptorCount = 1;
     
     // Below commented code is for DYNAMIC UNIFORM BUFFERS and is kept for futher references
-    // Note: add modelPoolSize to descriptorPoolSizes vector when below code is needed back
+    // Note: add modelPoolSize to descriptorsPerSet vector when below code is needed back
     /*
     // Modelpool (DYNAMIC)
     VkDescriptorPoolSize modelPoolSize = {};
     modelPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-    modelPoolSize.descriptorCount = static_cast<uint32_t>(modelDUniformBuffer.size());
+    modelPoolSize.descriptorCount = 1;
     */
-    // List of pool sizes
-    std::vector<VkDescriptorPoolSize> descriptorPoolSizes = {vpPoolSize};
-    
-    // Data to create Descriptor pool
-    VkDescriptorPoolCreateInfo poolCreateInfo = {};
-    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolCreateInfo.maxSets = static_cast<uint32_t>(swapchainImages.size());                     // Maximum number of descriptor sets that can be created from pool
-    poolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());           // Amount of pool sizes being passed
-    poolCreateInfo.pPoolSizes = descriptorPoolSizes.data();                                     // Pool sizes to create pool with
-    
-    // Create descriptor pool
-    VkResult result = vkCreateDescriptorPool(mainDevice.logicalDevice, &poolCreateInfo, nullptr, &descriptorPool);
-    if(result != VK_SUCCESS){
-        throw std::runtime_error("Failed to create a Descriptor Pool!");
-    }
     
-    // CREATE SAMPLER DESCRIPTOR POOL
-    // Texture Sampler Pool
+    // Texture Sampler
     VkDescriptorPoolSize samplerPoolSize = {};
     samplerPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerPoolSize.descriptorCount = MAX_OBJECTS;
-    
-    VkDescriptorPoolCreateInfo samplerPoolCreateInfo = {};
-    samplerPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    samplerPoolCreateInfo.maxSets = MAX_OBJECTS;
-    samplerPoolCreateInfo.poolSizeCount = 1;
-    samplerPoolCreateInfo.pPoolSizes = &samplerPoolSize;
-    
-    result = vkCreateDescriptorPool(mainDevice.logicalDevice, &samplerPoolCreateInfo, nullptr, &samplerDescriptorPool);
-    if(result != VK_SUCCESS){
-        throw std::runtime_error("Failed to create a Sampler Descriptor Pool!");
-    }
+    samplerPoolSize.descriptorCount = 1;
     
+    // Color & Depth Input Attachments
+    VkDescriptorPoolSize inputPoolSize = {};
+    inputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    inputPoolSize.descriptorCount = 2;
     
-    // CREATE INPUT ATTACHMENT DESCRIPTOR POOL
-    // Color Attachment Pool Size
-    VkDescriptorPoolSize colorInputPoolSize = {};
-    colorInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-    colorInputPoolSize.descriptorCount = static_cast<uint32_t>(colorBufferImageView.size());
+    // Hi-Z level destination
+    VkDescriptorPoolSize storagePoolSize = {};
+    storagePoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    storagePoolSize.descriptorCount = 1;
     
-    // Depth Attachment Pool Size
-    VkDescriptorPoolSize depthInputPoolSize = {};
-    depthInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-    depthInputPoolSize.descriptorCount = static_cast<uint32_t>(depthBufferImageView.size());
+    std::vector<VkDescriptorPoolSize> descriptorsPerSet = { vpPoolSize, samplerPoolSize, inputPoolSize, storagePoolSize };
     
-    std::vector<VkDescriptorPoolSize> inputPoolSizes = { colorInputPoolSize, depthInputPoolSize};
+    descriptorAllocator.init(mainDevice.logicalDevice, DESCRIPTOR_POOL_SETS, descriptorsPerSet);
     
-    // Create Input Attachment Pool
-    VkDescriptorPoolCreateInfo inputPoolCreateInfo = {};
-    inputPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    inputPoolCreateInfo.maxSets = swapchainImages.size();
-    inputPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(inputPoolSizes.size());
-    inputPoolCreateInfo.pPoolSizes = inputPoolSizes.data();
-    
-    result = vkCreateDescriptorPool(mainDevice.logicalDevice, &inputPoolCreateInfo, nullptr, &inputDescriptorPool);
-    if(result != VK_SUCCESS){
-        throw std::runtime_error("Failed to create a Inpput Sampler Descriptor Pool!");
-    }
-}
-
-void VulkanRenderer::createDescriptorSets(){
-    // Resize Descriptor set list so one for every buffer
-    descriptorSets.resize(swapchainImages.size());
-    
-    std::vector<VkDescriptorSetLayout> setLayouts(swapchainImages.size(), descriptorSetLayout);
-    
-    // Descriptor set allocation info
-    VkDescriptorSetAllocateInfo setAllocInfo = {};
-    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    setAllocInfo.descriptorPool = descriptorPool;                                   // Pool to allocate descriptor sets from
-    setAllocInfo.descriptorSetCount = static_cast<uint32_t>(swapchainImages.size());// Number of sets to allocate
-    setAllocInfo.pSetLayouts = setLayouts.data();                                   // Layout to use to allocate sets (1:1 relationship)
-    
-    // Allocate Descriptor Sets (multiple)
-    VkResult result = vkAllocateDescriptorSets(mainDevice.logicalDevice, &setAllocInfo, descriptorSets.data());
-    if(result != VK_SUCCESS){
-        throw std::runtime_error("Failed to allocate Descriptor Sets!");
-    }
-    
-    // Update all of descriptor set buffer bindings
-    for(size_t i=0; i<swapchainImages.size(); i++){
-        // VIEW PROJECTION DESCRIPTOR
-        // Buffer info and data offset info
-        VkDescriptorBufferInfo vpBufferInfo = {};
-        vpBufferInfo.buffer = vpUniformBuffer[i];           // Buffer to get data from
-        vpBufferInfo.offset = 0;                            // Position of start of the data
-        vpBufferInfo.range = sizeof(UBOViewProjection);     // Size of data
-        
-        // Data about connection between binding and buffer
-        VkWriteDescriptorSet vpSetWrite = {};
-        vpSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        vpSetWrite.dstSet = descriptorSets[i];                             // Descriptor set to update
-        vpSetWrite.dstBinding = 0;                                         // Binding to update (matches with binding on layout/shader)
-        vpSetWrite.dstArrayElement = 0;                                    // Index in array to update
-        vpSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;     // Type of descriptor (should match with type of descriptor set)
-        vpSetWrite.descriptorCount = 1;                                    // Amount to update
-        vpSetWrite.pBufferInfo = &vpBufferInfo;                            // Information about data to bind
-        
-        // Below commented code is for DYNAMIC UNIFORM BUFFERS and is kept for futher references
-        // Note: add modelSetWrite to setWrites vector when below code is needed back
-        /*
-        // MODEL DESCRIPTOR
-        // Model Buffer binding infor
-        VkDescriptorBufferInfo modelBufferInfo = {};
-        modelBufferInfo.buffer = modelDUniformBuffer[i];
-        modelBufferInfo.offset = 0;
-        modelBufferInfo.range = modelUniformAlignment;
-        
-        VkWriteDescriptorSet modelSetWrite = {};
-        modelSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        modelSetWrite.dstSet = descriptorSets[i];
-        modelSetWrite.dstBinding = 1;
-        modelSetWrite.dstArrayElement = 0;
-        modelSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-        modelSetWrite.descriptorCount = 1;
-        modelSetWrite.pBufferInfo = &modelBufferInfo;*/
-        
-        // List of Descriptor Set Writes
-        std::vector<VkWriteDescriptorSet> setWrites = {vpSetWrite};
-        
-        // Update the descriptor sets with new buffer binding info
-        vkUpdateDescriptorSets(mainDevice.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+    frameDescriptorAllocators.resize(MAX_FRAME_DRAWS);
+    for(DescriptorAllocator &frameDescriptorAllocator: frameDescriptorAllocators){
+        frameDescriptorAllocator.init(mainDevice.logicalDevice, DESCRIPTOR_POOL_SETS, descriptorsPerSet);
     }
 }
 
@@ -1553,11 +1790,223 @@ void VulkanRenderer::updateUniformBuffers(uint32_t imageIndex){
     vkUnmapMemory(mainDevice.logicalDevice, modelDUniformBufferMemory[imageIndex]);*/
 }
 
-void VulkanRenderer::updateModel(int modelId, glm::mat4 newModel){
-    if(modelId >= modelList.size()){
+void VulkanRenderer::updateModel(ModelHandle model, glm::mat4 newModel){
+    if(!isModelValid(model)){
         return;
     }
-    modelList[modelId].setModel(newModel);
+    // Unchanged transforms are left out of the recording
+    if(sceneRecorder.isRecording() && modelList[model.index].getModel() != newModel){
+        sceneRecorder.recordUpdateModel(model, newModel);
+    }
+    modelList[model.index].setModel(newModel);
+    if(model.index < modelTransforms.size()){
+        modelTransforms[model.index] = newModel;
+    }
+}
+
+void VulkanRenderer::setCamera(glm::mat4 view){
+    if(sceneRecorder.isRecording()){
+        sceneRecorder.recordCamera(view);
+    }
+    uboViewProjection.view = view;
+}
+
+// Log scene API calls (models, textures, camera) and frames to fileName, for replay with SceneReplayer
+void VulkanRenderer::startRecording(const std::string &fileName){
+    sceneRecorder.open(fileName);
+    
+    // Camera set at init isn't part of the log yet
+    sceneRecorder.recordCamera(uboViewProjection.view);
+    printf(">>> Recording scene to %s\n", fileName.c_str());
+}
+
+void VulkanRenderer::stopRecording(){
+    if(sceneRecorder.isRecording()){
+        printf(">>> Recorded %u frames\n", sceneRecorder.getFrameCount());
+        sceneRecorder.close();
+    }
+}
+
+void VulkanRenderer::setPostProcessMode(PostProcessMode mode){
+    postProcessMode = mode;
+    if(mode != POST_PROCESS_OVERDRAW){
+        overdrawHistogram.valid = false;
+    }
+    updatePipelines();
+}
+
+void VulkanRenderer::setTextureSampling(bool enabled){
+    textureSampling = enabled;
+    updatePipelines();
+}
+
+void VulkanRenderer::setDrawOrder(DrawOrder order){
+    drawList.setOrder(order);
+}
+
+void VulkanRenderer::setDepthPrepass(bool enabled){
+    depthPrepass = enabled;
+    updatePipelines();
+}
+
+void VulkanRenderer::setLodSelection(bool enabled){
+    lodSelection = enabled;
+}
+
+void VulkanRenderer::setMeshletCulling(bool enabled){
+    meshletCulling = enabled;
+}
+
+void VulkanRenderer::setOcclusionCulling(bool enabled){
+    occlusionCulling = enabled;
+    hizBuffer.clearResults();                   // Pyramid from before culling was switched off may be long out of date
+}
+
+// Pick pipeline variants matching current settings (library creates a variant if it wasn't requested before)
+void VulkanRenderer::updatePipelines(){
+    bool direct = postProcessMode == POST_PROCESS_NONE;
+    bool overdraw = postProcessMode == POST_PROCESS_OVERDRAW;
+    uint32_t activeScenePass = direct ? directScenePass : (overdraw ? overdrawScenePass : scenePass);
+    
+    // After a depth prepass only the nearest surface (depth equal to what the prepass wrote) is shaded
+    VkCompareOp depthCompareOp = depthPrepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
+    VkBool32 depthWriteEnable = depthPrepass ? VK_FALSE : VK_TRUE;
+    if(overdraw){
+        overdrawPipelineDescription.depthCompareOp = depthCompareOp;
+        overdrawPipelineDescription.depthWriteEnable = depthWriteEnable;
+        graphicsPipeline = pipelineLibrary.getPipeline(overdrawPipelineDescription);
+    }else{
+        mainPipelineDescription.renderPass = getActiveRenderGraph().getRenderPass(activeScenePass);
+        mainPipelineDescription.subpass = getActiveRenderGraph().getSubpass(activeScenePass);
+        mainPipelineDescription.depthCompareOp = depthCompareOp;
+        mainPipelineDescription.depthWriteEnable = depthWriteEnable;
+        mainPipelineDescription.fragmentConstants = { static_cast<VkBool32>(textureSampling) };
+        graphicsPipeline = pipelineLibrary.getPipeline(mainPipelineDescription);
+    }
+    
+    depthPrepassPipelineDescription.renderPass = getActiveRenderGraph().getRenderPass(activeScenePass);
+    depthPrepassPipelineDescription.subpass = getActiveRenderGraph().getSubpass(activeScenePass);
+    depthPrepassPipeline = pipelineLibrary.getPipeline(depthPrepassPipelineDescription);
+    
+    // Second pass doesn't run on the direct path
+    if(!direct){
+        secondPipelineDescription.renderPass = getActiveRenderGraph().getRenderPass(overdraw ? overdrawHeatmapPass : postProcessPass);
+        secondPipelineDescription.subpass = getActiveRenderGraph().getSubpass(overdraw ? overdrawHeatmapPass : postProcessPass);
+        secondPipelineDescription.fragmentConstants = { static_cast<uint32_t>(postProcessMode) };
+        secondPipeline = pipelineLibrary.getPipeline(secondPipelineDescription);
+    }
+}
+
+// Flatten meshes of all models into renderList (only when models were added since last time)
+void VulkanRenderer::updateRenderList(){
+    if(!renderListChanged){
+        return;
+    }
+    
+    renderList.clear();
+    modelTransforms.resize(modelList.size());
+    for(size_t i=0; i<modelList.size(); i++){
+        modelTransforms[i] = modelList[i].getModel();
+        if(!modelAlive[i]){
+            continue;
+        }
+        for(size_t j=0; j<modelList[i].getMeshCount(); j++){
+            renderList.addMesh(modelList[i].getMesh(j), static_cast<uint32_t>(i));
+        }
+    }
+    renderListChanged = false;
+}
+
+// Meshlets of meshes drawn at full detail are tested against the view frustum (bounding sphere) and for facing away from the camera
+// (normal cone), the rest become indirect draws in this frame's buffer. Visible meshlets next to each other in the index buffer
+// are merged into one draw. Meshes without meshlets, at a coarser level of detail or not fitting the buffer are drawn whole
+void VulkanRenderer::cullMeshlets(){
+    meshMeshletDraws.assign(renderList.size(), UINT32_MAX);
+    meshMeshletDrawCounts.assign(renderList.size(), 0);
+    meshMeshletIndexCounts.assign(renderList.size(), 0);
+    culledMeshletCount = 0;
+    meshletDrawCommands.clear();
+    if(!meshletCulling || renderList.meshlets.empty()){
+        return;
+    }
+    
+    // Inward facing frustum planes from rows of view projection: -w <= x <= w, -w <= y <= w, -w <= z <= w
+    // (near plane is -w <= z even with 0 to 1 depth, which only culls a little less)
+    glm::mat4 viewProjection = uboViewProjection.projection * uboViewProjection.view;
+    glm::vec4 rows[4];
+    for(int i=0; i<4; i++){
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+    glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+    for(glm::vec4 &plane: planes){
+        plane /= glm::length(glm::vec3(plane.x, plane.y, plane.z));
+    }
+    glm::vec4 cameraPosition = glm::inverse(uboViewProjection.view)[3];
+    
+    for(size_t i=0; i<renderList.size(); i++){
+        uint32_t meshletCount = renderList.meshletCounts[i];
+        if(meshletCount == 0 || meshLods[i] != renderList.firstLods[i] || meshCulled[i]
+           || meshletDrawCommands.size() + meshletCount > MESHLET_MAX_INDIRECT_DRAWS){
+            continue;
+        }
+        
+        const glm::mat4 &model = modelTransforms[renderList.transformIndices[i]];
+        float scale = std::max(std::max(glm::length(model[0]), glm::length(model[1])), glm::length(model[2]));
+        // Mirroring transforms swap which side of a triangle is drawn, cones only describe the unmirrored side
+        bool backfaceTest = glm::determinant(glm::mat3(model)) > 0.0f;
+        glm::vec4 modelCamera = glm::inverse(model) * cameraPosition;
+        glm::vec3 cameraInModel(modelCamera.x, modelCamera.y, modelCamera.z);
+        
+        uint32_t firstDraw = static_cast<uint32_t>(meshletDrawCommands.size());
+        for(uint32_t m=renderList.firstMeshlets[i]; m<renderList.firstMeshlets[i] + meshletCount; m++){
+            const Meshlet &meshlet = renderList.meshlets[m];
+            glm::vec4 centre = model * glm::vec4(meshlet.centre, 1.0f);
+            bool visible = true;
+            for(const glm::vec4 &plane: planes){
+                if(plane.x * centre.x + plane.y * centre.y + plane.z * centre.z + plane.w < -meshlet.radius * scale){
+                    visible = false;
+                    break;
+                }
+            }
+            if(!visible || (backfaceTest && MeshletBuilder::isBackfacing(meshlet, cameraInModel))){
+                culledMeshletCount++;
+                continue;
+            }
+            
+            uint32_t firstIndex = renderList.firstIndices[i] + meshlet.firstIndex;
+            meshMeshletIndexCounts[i] += meshlet.indexCount;
+            if(meshletDrawCommands.size() > firstDraw && meshletDrawCommands.back().firstIndex + meshletDrawCommands.back().indexCount == firstIndex){
+                meshletDrawCommands.back().indexCount += meshlet.indexCount;
+                continue;
+            }
+            VkDrawIndexedIndirectCommand drawCommand = {};
+            drawCommand.indexCount = meshlet.indexCount;
+            drawCommand.instanceCount = 1;
+            drawCommand.firstIndex = firstIndex;
+            drawCommand.vertexOffset = renderList.vertexOffsets[i];
+            drawCommand.firstInstance = 0;
+            meshletDrawCommands.push_back(drawCommand);
+        }
+        meshMeshletDraws[i] = firstDraw;
+        meshMeshletDrawCounts[i] = static_cast<uint32_t>(meshletDrawCommands.size()) - firstDraw;
+    }
+    
+    if(meshletDrawCommands.empty()){
+        return;
+    }
+    void *data;
+    vkMapMemory(mainDevice.logicalDevice, meshletDrawBufferMemory[currentFrame], 0, meshletDrawCommands.size() * sizeof(VkDrawIndexedIndirectCommand), 0, &data);
+    memcpy(data, meshletDrawCommands.data(), meshletDrawCommands.size() * sizeof(VkDrawIndexedIndirectCommand));
+    vkUnmapMemory(mainDevice.logicalDevice, meshletDrawBufferMemory[currentFrame]);
+}
+
+// Render path for current post process mode (commands are recorded every frame, so switching takes effect next frame)
+RenderGraph &VulkanRenderer::getActiveRenderGraph(){
+    switch(postProcessMode){
+        case POST_PROCESS_NONE:         return directGraph;
+        case POST_PROCESS_OVERDRAW:     return overdrawGraph;
+        default:                        return postProcessGraph;
+    }
 }
 
 void VulkanRenderer::allocateDynamicBufferTransferSpace(){
@@ -1576,6 +2025,11 @@ void VulkanRenderer::createPushConstantRange(){
     pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;      // Shader stage push constant will go to
     pushConstantRange.offset = 0;                                   // Offset to given data to pass to push constant
     pushConstantRange.size = sizeof(Model);                         // Size of data being passed
+    
+    // Post process settings for second subpass
+    secondPushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    secondPushConstantRange.offset = 0;
+    secondPushConstantRange.size = sizeof(PostProcessSettings);
 }
 
 VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags, VkMemoryPropertyFlags propFlags, VkDeviceMemory *imageMemory){
@@ -1625,27 +2079,6 @@ VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat fo
     return image;
 }
 
-void VulkanRenderer::createDepthBufferImage(){
-    depthBufferImage.resize(swapchainImages.size());
-    depthBufferImageMemory.resize(swapchainImages.size());
-    depthBufferImageView.resize(swapchainImages.size());
-    // Get supported format for depth buffer
-    
-    // depthBufferFormat is set in createRenderPass() and used here
-    depthBufferFormat = chooseSupportedFormat(
-    {VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT},
-                                            VK_IMAGE_TILING_OPTIMAL,
-                                            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
-                                            );
-    for(size_t i=0; i<swapchainImages.size(); i++){
-    // Create depth buffer image
-    depthBufferImage[i] = createImage(swapchainExtent.width, swapchainExtent.height, depthBufferFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &depthBufferImageMemory[i]);
-    
-    // Create depth buffer image view
-    depthBufferImageView[i] = createImageView(depthBufferImage[i], depthBufferFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
-    }
-}
-
 VkFormat VulkanRenderer::chooseSupportedFormat(const std::vector<VkFormat> &formats, VkImageTiling tiling, VkFormatFeatureFlags featureFlags){
     // Loop through the options and find compatible one
     for(VkFormat format: formats){
@@ -1674,15 +2107,18 @@ stbi_uc* VulkanRenderer::loadTextureFile(std::string fileName, int *width, int *
     // Open stream from give file
     // std::ios::binary tells stream to read file as binary
     // std::ios::ate tell stream to start reading file from end of the file
+    loadProfiler.begin(LOAD_STAGE_FILE_CHECK);
     std::ifstream file(fullFilePath, std::ios::binary | std::ios::ate);
     
     // Check if file stream successfully opened
     if(!file.is_open()){
         throw std::runtime_error("Failed to open a file! ("+fullFilePath+")");
-    }else{
-        file.close();
     }
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.close();
+    loadProfiler.end(fileSize);
     
+    loadProfiler.begin(LOAD_STAGE_TEXTURE_DECODE);
     stbi_uc* image = stbi_load(fullFilePath.c_str(), width, height, &channels, STBI_rgb_alpha);
     
     if(!image){
@@ -1691,16 +2127,14 @@ stbi_uc* VulkanRenderer::loadTextureFile(std::string fileName, int *width, int *
     
     // Calculate image size using given and known data
     *imageSize = *width * *height * 4;
+    loadProfiler.end(*imageSize);
     
     return image;
 }
 
-int VulkanRenderer::createTextureImage(std::string fileName){
-    // Load image file
-    int width, height;
-    VkDeviceSize imageSize;
-    
-    stbi_uc* imageData = loadTextureFile(fileName, &width, &height, &imageSize);
+// imageData is loaded by loadTextureFile, freed once it is copied
+VkImage VulkanRenderer::createTextureImage(stbi_uc *imageData, int width, int height, VkDeviceSize imageSize, VkDeviceMemory *imageMemory){
+    loadProfiler.begin(LOAD_STAGE_UPLOAD);
     
     // Create staging buffer to hold loaded data, ready to copy to device
     VkBuffer imageStagingBuffer;
@@ -1731,24 +2165,56 @@ int VulkanRenderer::createTextureImage(std::string fileName){
     // Transition image to be shader readable for shader usage
     transitionImageLayout(mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool, texImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     
-    // Add texture data to vector for reference
-    textureImages.push_back(texImage);
-    textureImageMemory.push_back(texImageMemory);
-    
     // Destroy staging buffers
     vkDestroyBuffer(mainDevice.logicalDevice, imageStagingBuffer, nullptr);
     vkFreeMemory(mainDevice.logicalDevice, imageStagingBufferMemory, nullptr);
     
-    // Return index of new texture image
-    return textureImages.size() - 1;
+    loadProfiler.end(imageSize);
+    
+    *imageMemory = texImageMemory;
+    return texImage;
 }
 
 int VulkanRenderer::createTexture(std::string fileName){
-    // Create texture image and get it's location in an array
-    int textureImageLoc = createTextureImage(fileName);
+    int textureId = loadTexture(fileName);
+    if(sceneRecorder.isRecording()){
+        sceneRecorder.recordCreateTexture(fileName, textureId);
+    }
+    return textureId;
+}
+
+int VulkanRenderer::loadTexture(std::string fileName){
+    // Load image file
+    int width, height;
+    VkDeviceSize imageSize;
+    stbi_uc* imageData = loadTextureFile(fileName, &width, &height, &imageSize);
+    
+    return createTexture(imageData, width, height, imageSize);
+}
+
+int VulkanRenderer::createTexture(stbi_uc *imageData, int width, int height, VkDeviceSize imageSize){
+    // Create texture image
+    VkDeviceMemory texImageMemory;
+    VkImage texImage = createTextureImage(imageData, width, height, imageSize, &texImageMemory);
     
-    // Create Image View and add to list
-    VkImageView imageView = createImageView(textureImages[textureImageLoc], VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+    // Create Image View
+    VkImageView imageView = createImageView(texImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+    
+    // Reuse slot of a released texture if there is one (no frame uses its descriptor set any more)
+    if(!freeTextureSlots.empty()){
+        int textureId = freeTextureSlots.back();
+        freeTextureSlots.pop_back();
+        
+        textureImages[textureId] = texImage;
+        textureImageMemory[textureId] = texImageMemory;
+        textureImageView[textureId] = imageView;
+        writeTextureDescriptor(samplerDescriptorSets[textureId], imageView);
+        return textureId;
+    }
+    
+    // Add texture data to lists
+    textureImages.push_back(texImage);
+    textureImageMemory.push_back(texImageMemory);
     textureImageView.push_back(imageView);
     
     // Create Texture Descriptor
@@ -1758,6 +2224,56 @@ int VulkanRenderer::createTexture(std::string fileName){
     return descriptorLoc;
 }
 
+// Wait for GPU to finish everything submitted, then destroy all released models & textures (e.g. when loading without drawing)
+void VulkanRenderer::flushReleasedResources(){
+    vkDeviceWaitIdle(mainDevice.logicalDevice);
+    deletionQueue.flushAll();
+}
+
+// Texture from RGBA8 pixels generated at runtime
+int VulkanRenderer::createTexture(const std::vector<uint8_t> &pixels, int width, int height){
+    VkDeviceSize imageSize = static_cast<VkDeviceSize>(width) * height * 4;
+    if(pixels.size() < imageSize){
+        throw std::runtime_error("Not enough pixel data for texture!");
+    }
+    
+    // createTextureImage frees the data like an image loaded by stb_image
+    stbi_uc *imageData = static_cast<stbi_uc *>(malloc(imageSize));
+    memcpy(imageData, pixels.data(), imageSize);
+    int textureId = createTexture(imageData, width, height, imageSize);
+    
+    if(sceneRecorder.isRecording()){
+        sceneRecorder.recordCreateTexture(pixels, width, height, textureId);
+    }
+    return textureId;
+}
+
+void VulkanRenderer::releaseTexture(int textureId){
+    if(sceneRecorder.isRecording()){
+        sceneRecorder.recordReleaseTexture(textureId);
+    }
+    destroyTexture(textureId);
+}
+
+// Destroy texture once no frame in flight can sample it, its slot is then reused by createTexture
+void VulkanRenderer::destroyTexture(int textureId){
+    if(textureId <= 0 || textureId >= static_cast<int>(textureImages.size()) || textureImages[textureId] == VK_NULL_HANDLE){
+        return;                 // Texture 0 is the default texture, used by every mesh without one
+    }
+    
+    VkImage image = textureImages[textureId];
+    VkImageView imageView = textureImageView[textureId];
+    VkDeviceMemory imageMemory = textureImageMemory[textureId];
+    textureImages[textureId] = VK_NULL_HANDLE;
+    
+    deletionQueue.push(submittedFrameCount, [this, textureId, image, imageView, imageMemory](){
+        vkDestroyImageView(mainDevice.logicalDevice, imageView, nullptr);
+        vkDestroyImage(mainDevice.logicalDevice, image, nullptr);
+        vkFreeMemory(mainDevice.logicalDevice, imageMemory, nullptr);
+        freeTextureSlots.push_back(textureId);
+    });
+}
+
 void VulkanRenderer::createTextureSampler(){
     // Sampler creation info
     VkSamplerCreateInfo samplerCreateInfo = {};
@@ -1783,72 +2299,74 @@ void VulkanRenderer::createTextureSampler(){
 }
 
 int VulkanRenderer::createTextureDescriptor(VkImageView textureImage){
-    VkDescriptorSet descriptorSet;
+    // Allocate Descriptor Set (a new pool is added if current one is full)
+    VkDescriptorSet descriptorSet = descriptorAllocator.allocate(samplerSetLayout);
     
-    // Descriptor Set Allocation Info
-    VkDescriptorSetAllocateInfo setAllocInfo = {};
-    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    setAllocInfo.descriptorPool = samplerDescriptorPool;
-    setAllocInfo.descriptorSetCount = 1;
-    setAllocInfo.pSetLayouts = &samplerSetLayout;
+    // Update new descriptor set
+    writeTextureDescriptor(descriptorSet, textureImage);
     
-    // Allocate Descriptor Sets
-    VkResult result = vkAllocateDescriptorSets(mainDevice.logicalDevice, &setAllocInfo, &descriptorSet);
-    if(result != VK_SUCCESS){
-        throw std::runtime_error("Failed to allocate Texture Descriptor Set!");
-    }
+    // Add descriptor set to list
+    samplerDescriptorSets.push_back(descriptorSet);
     
+    // Return descriptor set location
+    return samplerDescriptorSets.size() - 1;
+}
+
+void VulkanRenderer::writeTextureDescriptor(VkDescriptorSet descriptorSet, VkImageView textureImage){
     // Texture Image info
     VkDescriptorImageInfo imageInfo = {};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;       // Image layout when use
     imageInfo.imageView = textureImage;                                     // Image to bind to set
     imageInfo.sampler = textureSampler;                                     // Sampler to use for set
     
-    
-    // Descriptor Write Info
-    VkWriteDescriptorSet descriptorWrite = {};
-    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = descriptorSet;
-    descriptorWrite.dstBinding = 0;
-    descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.pImageInfo = &imageInfo;
-    
-    // Update new descriptor set
-    vkUpdateDescriptorSets(mainDevice.logicalDevice, 1, &descriptorWrite, 0, nullptr);
-    
-    // Add descriptor set to list
-    samplerDescriptorSets.push_back(descriptorSet);
-    
-    // Return descriptor set location
-    return samplerDescriptorSets.size() - 1;
+    descriptorUpdater.update(descriptorSet, samplerDescriptorTemplate, &imageInfo);
+}
+
+ModelHandle VulkanRenderer::createMeshModel(std::string modelFile, unsigned int importFlags){
+    ModelHandle model = importMeshModel(modelFile, importFlags);
+    if(sceneRecorder.isRecording()){
+        sceneRecorder.recordCreateModel(modelFile, importFlags, model);
+    }
+    return model;
 }
 
-int VulkanRenderer::createMeshModel(std::string modelFile){
+ModelHandle VulkanRenderer::importMeshModel(std::string modelFile, unsigned int importFlags){
+    // If this file was already imported with the same flags, share its meshes instead of importing again
+    std::string cacheKey = ModelCache::makeKey(modelFile, importFlags);
+    std::vector<Mesh> cachedMeshes;
+    if(modelCache.acquire(cacheKey, &cachedMeshes)){
+        return addModel(MeshModel(cachedMeshes, cacheKey));
+    }
+    
     std::string fullFilePath = std::string(getcwd(NULL, 0))+"/Models/" + modelFile;
     // Validate if file exists
     // Open stream from give file
     // std::ios::binary tells stream to read file as binary
     // std::ios::ate tell stream to start reading file from end of the file
+    loadProfiler.begin(LOAD_STAGE_FILE_CHECK);
     std::ifstream file(fullFilePath, std::ios::binary | std::ios::ate);
     
     // Check if file stream successfully opened
     if(!file.is_open()){
         throw std::runtime_error("Failed to open a file! ("+fullFilePath+")");
-    }else{
-        file.close();
     }
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.close();
+    loadProfiler.end(fileSize);
     
     // Import model scene
+    loadProfiler.begin(LOAD_STAGE_IMPORT);
     Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(fullFilePath, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices);
+    const aiScene *scene = importer.ReadFile(fullFilePath, importFlags);
     if(!scene){
         throw std::runtime_error("Failed to load model! ("+ fullFilePath +")");
     }
+    loadProfiler.end(fileSize);
     
     // Get vector of all materials with 1:1 ID placement
+    loadProfiler.begin(LOAD_STAGE_MATERIALS);
     std::vector<std::string> textureNames = MeshModel::LoadMaterials(scene);
+    loadProfiler.end();
     
     // Conversion from the materials list IDs to our Descriptor Array IDs
     std::vector<int> matToTex(textureNames.size());
@@ -1860,96 +2378,151 @@ int VulkanRenderer::createMeshModel(std::string modelFile){
             matToTex[i] = 0;
         }else{
             // Otherwise, create texture and set value to index of new texture
-            matToTex[i] = createTexture(textureNames[i]);
+            matToTex[i] = loadTexture(textureNames[i]);
         }
     }
     
     // Load in all our meshes
-    std::vector<Mesh> modelMeshes = MeshModel::LoadNode(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool, scene->mRootNode, scene, matToTex);
+    std::vector<Mesh> modelMeshes = MeshModel::LoadNode(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool, scene->mRootNode, scene, matToTex, &loadProfiler);
+    
+    // Add meshes to cache so later loads of this file can share them
+    modelCache.insert(cacheKey, modelMeshes);
     
     // Create mesh model and add to list
-    MeshModel meshModel = MeshModel(modelMeshes);
-    modelList.push_back(meshModel);
-    return modelList.size() - 1;
+    MeshModel meshModel = MeshModel(modelMeshes, cacheKey);
+    return addModel(meshModel);
+}
+
+// Model from geometry generated at runtime, later models with the same cache key share its meshes
+// Textures used by meshData stay owned by the caller (they are not released with the model)
+ModelHandle VulkanRenderer::createMeshModel(const std::vector<MeshData> &meshData, std::string cacheKey){
+    ModelHandle model = buildMeshModel(meshData, cacheKey);
+    if(sceneRecorder.isRecording()){
+        sceneRecorder.recordCreateModel(meshData, cacheKey, model);
+    }
+    return model;
+}
+
+ModelHandle VulkanRenderer::buildMeshModel(const std::vector<MeshData> &meshData, std::string cacheKey){
+    std::vector<Mesh> cachedMeshes;
+    if(modelCache.acquire(cacheKey, &cachedMeshes)){
+        return addModel(MeshModel(cachedMeshes, cacheKey));
+    }
+    
+    std::vector<Mesh> modelMeshes;
+    for(const MeshData &data: meshData){
+        std::vector<Vertex> vertices = data.vertices;
+        std::vector<uint32_t> indices = data.indices;
+        loadProfiler.begin(LOAD_STAGE_MESHLET_BUILD);
+        std::vector<Meshlet> meshlets = MeshletBuilder::buildMeshlets(vertices, &indices);
+        loadProfiler.end(meshlets.size() * sizeof(Meshlet));
+        loadProfiler.begin(LOAD_STAGE_LOD_GENERATION);
+        std::vector<MeshLod> lods = MeshSimplifier::buildLodChain(vertices, &indices);
+        loadProfiler.end(indices.size() * sizeof(uint32_t));
+        loadProfiler.begin(LOAD_STAGE_UPLOAD);
+        modelMeshes.push_back(Mesh(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool, &vertices, &indices, lods, meshlets, data.textureId));
+        loadProfiler.end(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t));
+    }
+    
+    modelCache.insert(cacheKey, modelMeshes, false);
+    return addModel(MeshModel(modelMeshes, cacheKey));
 }
 
-void VulkanRenderer::createColorBufferImage(){
-    // Resize supported format for color attachment
-    colorBufferImage.resize(swapchainImages.size());
-    colorBufferImageMemory.resize(swapchainImages.size());
-    colorBufferImageView.resize(swapchainImages.size());
+// Put model in a free slot (or a new one) and hand out a handle for it
+ModelHandle VulkanRenderer::addModel(const MeshModel &model){
+    ModelHandle handle = {};
+    if(!freeModelSlots.empty()){
+        handle.index = freeModelSlots.back();
+        freeModelSlots.pop_back();
+        modelList[handle.index] = model;
+    }else{
+        handle.index = static_cast<uint32_t>(modelList.size());
+        modelList.push_back(model);
+        modelGenerations.push_back(0);
+        modelAlive.push_back(false);
+    }
+    handle.generation = modelGenerations[handle.index];
+    modelAlive[handle.index] = true;
+    renderListChanged = true;
+    return handle;
+}
+
+// Remove model from scene; if no other model shares its meshes, buffers & textures are destroyed once no frame in flight uses them
+void VulkanRenderer::destroyMeshModel(ModelHandle model){
+    if(!isModelValid(model)){
+        return;
+    }
+    if(sceneRecorder.isRecording()){
+        sceneRecorder.recordDestroyModel(model);
+    }
     
-    // Get supported format for color attachment
-    VkFormat colorFormat = chooseSupportedFormat({ VK_FORMAT_R8G8B8A8_UNORM}, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    modelAlive[model.index] = false;
+    modelGenerations[model.index]++;
+    freeModelSlots.push_back(model.index);
+    renderListChanged = true;
     
-    for(size_t i=0; i<swapchainImages.size(); i++){
-        // create color buffer image
-        colorBufferImage[i] = createImage(swapchainExtent.width, swapchainExtent.height, colorFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &colorBufferImageMemory[i]);
-        
-        // Create color buffer image view
-        colorBufferImageView[i] = createImageView(colorBufferImage[i], colorFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+    MeshModel &meshModel = modelList[model.index];
+    bool ownsTextures = false;
+    if(!modelCache.release(meshModel.getCacheKey(), &ownsTextures)){
+        return;
+    }
+    
+    // Textures of an imported model were created for this model file only (texture 0 is the shared default)
+    if(ownsTextures){
+        std::set<int> textureIds;
+        for(size_t i=0; i<meshModel.getMeshCount(); i++){
+            textureIds.insert(meshModel.getMesh(i)->getTexId());
+        }
+        for(int textureId: textureIds){
+            destroyTexture(textureId);
+        }
     }
+    
+    deletionQueue.push(submittedFrameCount, [meshModel]() mutable {
+        meshModel.destroyMeshModel();
+    });
 }
 
+bool VulkanRenderer::isModelValid(ModelHandle model){
+    return model.index < modelList.size() && modelAlive[model.index] && modelGenerations[model.index] == model.generation;
+}
 
 void VulkanRenderer::createInputDescriptorSets(){
-    // Resize array to hold descriptor set for each swap chain image
-    inputDescriptorSets.resize(swapchainImages.size());
-    
-    // Fill array of layouts ready for set creation
-    std::vector<VkDescriptorSetLayout> setLayouts(swapchainImages.size(), inputSetLayout);
-    
-    // Input Attachment Descriptor Set Allocation Info
-    VkDescriptorSetAllocateInfo setAllocInfo = {};
-    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    setAllocInfo.descriptorPool = inputDescriptorPool;
-    setAllocInfo.descriptorSetCount = static_cast<uint32_t>(swapchainImages.size());
-    setAllocInfo.pSetLayouts = setLayouts.data();
-    
-    // Allocate Descriptor Set
-    VkResult result = vkAllocateDescriptorSets(mainDevice.logicalDevice, &setAllocInfo, inputDescriptorSets.data());
-    if(result != VK_SUCCESS){
-        throw std::runtime_error("Faied to allocate Input Attachment Descriptor Set!");
+    // Input attachment descriptor set for each swap chain image
+    inputDescriptorSets.clear();
+    for(size_t i=0; i<swapchainImages.size(); i++){
+        inputDescriptorSets.push_back(descriptorAllocator.allocate(inputSetLayout));
     }
     
     // Update each descriptor set with input attachment
     for(size_t i=0; i<swapchainImages.size(); i++){
-        // Color Attachment Descriptor
-        VkDescriptorImageInfo colorAttachmentDescriptor = {};
-        colorAttachmentDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        colorAttachmentDescriptor.imageView = colorBufferImageView[i];
-        colorAttachmentDescriptor.sampler = VK_NULL_HANDLE;
+        // Color & Depth Attachment Descriptors (bindings 0 & 1 of inputDescriptorTemplate)
+        std::array<VkDescriptorImageInfo, 2> attachmentDescriptors = {};
+        attachmentDescriptors[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        attachmentDescriptors[0].imageView = postProcessGraph.getImageView(colorAttachment, static_cast<uint32_t>(i));
+        attachmentDescriptors[0].sampler = VK_NULL_HANDLE;
         
-        // Color Attachment Descriptor Write
-        VkWriteDescriptorSet colorWrite = {};
-        colorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        colorWrite.dstSet = inputDescriptorSets[i];
-        colorWrite.dstBinding = 0;
-        colorWrite.dstArrayElement = 0;
-        colorWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-        colorWrite.descriptorCount = 1;
-        colorWrite.pImageInfo = &colorAttachmentDescriptor;
+        attachmentDescriptors[1].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        attachmentDescriptors[1].imageView = postProcessGraph.getImageView(depthAttachment, static_cast<uint32_t>(i));
+        attachmentDescriptors[1].sampler = VK_NULL_HANDLE;
         
-        // Depth Attachment Descriptor
-        VkDescriptorImageInfo depthAttachmentDescriptor = {};
-        depthAttachmentDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        depthAttachmentDescriptor.imageView = depthBufferImageView[i];
-        depthAttachmentDescriptor.sampler = VK_NULL_HANDLE;
-        
-        // Depth Attachment Descriptor Write
-        VkWriteDescriptorSet depthWrite = {};
-        depthWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        depthWrite.dstSet = inputDescriptorSets[i];
-        depthWrite.dstBinding = 1;
-        depthWrite.dstArrayElement = 0;
-        depthWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-        depthWrite.descriptorCount = 1;
-        depthWrite.pImageInfo = &depthAttachmentDescriptor;
+        // Update Descriptor Sets
+        descriptorUpdater.update(inputDescriptorSets[i], inputDescriptorTemplate, attachmentDescriptors.data());
+    }
+    
+    // Same layout for overdraw heatmap: fragment count in place of color
+    overdrawInputDescriptorSets.clear();
+    for(size_t i=0; i<swapchainImages.size(); i++){
+        std::array<VkDescriptorImageInfo, 2> attachmentDescriptors = {};
+        attachmentDescriptors[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        attachmentDescriptors[0].imageView = overdrawCountImageView;
+        attachmentDescriptors[0].sampler = VK_NULL_HANDLE;
         
-        // List of input descriptor set writes
-        std::vector<VkWriteDescriptorSet> setWrites = {colorWrite, depthWrite};
+        attachmentDescriptors[1].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        attachmentDescriptors[1].imageView = overdrawGraph.getImageView(overdrawDepthAttachment, static_cast<uint32_t>(i));
+        attachmentDescriptors[1].sampler = VK_NULL_HANDLE;
         
-        // Update Descriptor Sets
-        vkUpdateDescriptorSets(mainDevice.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+        overdrawInputDescriptorSets.push_back(descriptorAllocator.allocate(inputSetLayout));
+        descriptorUpdater.update(overdrawInputDescriptorSets.back(), inputDescriptorTemplate, attachmentDescriptors.data());
     }
 }
@@ -31,6 +31,19 @@
 #include "Utilities.h"
 #include "Mesh.hpp"
 #include "MeshModel.hpp"
+#include "ModelCache.hpp"
+#include "PipelineLibrary.hpp"
+#include "RenderGraph.hpp"
+#include "DescriptorAllocator.hpp"
+#include "DescriptorUpdater.hpp"
+#include "DrawList.hpp"
+#include "RenderList.hpp"
+#include "DeletionQueue.hpp"
+#include "TaskGraph.hpp"
+#include "LoadProfiler.hpp"
+#include "SceneRecording.hpp"
+#include "PassQueries.hpp"
+#include "HiZBuffer.hpp"
 
 #include <unistd.h>
 
@@ -38,8 +51,32 @@ class VulkanRenderer{
 public:
     VulkanRenderer();
     int init(GLFWwindow *window);
-    int createMeshModel(std::string modelFile);
-    void updateModel(int modelId, glm::mat4 newModel);
+    ModelHandle createMeshModel(std::string modelFile, unsigned int importFlags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices);
+    ModelHandle createMeshModel(const std::vector<MeshData> &meshData, std::string cacheKey);
+    int createTexture(std::string fileName);
+    int createTexture(const std::vector<uint8_t> &pixels, int width, int height);
+    void updateModel(ModelHandle model, glm::mat4 newModel);
+    void destroyMeshModel(ModelHandle model);
+    bool isModelValid(ModelHandle model);
+    void releaseTexture(int textureId);
+    
+    void flushReleasedResources();
+    
+    void setCamera(glm::mat4 view);
+    void startRecording(const std::string &fileName);
+    void stopRecording();
+    
+    FrameStats getFrameStats();
+    PassStats getPassStats(QueryPass pass);
+    OverdrawHistogram getOverdrawHistogram();
+    LoadProfiler &getLoadProfiler();
+    void setPostProcessMode(PostProcessMode mode);
+    void setTextureSampling(bool enabled);
+    void setDrawOrder(DrawOrder order);
+    void setDepthPrepass(bool enabled);
+    void setOcclusionCulling(bool enabled);
+    void setLodSelection(bool enabled);
+    void setMeshletCulling(bool enabled);
     void draw();
     void cleanUp();
     ~VulkanRenderer();
@@ -48,9 +85,35 @@ private:
     GLFWwindow *window;
     
     int currentFrame = 0;
+    uint64_t submittedFrameCount = 0;
+    std::chrono::steady_clock::time_point initStartTime;    // For time to first frame
+    FrameStats frameStats = {};
+    LoadProfiler loadProfiler;                  // Time, bytes & allocations of model/texture loading stages
+    SceneRecorder sceneRecorder;                // Logs public scene calls while recording
+    
+    // - GPU timing (timestamp at start & end of each frame's commands)
+    bool timestampsSupported = false;
+    float timestampPeriod = 0.0f;               // Nanoseconds per timestamp tick
+    VkQueryPool timestampQueryPool = VK_NULL_HANDLE;    // 2 queries per frame in flight
+    
+    // - Per pass counters (vertices, shader invocations, samples passed)
+    bool pipelineStatisticsSupported = false;
+    bool preciseOcclusionSupported = false;
+    PassQueries passQueries;
+    PassStats scenePassStats = {};              // Last reported, to print only on change
+    
+    // - Indirect draws (draws of one packet issued by one vkCmdDrawIndexedIndirect with multiDrawIndirect)
+    bool multiDrawIndirectSupported = false;
+    uint32_t maxDrawIndirectCount = 1;
     
     // Scene Objects
-    std::vector<MeshModel> modelList;
+    std::vector<MeshModel> modelList;           // Slots addressed by ModelHandle::index
+    std::vector<uint32_t> modelGenerations;     // Bumped when slot's model is destroyed, so old handles stop matching
+    std::vector<bool> modelAlive;
+    std::vector<uint32_t> freeModelSlots;
+    std::vector<int> freeTextureSlots;          // Released textures whose slot (and descriptor set) can be reused
+    DeletionQueue deletionQueue;                // Released resources, destroyed once frames using them are complete
+    ModelCache modelCache;          // Imported models shared between createMeshModel calls for the same file
     
     // Scene settings
     struct UBOViewProjection{
@@ -62,6 +125,7 @@ private:
     // Vulkan components
     // - Main
     VkInstance instance;
+    bool physicalDeviceProperties2Enabled = false;  // Instance extension needed by VK_KHR_push_descriptor
     struct{
         VkPhysicalDevice physicalDevice;
         VkDevice logicalDevice;
@@ -72,18 +136,48 @@ private:
     VkSwapchainKHR swapchain;
     
     std::vector<SwapchainImage> swapchainImages;
-    std::vector<VkFramebuffer> swapchainFramebuffers;
     std::vector<VkCommandBuffer> commandBuffers;
     
-    std::vector<VkImage> colorBufferImage;
-    std::vector<VkDeviceMemory> colorBufferImageMemory;
-    std::vector<VkImageView> colorBufferImageView;
-    
-    std::vector<VkImage> depthBufferImage;
-    std::vector<VkDeviceMemory> depthBufferImageMemory;
-    std::vector<VkImageView> depthBufferImageView;
+    // - Render graph (render passes, framebuffers & attachment images)
+    // Two render paths, chosen by postProcessMode:
+    // post process graph draws the scene offscreen and runs second pass to the swapchain image,
+    // direct graph draws the scene straight to the swapchain image when there is no effect to apply
+    RenderGraph postProcessGraph;
+    RenderResource swapchainAttachment;
+    RenderResource colorAttachment;             // Scene color, input to second pass
+    RenderResource depthAttachment;             // Scene depth, input to second pass
+    uint32_t scenePass;
+    uint32_t postProcessPass;
+    RenderGraph directGraph;
+    uint32_t directScenePass;
+    // Overdraw graph (POST_PROCESS_OVERDRAW) counts fragments shaded per pixel into a float image,
+    // second pass shows the counts as a heatmap and the image is copied to host for a histogram
+    RenderGraph overdrawGraph;
+    RenderResource overdrawDepthAttachment;
+    uint32_t overdrawScenePass;
+    uint32_t overdrawHeatmapPass;
+    VkImage overdrawCountImage;                 // Owned by renderer (external to graph) so it can be copied after the graph
+    VkDeviceMemory overdrawCountImageMemory;
+    VkImageView overdrawCountImageView;
+    std::vector<VkBuffer> overdrawReadbackBuffers;          // Count image copy of each frame in flight
+    std::vector<VkDeviceMemory> overdrawReadbackBufferMemory;
+    std::vector<bool> overdrawReadbackPending;              // Copy recorded for frame, not read yet
+    OverdrawHistogram overdrawHistogram = {};
     
     VkFormat depthBufferFormat;
+    VkImage sceneDepthImage;                    // Depth attachment of every graph, owned by renderer so Hi-Z can read it after the graph
+    VkDeviceMemory sceneDepthImageMemory;
+    VkImageView sceneDepthImageView;
+    
+    // - Occlusion culling
+    // Depth of each frame is reduced to a Hi-Z pyramid after the graph, meshes hidden in the last finished frame's pyramid
+    // aren't drawn (hidden meshes that become visible show up at most MAX_FRAME_DRAWS frames late)
+    HiZBuffer hizBuffer;
+    VkDescriptorSetLayout hizSetLayout;
+    DescriptorTemplate hizDescriptorTemplate;
+    VkPipelineLayout hizPipelineLayout;
+    VkPipeline hizPipeline;
+    bool occlusionCulling = true;
     
     VkSampler textureSampler;
     
@@ -92,13 +186,17 @@ private:
     VkDescriptorSetLayout samplerSetLayout;
     VkDescriptorSetLayout inputSetLayout;
     VkPushConstantRange pushConstantRange;
-    
-    VkDescriptorPool descriptorPool;
-    VkDescriptorPool samplerDescriptorPool;
-    VkDescriptorPool inputDescriptorPool;
-    std::vector<VkDescriptorSet> descriptorSets;
+    VkPushConstantRange secondPushConstantRange;
+    
+    DescriptorAllocator descriptorAllocator;                        // Sets that live as long as the renderer
+    std::vector<DescriptorAllocator> frameDescriptorAllocators;     // Sets that live for one frame, reset once frame's fence signals
+    DescriptorUpdater descriptorUpdater;                            // All descriptor writes go through update templates
+    DescriptorTemplate vpDescriptorTemplate;                        // Pushed every frame if device supports push descriptors
+    DescriptorTemplate samplerDescriptorTemplate;
+    DescriptorTemplate inputDescriptorTemplate;
     std::vector<VkDescriptorSet> samplerDescriptorSets;
     std::vector<VkDescriptorSet> inputDescriptorSets;
+    std::vector<VkDescriptorSet> overdrawInputDescriptorSets;      // Count & depth of overdraw graph
     
     std::vector<VkBuffer> vpUniformBuffer;
     std::vector<VkDeviceMemory> vpUniformBufferMemory;
@@ -121,8 +219,39 @@ private:
     VkPipelineLayout pipelineLayout;
     VkPipeline secondPipeline;
     VkPipelineLayout secondPipelineLayout;
-    
-    VkRenderPass renderpass;
+    VkPipelineCache pipelineCache;
+    std::string pipelineCachePath;          // Resolved once when cache is created, saved back to on destruction
+    PipelineLibrary pipelineLibrary;       // Owns pipelines & shader modules, one per unique description
+    PipelineDescription mainPipelineDescription;
+    PipelineDescription secondPipelineDescription;
+    PipelineDescription overdrawPipelineDescription;
+    PipelineDescription depthPrepassPipelineDescription;
+    VkPipeline depthPrepassPipeline;
+    
+    // - Draws
+    RenderList renderList;                      // Every mesh of modelList, rebuilt when models are added
+    bool renderListChanged = true;
+    std::vector<glm::mat4> modelTransforms;     // Model matrix of each model (pushed by drawList)
+    std::vector<float> meshDepths;              // Camera distance of each render list mesh this frame, for sorting
+    std::vector<bool> meshCulled;               // Render list meshes hidden in the Hi-Z pyramid this frame
+    std::vector<uint32_t> meshLods;             // Level of detail drawn for each render list mesh this frame (index into renderList.lods)
+    std::vector<uint32_t> meshMeshletDraws;     // First indirect draw of visible meshlets of each render list mesh (UINT32_MAX: direct draw)
+    std::vector<uint32_t> meshMeshletDrawCounts;
+    std::vector<uint32_t> meshMeshletIndexCounts;   // Indices of visible meshlets
+    uint32_t culledMeshletCount = 0;            // This frame
+    std::vector<VkDrawIndexedIndirectCommand> meshletDrawCommands;  // Built on host, copied to frame's buffer in one go
+    std::vector<VkBuffer> meshletDrawBuffers;   // VkDrawIndexedIndirectCommands of each frame in flight (host visible)
+    std::vector<VkDeviceMemory> meshletDrawBufferMemory;
+    DrawList drawList;                          // Scene draws of current frame, sorted by state
+    DrawList depthPrepassList;                  // Depth only draws before drawList (when depthPrepass is on)
+    DrawListStats drawStats = {};               // Stats last printed
+    
+    // Pipeline variants in use (chosen with specialization constants)
+    PostProcessMode postProcessMode = POST_PROCESS_DEPTH_SPLIT;
+    bool textureSampling = true;
+    bool depthPrepass = false;                  // Lay down depth first, then shade with EQUAL test (each pixel shaded once)
+    bool lodSelection = true;                   // Draw distant meshes with simplified index lists (full detail otherwise)
+    bool meshletCulling = true;                 // Draw only meshlets in view & facing the camera of full detail meshes
     
     // - Pools
     VkCommandPool graphicsCommandPool;
@@ -142,30 +271,48 @@ private:
     void createLogicalDevice();
     void createSurface();
     void createSwapChain();
-    void createRenderPass();
+    void createRenderGraphs();
     void createDescriptorSetLayout();
     void createPushConstantRange();
+    void createPipelineCache();
     void createGraphicsPipeline();
-    void createColorBufferImage();
-    void createDepthBufferImage();
-    void createFramebuffers();
+    void createDescriptorTemplates();
     void createCommandPool();
     void createCommandBuffers();
     void createSynchronization();
+    void createTimestampQueryPool();
+    void readFrameTimestamps();
+    void createPassQueries();
+    void readPassQueries();
+    void createOverdrawReadback();
+    void readOverdrawHistogram();
+    void createHiZBuffer();
+    void createMeshletDrawBuffers();
     void createTextureSampler();
     
     void createUniformBuffers();
-    void createDescriptorPool();
-    void createDescriptorSets();
+    void createDescriptorAllocators();
     void createInputDescriptorSets();
     
     void updateUniformBuffers(uint32_t imageIndex);
+    void updatePipelines();
+    void updateRenderList();
+    void cullMeshlets();
+    
+    // - Getter functions
+    RenderGraph &getActiveRenderGraph();
+    
+    // - Save functions
+    void savePipelineCache();
     
     // - Allocate functions
     void allocateDynamicBufferTransferSpace();
     
     // - Record functions
     void recordCommands(uint32_t currentImage);
+    void recordScenePass(VkCommandBuffer commandBuffer, uint32_t currentImage);
+    void recordPostProcessPass(VkCommandBuffer commandBuffer, uint32_t currentImage);
+    void recordOverdrawReadback(VkCommandBuffer commandBuffer);
     
     // - Get functions
     void getPhysicalDevice();
@@ -174,6 +321,7 @@ private:
     // -- Checker functions
     bool checkInstanceExtensionsSupport(std::vector<const char*> *checkExtensions);
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool checkOptionalDeviceExtensionSupport(VkPhysicalDevice device, const char *extensionName);
     bool doCheckDeviceSuitable(VkPhysicalDevice device);
     
     // -- Getter functions
@@ -189,11 +337,16 @@ private:
     // -- Create functions
     VkImage createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags, VkMemoryPropertyFlags propFlags, VkDeviceMemory *imageMemory);
     VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
-    VkShaderModule createShaderModule(const std::vector<char> &code);
     
-    int createTextureImage(std::string fileName);
-    int createTexture(std::string fileName);
+    VkImage createTextureImage(stbi_uc *imageData, int width, int height, VkDeviceSize imageSize, VkDeviceMemory *imageMemory);
+    int loadTexture(std::string fileName);
+    void destroyTexture(int textureId);
+    int createTexture(stbi_uc *imageData, int width, int height, VkDeviceSize imageSize);
     int createTextureDescriptor(VkImageView textureImage);
+    void writeTextureDescriptor(VkDescriptorSet descriptorSet, VkImageView textureImage);
+    ModelHandle addModel(const MeshModel &model);
+    ModelHandle importMeshModel(std::string modelFile, unsigned int importFlags);
+    ModelHandle buildMeshModel(const std::vector<MeshData> &meshData, std::string cacheKey);
     
     // -- Loader Functions
     stbi_uc* loadTextureFile(std::string fileName, int *width, int *height, VkDeviceSize *imageSize);
@@ -42,35 +42,163 @@ int initWindow(std::string wName="Vulkan", const int width=800, const int height
     return EXIT_SUCCESS;
 }
 
-int main() {
-    // create window
-    initWindow("Vulkan", 1366, 768);
+// Command line options
+struct AppOptions{
+    std::string recordFile;         // --record FILE: log scene calls & frames
+    std::string replayFile;         // --replay FILE: draw a recorded log instead of the demo scene
+    std::string frameTimesFile;     // --frame-times FILE: CSV of per-frame CPU/GPU time (to compare builds frame by frame)
+    bool fixedTimestep = false;     // --fixed-timestep: animate by FIXED_TIMESTEP per frame instead of wall clock
+    bool overdraw = false;          // --overdraw: show overdraw heatmap, print histogram of last frame on exit
+    bool depthPrepass = false;      // --depth-prepass: depth only pass before shading
+    bool occlusionCulling = true;   // --no-occlusion-culling: draw meshes hidden in last frame's Hi-Z pyramid too
+    bool lodSelection = true;       // --no-lod: always draw full detail meshes
+    bool meshletCulling = true;     // --no-meshlet-culling: draw every meshlet of full detail meshes
+};
+
+const float FIXED_TIMESTEP = 1.0f / 60.0f;
 
-    float angle = 0.0f;
-    float deltaTime = 0.0f;
-    float lastTime = 0.0f;
+AppOptions parseOptions(int argc, char **argv){
+    AppOptions options;
+    for(int i=1; i<argc; i++){
+        std::string argument = argv[i];
+        if(argument == "--fixed-timestep"){
+            options.fixedTimestep = true;
+        }else if(argument == "--overdraw"){
+            options.overdraw = true;
+        }else if(argument == "--depth-prepass"){
+            options.depthPrepass = true;
+        }else if(argument == "--no-occlusion-culling"){
+            options.occlusionCulling = false;
+        }else if(argument == "--no-lod"){
+            options.lodSelection = false;
+        }else if(argument == "--no-meshlet-culling"){
+            options.meshletCulling = false;
+        }else if(i + 1 >= argc){
+            throw std::runtime_error("Missing value for " + argument + "!");
+        }else if(argument == "--record"){
+            options.recordFile = argv[++i];
+        }else if(argument == "--replay"){
+            options.replayFile = argv[++i];
+        }else if(argument == "--frame-times"){
+            options.frameTimesFile = argv[++i];
+        }else{
+            throw std::runtime_error("Unknown option " + argument + "!");
+        }
+    }
+    return options;
+}
+
+// Pixels per number of fragments shaded, with a bar scaled to the largest bucket
+void printOverdrawHistogram(const OverdrawHistogram &histogram){
+    if(!histogram.valid){
+        printf(">>> No overdraw histogram (no frame finished yet)\n");
+        return;
+    }
+    
+    uint32_t largest = *std::max_element(histogram.pixels, histogram.pixels + OVERDRAW_HISTOGRAM_SIZE);
+    printf(">>> Overdraw: %llu fragments, %.2f per covered pixel, at most %u on one pixel\n",
+           (unsigned long long) histogram.fragmentCount, histogram.average, histogram.maxCount);
+    for(int i=0; i<OVERDRAW_HISTOGRAM_SIZE; i++){
+        int barLength = largest > 0 ? static_cast<int>(40.0 * histogram.pixels[i] / largest + 0.5) : 0;
+        printf("    %2d%s %9u %s\n", i, i == OVERDRAW_HISTOGRAM_SIZE - 1 ? "+" : " ", histogram.pixels[i], std::string(barLength, '#').c_str());
+    }
+}
+
+int main(int argc, char **argv) {
+    AppOptions options;
+    try{
+        options = parseOptions(argc, argv);
+    }catch(const std::runtime_error &e){
+        printf("ERROR: %s\n", e.what());
+        printf("Usage: VulkanTesting [--record FILE] [--replay FILE] [--frame-times FILE] [--fixed-timestep] [--overdraw] [--depth-prepass] [--no-occlusion-culling] [--no-lod] [--no-meshlet-culling]\n");
+        return EXIT_FAILURE;
+    }
+    
+    // create window
+    if(initWindow("Vulkan", 1366, 768) == EXIT_FAILURE){
+        return EXIT_FAILURE;
+    }
+    
     char* dir = getcwd(NULL, 0);
     printf("Current directory path - %s\n", dir);
-    int helicopter = vulkanRenderer.createMeshModel("FA18f/FA-18F.obj");
     
-    // game loop
-    while(!glfwWindowShouldClose(window)){
-        glfwPollEvents();
-        
-        float now = glfwGetTime();
-        deltaTime = now - lastTime;
-        lastTime = now;
-        
-        angle += 10.0f * deltaTime;
-        if(angle > 360.0f){
-            angle -= 360.0f;
+    std::ofstream frameTimes;
+    if(!options.frameTimesFile.empty()){
+        frameTimes.open(options.frameTimesFile, std::ios::trunc);
+        frameTimes << "frame,cpu_ms,gpu_ms,draws,triangles\n";
+    }
+    
+    try{
+        if(options.overdraw){
+            vulkanRenderer.setPostProcessMode(POST_PROCESS_OVERDRAW);
+        }
+        vulkanRenderer.setDepthPrepass(options.depthPrepass);
+        vulkanRenderer.setOcclusionCulling(options.occlusionCulling);
+        vulkanRenderer.setLodSelection(options.lodSelection);
+        vulkanRenderer.setMeshletCulling(options.meshletCulling);
+        if(!options.recordFile.empty()){
+            vulkanRenderer.startRecording(options.recordFile);
         }
         
-        glm::mat4 testMat = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
-        //testMat = glm::rotate(testMat, glm::radians(10.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        vulkanRenderer.updateModel(helicopter, testMat);
+        if(!options.replayFile.empty()){
+            // Replay: one recorded frame per loop iteration, as fast as the renderer allows
+            SceneReplayer replayer;
+            replayer.open(options.replayFile);
+            while(!glfwWindowShouldClose(window)){
+                glfwPollEvents();
+                if(!replayer.replayFrame(vulkanRenderer)){
+                    break;
+                }
+                if(frameTimes.is_open()){
+                    FrameStats stats = vulkanRenderer.getFrameStats();
+                    frameTimes << replayer.getFrameCount() - 1 << "," << stats.cpuTime << "," << (stats.gpuTimeValid ? stats.gpuTime : 0.0) << "," << stats.drawCount << "," << stats.triangleCount << "\n";
+                }
+            }
+            printf(">>> Replayed %u frames\n", replayer.getFrameCount());
+        }else{
+            float angle = 0.0f;
+            float deltaTime = 0.0f;
+            float lastTime = 0.0f;
+            ModelHandle helicopter = vulkanRenderer.createMeshModel("FA18f/FA-18F.obj");
+            uint32_t frame = 0;
+            
+            // game loop
+            while(!glfwWindowShouldClose(window)){
+                glfwPollEvents();
+                
+                if(options.fixedTimestep){
+                    deltaTime = FIXED_TIMESTEP;
+                }else{
+                    float now = glfwGetTime();
+                    deltaTime = now - lastTime;
+                    lastTime = now;
+                }
+                
+                angle += 10.0f * deltaTime;
+                if(angle > 360.0f){
+                    angle -= 360.0f;
+                }
+                
+                glm::mat4 testMat = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
+                //testMat = glm::rotate(testMat, glm::radians(10.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+                vulkanRenderer.updateModel(helicopter, testMat);
+                
+                vulkanRenderer.draw();
+                
+                if(frameTimes.is_open()){
+                    FrameStats stats = vulkanRenderer.getFrameStats();
+                    frameTimes << frame << "," << stats.cpuTime << "," << (stats.gpuTimeValid ? stats.gpuTime : 0.0) << "," << stats.drawCount << "," << stats.triangleCount << "\n";
+                }
+                frame++;
+            }
+        }
         
-        vulkanRenderer.draw();
+        if(options.overdraw){
+            printOverdrawHistogram(vulkanRenderer.getOverdrawHistogram());
+        }
+    }catch(const std::runtime_error &e){
+        printf(">>> Error Ocurred!\n");
+        printf("ERROR: %s\n", e.what());
     }
     
     // perform clean up activities here